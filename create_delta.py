@@ -0,0 +1,225 @@
+import glob
+import os
+import struct
+import sys
+import zlib
+import hashlib
+
+# Create a delta image between two firmware versions for src/delta_patch.cpp
+#
+# As PlatformIO post script the new .hex is converted into a flat .bin and a
+# delta from the previous .bin in the output folder is created.
+# From the command line any pair of .hex or .bin files can be used:
+#   python3 create_delta.py old.hex new.hex [new.delta]
+
+DELTA_MAGIC = 0x314C4457  # "WDL1"
+DELTA_OP_COPY = 0x01
+DELTA_OP_INSERT = 0x02
+
+# Length of the match key and shortest COPY operation
+KEY_SIZE = 8
+MIN_COPY = 12
+# Candidates kept per key
+MAX_CANDIDATES = 16
+
+
+def hex_to_bin(buf):
+    # Flat image from the lowest to the highest address, gaps are filled with 0xFF
+    upper = 0
+    data = {}
+    for line in buf.split('\n'):
+        line = line.strip()
+        if len(line) == 0 or line[0] != ":":
+            continue
+        rec = bytes.fromhex(line[1:])
+        tp = rec[3]
+        if tp == 4:
+            upper = ((rec[4] << 8) | rec[5]) << 16
+        elif tp == 2:
+            upper = ((rec[4] << 8) | rec[5]) << 4
+        elif tp == 1:
+            break
+        elif tp == 0:
+            addr = upper | (rec[1] << 8) | rec[2]
+            # Skip UICR and other registers
+            if addr >= 0x10000000:
+                continue
+            for i in range(rec[0]):
+                data[addr + i] = rec[4 + i]
+    if len(data) == 0:
+        return b"", 0
+    start = min(data)
+    image = bytearray(b"\xff" * (max(data) - start + 1))
+    for addr, value in data.items():
+        image[addr - start] = value
+    return bytes(image), start
+
+
+def read_image(name):
+    with open(name, mode='rb') as f:
+        inpbuf = f.read()
+    if name.endswith(".hex"):
+        image, start = hex_to_bin(inpbuf.decode("utf-8"))
+        return image
+    return inpbuf
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def match_length(old, old_pos, new, new_pos):
+    length = 0
+    max_len = min(len(old) - old_pos, len(new) - new_pos)
+    # Compare in blocks first, then byte by byte
+    while length + 64 <= max_len and old[old_pos + length:old_pos + length + 64] == new[new_pos + length:new_pos + length + 64]:
+        length += 64
+    while length < max_len and old[old_pos + length] == new[new_pos + length]:
+        length += 1
+    return length
+
+
+def make_delta(old, new):
+    index = {}
+    for pos in range(0, len(old) - KEY_SIZE + 1):
+        candidates = index.setdefault(old[pos:pos + KEY_SIZE], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(pos)
+
+    ops = bytearray()
+    literal = bytearray()
+    old_pos = 0
+    new_pos = 0
+
+    def flush_literal():
+        if literal:
+            ops.append(DELTA_OP_INSERT)
+            ops.extend(varint(len(literal)))
+            ops.extend(literal)
+            del literal[:]
+
+    while new_pos < len(new):
+        # Prefer the position that continues the last copy, the cheapest to encode
+        expected = old_pos + len(literal)
+        best_len = 0
+        best_pos = 0
+        if expected < len(old):
+            best_len = match_length(old, expected, new, new_pos)
+            best_pos = expected
+        if best_len < MIN_COPY * 4:
+            for pos in index.get(new[new_pos:new_pos + KEY_SIZE], ()):
+                length = match_length(old, pos, new, new_pos)
+                if length > best_len:
+                    best_len = length
+                    best_pos = pos
+        if best_len >= MIN_COPY:
+            flush_literal()
+            ops.append(DELTA_OP_COPY)
+            ops.extend(varint(best_len))
+            ops.extend(varint(zigzag(best_pos - old_pos)))
+            old_pos = best_pos + best_len
+            new_pos += best_len
+        else:
+            literal.append(new[new_pos])
+            new_pos += 1
+    flush_literal()
+
+    header = struct.pack("<IIII", DELTA_MAGIC, len(old), zlib.crc32(old) & 0xFFFFFFFF, len(new))
+    header += hashlib.sha256(new).digest()
+    return header + ops
+
+
+def apply_delta(old, delta):
+    # Reference applier, used to check every created delta
+    magic, old_size, old_crc, new_size = struct.unpack_from("<IIII", delta, 0)
+    new_hash = delta[16:48]
+    assert magic == DELTA_MAGIC and old_size == len(old) and old_crc == zlib.crc32(old) & 0xFFFFFFFF
+    pos = 48
+    old_pos = 0
+    new = bytearray()
+
+    def read_varint():
+        nonlocal pos
+        value = 0
+        shift = 0
+        while True:
+            byte = delta[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    while len(new) < new_size:
+        op = delta[pos]
+        pos += 1
+        length = read_varint()
+        if op == DELTA_OP_COPY:
+            adjust = read_varint()
+            old_pos += (adjust >> 1) ^ -(adjust & 1)
+            new += old[old_pos:old_pos + length]
+            old_pos += length
+        elif op == DELTA_OP_INSERT:
+            new += delta[pos:pos + length]
+            pos += length
+        else:
+            raise ValueError("Invalid operation %02X" % op)
+    assert pos == len(delta) and hashlib.sha256(new).digest() == new_hash
+    return bytes(new)
+
+
+def create_delta_file(old_name, new_name, delta_name):
+    old = read_image(old_name)
+    new = read_image(new_name)
+    delta = make_delta(old, new)
+    if apply_delta(old, delta) != new:
+        raise ValueError("Delta check failed")
+    with open(delta_name, "wb") as f:
+        f.write(delta)
+    print("Delta %s -> %s: %d bytes (new image %d bytes, %.1f %%)" %
+          (os.path.basename(old_name), os.path.basename(new_name), len(delta), len(new), 100.0 * len(delta) / max(len(new), 1)))
+
+
+# Parse output of the build and create the delta from the previous build
+def create_delta(source, target, env):
+    source_hex = target[0].get_abspath()
+    print("#########################################################")
+    print("Create delta for " + source_hex)
+    print("#########################################################")
+    new_bin = source_hex.replace(".hex", ".bin")
+    image = read_image(source_hex)
+    with open(new_bin, "wb") as f:
+        f.write(image)
+
+    previous = [name for name in glob.glob(os.path.join(os.path.dirname(new_bin), "WisBlock_WEA_V*.bin")) if name != new_bin]
+    if len(previous) == 0:
+        print("No previous build found, delta is created with the next build")
+        return
+    old_bin = max(previous, key=os.path.getmtime)
+    create_delta_file(old_bin, new_bin, source_hex.replace(".hex", ".delta"))
+    print("#########################################################")
+
+
+try:
+    Import("env")
+    # Add callback after .hex file was created
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.hex", create_delta)
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) < 3:
+            print("Usage: python3 create_delta.py old.hex|bin new.hex|bin [new.delta]")
+            sys.exit(1)
+        delta_name = sys.argv[3] if len(sys.argv) > 3 else os.path.splitext(sys.argv[2])[0] + ".delta"
+        create_delta_file(sys.argv[1], sys.argv[2], delta_name)
@@ -0,0 +1,625 @@
+/**
+ * @file kit1_decoder.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Header-only host decoder for the Cayenne LPP uplinks of the WisBlock Kit 1
+ *        Decodes batches of frames into a struct-of-arrays layout
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Frame validation does not branch per byte. Each LPP entry is checked
+ * with a table lookup of its data size, values are read with a fixed
+ * width load from a zero padded copy of the frame. The standard 19 byte
+ * LoRaWAN frame (battery, humidity, temperature, pressure, light) is
+ * extracted with SSSE3 shuffles when available. Scaling into physical
+ * units runs over contiguous columns and is vectorized by the compiler.
+ */
+
+#ifndef KIT1_DECODER_H
+#define KIT1_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/** Cayenne LPP channels, must match src/app.h */
+#define KIT1_CH_BATT 1
+#define KIT1_CH_HUMID 2
+#define KIT1_CH_TEMP 3
+#define KIT1_CH_PRESS 4
+/** Pressure channel used by the firmware, LPP_CHANNEL_PRESS_2 of WisBlock-API-V2 */
+#define KIT1_CH_PRESS_2 8
+#define KIT1_CH_LIGHT 5
+/** Estimated battery runtime in days */
+#define KIT1_CH_BATT_RUNTIME 23
+/** Measurement profile, 0 = ultra-low-power, 1 = balanced, 2 = high-precision */
+#define KIT1_CH_PROFILE 24
+/** Frames since the last sent frame of the forecast uplink suppression, 0 = forecast restarted */
+#define KIT1_CH_FC_STEPS 25
+/** Measurement time, Unix time in seconds (LPP Unix time) */
+#define KIT1_CH_TIME 26
+/** Time request, sequence number the time downlink on fPort 22 echoes */
+#define KIT1_CH_TIME_REQ 27
+/** Sensors that could not be read, bit 0 RAK1901, bit 1 RAK1902, bit 2 RAK1903. Their values are not in the frame */
+#define KIT1_CH_SENSOR_ERR 28
+/** Sequence number of a LoRa P2P frame that requests an ACK */
+#define KIT1_CH_P2P_SEQ 29
+/** Derived values (ATC+DERIV), dew point, absolute humidity, altitude, WMO tendency code, 3 hour pressure change */
+#define KIT1_CH_DEW_POINT 30
+#define KIT1_CH_ABS_HUMID 31
+#define KIT1_CH_ALTITUDE 32
+#define KIT1_CH_TENDENCY 33
+#define KIT1_CH_PRESS_DELTA 34
+/** Channel of the device ID in LoRa P2P mode */
+#define KIT1_CH_DEVID 0
+
+/** LPP type of WisCayenne::addDevID(), override if the API uses a different type */
+#ifndef KIT1_LPP_DEVID
+#define KIT1_LPP_DEVID 0xFF
+#endif
+
+namespace kit1
+{
+	/** Cayenne LPP types */
+	enum lpp_type : uint8_t
+	{
+		LPP_DIGITAL_INPUT = 0x00,
+		LPP_DIGITAL_OUTPUT = 0x01,
+		LPP_ANALOG_INPUT = 0x02,
+		LPP_ANALOG_OUTPUT = 0x03,
+		LPP_LUMINOSITY = 0x65,
+		LPP_PRESENCE = 0x66,
+		LPP_TEMPERATURE = 0x67,
+		LPP_RELATIVE_HUMIDITY = 0x68,
+		LPP_ACCELEROMETER = 0x71,
+		LPP_BAROMETRIC_PRESSURE = 0x73,
+		LPP_VOLTAGE = 0x74,
+		LPP_ALTITUDE = 0x79,
+		LPP_UNIXTIME = 0x85,
+		LPP_GYROMETER = 0x86,
+		LPP_GPS = 0x88,
+	};
+
+	/** Decoded columns */
+	enum column : uint8_t
+	{
+		COL_BATT = 0,
+		COL_HUMID,
+		COL_TEMP,
+		COL_PRESS,
+		COL_LIGHT,
+		COL_DEVID,
+		COL_RUNTIME,
+		COL_PROFILE,
+		COL_FC_STEPS,
+		COL_TIME,
+		COL_TIME_REQ,
+		COL_SENSOR_ERR,
+		COL_P2P_SEQ,
+		COL_DEW_POINT,
+		COL_ABS_HUMID,
+		COL_ALTITUDE,
+		COL_TENDENCY,
+		COL_PRESS_DELTA,
+		COL_NUM,
+		/** Entries of known size that are not decoded (burst summary) */
+		COL_SKIP = COL_NUM,
+	};
+
+	/** Largest LoRaWAN payload */
+	static const size_t MAX_FRAME = 242;
+
+	/** Frame to decode */
+	struct frame_view
+	{
+		const uint8_t *data;
+		size_t len;
+	};
+
+	/** Decoded batch in struct-of-arrays layout */
+	struct batch
+	{
+		std::vector<float> batt_v;	   // Battery in V
+		std::vector<float> humid;	   // Relative humidity in %
+		std::vector<float> temp;	   // Temperature in degC
+		std::vector<float> press;	   // Pressure in hPa
+		std::vector<float> lux;		   // Light in lux
+		std::vector<uint32_t> dev_id;  // Last 4 bytes of the DevEUI (P2P only)
+		std::vector<float> runtime_d;  // Estimated battery runtime in days
+		std::vector<uint8_t> profile;  // Measurement profile
+		std::vector<uint8_t> fc_steps; // Frames since the last sent frame (forecast)
+		std::vector<uint32_t> time;	   // Measurement time, Unix time in seconds
+		std::vector<uint8_t> time_req; // 1 if the device requests the time downlink
+		std::vector<uint8_t> time_seq; // Sequence number of the time request
+		std::vector<uint8_t> sensor_err; // Sensors that could not be read, KIT1_CH_SENSOR_ERR
+		std::vector<uint8_t> p2p_seq;	 // Sequence number of the LoRa P2P ACK (P2P only)
+		std::vector<float> dew_point;	 // Dew point in degC
+		std::vector<float> abs_humid;	 // Absolute humidity in g/m3
+		std::vector<float> altitude;	 // Barometric altitude in m
+		std::vector<uint8_t> tendency;	 // WMO pressure tendency code 0 to 8
+		std::vector<float> press_delta;	 // Pressure change over 3 hours in hPa
+		std::vector<uint32_t> present; // Bit n set if column n was in the frame
+		std::vector<uint8_t> valid;	   // 1 if the frame is well formed
+		std::vector<int32_t> raw[COL_NUM + 1];
+
+		void resize(size_t count)
+		{
+			batt_v.resize(count);
+			humid.resize(count);
+			temp.resize(count);
+			press.resize(count);
+			lux.resize(count);
+			dev_id.resize(count);
+			runtime_d.resize(count);
+			profile.resize(count);
+			fc_steps.resize(count);
+			time.resize(count);
+			time_req.resize(count);
+			time_seq.resize(count);
+			sensor_err.resize(count);
+			p2p_seq.resize(count);
+			dew_point.resize(count);
+			abs_humid.resize(count);
+			altitude.resize(count);
+			tendency.resize(count);
+			press_delta.resize(count);
+			present.resize(count);
+			valid.resize(count);
+			for (size_t col = 0; col <= COL_NUM; col++)
+			{
+				raw[col].resize(count);
+			}
+		}
+	};
+
+	/** Per type decoding information */
+	struct type_info
+	{
+		uint8_t size;	   // Data size, 0 for unknown types
+		uint8_t is_signed; // Value is signed
+	};
+
+	/**
+	 * @brief Table of the data size of each LPP type
+	 */
+	struct type_table
+	{
+		type_info info[256];
+
+		type_table()
+		{
+			memset(info, 0, sizeof(info));
+			set(LPP_DIGITAL_INPUT, 1, 0);
+			set(LPP_DIGITAL_OUTPUT, 1, 0);
+			set(LPP_ANALOG_INPUT, 2, 1);
+			set(LPP_ANALOG_OUTPUT, 2, 1);
+			set(LPP_LUMINOSITY, 2, 0);
+			set(LPP_PRESENCE, 1, 0);
+			set(LPP_TEMPERATURE, 2, 1);
+			set(LPP_RELATIVE_HUMIDITY, 1, 0);
+			set(LPP_ACCELEROMETER, 6, 1);
+			set(LPP_BAROMETRIC_PRESSURE, 2, 0);
+			set(LPP_VOLTAGE, 2, 0);
+			set(LPP_ALTITUDE, 2, 1);
+			set(LPP_UNIXTIME, 4, 0);
+			set(LPP_GYROMETER, 6, 1);
+			set(LPP_GPS, 9, 1);
+			set(KIT1_LPP_DEVID, 4, 0);
+		}
+
+		void set(uint8_t type, uint8_t size, uint8_t is_signed)
+		{
+			info[type].size = size;
+			info[type].is_signed = is_signed;
+		}
+	};
+
+	/**
+	 * @brief Map channel and type to the decoded column
+	 *
+	 * @return uint8_t column, COL_SKIP if the entry is not decoded
+	 */
+	static inline uint8_t map_column(uint8_t channel, uint8_t type)
+	{
+		// One compare per column, no data dependent branches
+		uint8_t col = COL_SKIP;
+		col = (channel == KIT1_CH_BATT && type == LPP_VOLTAGE) ? (uint8_t)COL_BATT : col;
+		col = (channel == KIT1_CH_HUMID && type == LPP_RELATIVE_HUMIDITY) ? (uint8_t)COL_HUMID : col;
+		col = (channel == KIT1_CH_TEMP && type == LPP_TEMPERATURE) ? (uint8_t)COL_TEMP : col;
+		col = ((channel == KIT1_CH_PRESS || channel == KIT1_CH_PRESS_2) && type == LPP_BAROMETRIC_PRESSURE) ? (uint8_t)COL_PRESS : col;
+		col = (channel == KIT1_CH_LIGHT && type == LPP_LUMINOSITY) ? (uint8_t)COL_LIGHT : col;
+		col = (channel == KIT1_CH_DEVID && type == KIT1_LPP_DEVID) ? (uint8_t)COL_DEVID : col;
+		col = (channel == KIT1_CH_BATT_RUNTIME && type == LPP_ANALOG_INPUT) ? (uint8_t)COL_RUNTIME : col;
+		col = (channel == KIT1_CH_PROFILE && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_PROFILE : col;
+		col = (channel == KIT1_CH_FC_STEPS && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_FC_STEPS : col;
+		col = (channel == KIT1_CH_TIME && type == LPP_UNIXTIME) ? (uint8_t)COL_TIME : col;
+		col = (channel == KIT1_CH_TIME_REQ && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_TIME_REQ : col;
+		col = (channel == KIT1_CH_SENSOR_ERR && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_SENSOR_ERR : col;
+		col = (channel == KIT1_CH_P2P_SEQ && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_P2P_SEQ : col;
+		col = (channel == KIT1_CH_DEW_POINT && type == LPP_TEMPERATURE) ? (uint8_t)COL_DEW_POINT : col;
+		col = (channel == KIT1_CH_ABS_HUMID && type == LPP_ANALOG_INPUT) ? (uint8_t)COL_ABS_HUMID : col;
+		col = (channel == KIT1_CH_ALTITUDE && type == LPP_ALTITUDE) ? (uint8_t)COL_ALTITUDE : col;
+		col = (channel == KIT1_CH_TENDENCY && type == LPP_DIGITAL_INPUT) ? (uint8_t)COL_TENDENCY : col;
+		col = (channel == KIT1_CH_PRESS_DELTA && type == LPP_ANALOG_INPUT) ? (uint8_t)COL_PRESS_DELTA : col;
+		return col;
+	}
+
+	/**
+	 * @brief Decoder for batches of Kit 1 frames
+	 */
+	class decoder
+	{
+	public:
+		/**
+		 * @brief Construct a decoder
+		 *
+		 * @param use_simd true to extract the standard frame with SSSE3 if compiled in,
+		 *                 false to use the scalar extraction (tools/decoder_bench.cpp)
+		 */
+		explicit decoder(bool use_simd = true) : simd(use_simd)
+		{
+		}
+
+		/**
+		 * @brief Decode a batch of frames
+		 *
+		 * @param frames frames to decode
+		 * @param count number of frames
+		 * @param out decoded values, resized to count
+		 * @return size_t number of valid frames
+		 */
+		size_t decode(const frame_view *frames, size_t count, batch &out) const
+		{
+			out.resize(count);
+			size_t valid_num = 0;
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				if (!decode_standard(frames[idx], out, idx))
+				{
+					decode_generic(frames[idx], out, idx);
+				}
+				valid_num += out.valid[idx];
+			}
+			scale(out, count);
+			return valid_num;
+		}
+
+	private:
+		type_table types;
+		bool simd;
+
+		/**
+		 * @brief Read up to 4 bytes big endian from a zero padded buffer
+		 *
+		 * @param data start of the value
+		 * @param size value size 1 to 4, larger sizes read the first 4 bytes
+		 * @param is_signed sign extend the value
+		 */
+		static inline int32_t read_be(const uint8_t *data, uint8_t size, uint8_t is_signed)
+		{
+			uint32_t word = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+			uint32_t shift = (size < 4 ? 4 - size : 0) * 8;
+			int32_t sign_shifted = (int32_t)word >> shift;
+			int32_t unsign_shifted = (int32_t)(word >> shift);
+			return is_signed ? sign_shifted : unsign_shifted;
+		}
+
+		/**
+		 * @brief Decode any sequence of LPP entries
+		 *        Branches per entry only, the frame is invalid if an entry has an
+		 *        unknown type or is truncated
+		 */
+		void decode_generic(const frame_view &frame, batch &out, size_t idx) const
+		{
+			// Padding allows fixed width reads past the last entry
+			uint8_t buffer[MAX_FRAME + 16] = {0};
+			size_t len = frame.len < MAX_FRAME ? frame.len : MAX_FRAME;
+			memcpy(buffer, frame.data, len);
+
+			for (size_t col = 0; col <= COL_NUM; col++)
+			{
+				out.raw[col][idx] = 0;
+			}
+
+			uint32_t ok = frame.len <= MAX_FRAME;
+			uint32_t present = 0;
+			size_t pos = 0;
+			while (ok && (pos + 2 <= len))
+			{
+				uint8_t channel = buffer[pos];
+				type_info info = types.info[buffer[pos + 1]];
+				ok &= (info.size != 0) & (pos + 2 + info.size <= len);
+				uint8_t col = map_column(channel, buffer[pos + 1]);
+				out.raw[col][idx] = read_be(&buffer[pos + 2], info.size, info.is_signed);
+				present |= 1UL << col;
+				pos += 2 + info.size;
+			}
+			ok &= (pos == len) & (len != 0);
+			if (!ok)
+			{
+				for (size_t col = 0; col <= COL_NUM; col++)
+				{
+					out.raw[col][idx] = 0;
+				}
+			}
+			out.present[idx] = ok ? (uint32_t)(present & ((1UL << COL_NUM) - 1)) : 0;
+			out.valid[idx] = (uint8_t)ok;
+		}
+
+#if defined(__SSSE3__)
+		/**
+		 * @brief Check and extract the 19 sensor value bytes of the standard frame with SSSE3
+		 *
+		 * @param data frame, at least 19 bytes
+		 * @return uint32_t 1 if the frame starts with the standard sensor entries
+		 */
+		static inline uint32_t extract_simd(const uint8_t *data, batch &out, size_t idx)
+		{
+			static const uint8_t header[16] = {KIT1_CH_BATT, LPP_VOLTAGE, 0, 0,
+											   KIT1_CH_HUMID, LPP_RELATIVE_HUMIDITY, 0,
+											   KIT1_CH_TEMP, LPP_TEMPERATURE, 0, 0,
+											   KIT1_CH_PRESS_2, LPP_BAROMETRIC_PRESSURE, 0, 0,
+											   KIT1_CH_LIGHT};
+			static const uint8_t mask[16] = {0xFF, 0xFF, 0, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0, 0xFF, 0xFF, 0, 0, 0xFF};
+			__m128i head = _mm_loadu_si128((const __m128i *)data);
+			__m128i tail = _mm_loadu_si128((const __m128i *)(data + 3));
+			__m128i diff = _mm_and_si128(_mm_xor_si128(head, _mm_loadu_si128((const __m128i *)header)),
+										 _mm_loadu_si128((const __m128i *)mask));
+			if ((_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) || (data[16] != LPP_LUMINOSITY))
+			{
+				return 0;
+			}
+			// Swap the big endian values into 16 bit lanes: batt, humid, temp, press
+			__m128i values = _mm_shuffle_epi8(head, _mm_setr_epi8(3, 2, 6, -128, 10, 9, 14, 13, -128, -128, -128, -128, -128, -128, -128, -128));
+			// Light is in bytes 17 and 18, which are 14 and 15 of the tail
+			__m128i light = _mm_shuffle_epi8(tail, _mm_setr_epi8(15, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128));
+			uint16_t lanes[8];
+			_mm_storeu_si128((__m128i *)lanes, values);
+			out.raw[COL_BATT][idx] = lanes[0];
+			out.raw[COL_HUMID][idx] = lanes[1];
+			out.raw[COL_TEMP][idx] = (int16_t)lanes[2];
+			out.raw[COL_PRESS][idx] = lanes[3];
+			out.raw[COL_LIGHT][idx] = (uint16_t)_mm_cvtsi128_si32(light);
+			return 1;
+		}
+#endif
+
+		/**
+		 * @brief Check and extract the 19 sensor value bytes of the standard frame
+		 *
+		 * @param data frame, at least 19 bytes
+		 * @return uint32_t 1 if the frame starts with the standard sensor entries
+		 */
+		static inline uint32_t extract_scalar(const uint8_t *data, batch &out, size_t idx)
+		{
+			uint32_t match = (data[0] == KIT1_CH_BATT) & (data[1] == LPP_VOLTAGE) &
+							 (data[4] == KIT1_CH_HUMID) & (data[5] == LPP_RELATIVE_HUMIDITY) &
+							 (data[7] == KIT1_CH_TEMP) & (data[8] == LPP_TEMPERATURE) &
+							 (data[11] == KIT1_CH_PRESS_2) & (data[12] == LPP_BAROMETRIC_PRESSURE) &
+							 (data[15] == KIT1_CH_LIGHT) & (data[16] == LPP_LUMINOSITY);
+			if (!match)
+			{
+				return 0;
+			}
+			out.raw[COL_BATT][idx] = (data[2] << 8) | data[3];
+			out.raw[COL_HUMID][idx] = data[6];
+			out.raw[COL_TEMP][idx] = (int16_t)((data[9] << 8) | data[10]);
+			out.raw[COL_PRESS][idx] = (data[13] << 8) | data[14];
+			out.raw[COL_LIGHT][idx] = (data[17] << 8) | data[18];
+			return 1;
+		}
+
+		/**
+		 * @brief Decode the standard LoRaWAN frame
+		 *        01 74 VV VV 02 68 HH 03 67 TT TT 08 73 PP PP 05 65 LL LL
+		 *        optional followed by the battery runtime 17 02 RR RR
+		 *        and the measurement profile 18 00 PP
+		 *        and the forecast steps 19 00 SS
+		 *        and the measurement time 1A 85 TT TT TT TT
+		 *        and the time request 1B 00 SS
+		 *
+		 * @return true if the frame had the standard layout and was decoded
+		 * @return false if the generic decoder must be used
+		 */
+		bool decode_standard(const frame_view &frame, batch &out, size_t idx) const
+		{
+			// Optional entries after the sensor values
+			size_t end = 19;
+			uint32_t has_runtime = (frame.len >= end + 4) && (frame.data[end] == KIT1_CH_BATT_RUNTIME) && (frame.data[end + 1] == LPP_ANALOG_INPUT);
+			size_t runtime_pos = end + 2;
+			end += has_runtime ? 4 : 0;
+			uint32_t has_profile = (frame.len >= end + 3) && (frame.data[end] == KIT1_CH_PROFILE) && (frame.data[end + 1] == LPP_DIGITAL_INPUT);
+			size_t profile_pos = end + 2;
+			end += has_profile ? 3 : 0;
+			uint32_t has_fc_steps = (frame.len >= end + 3) && (frame.data[end] == KIT1_CH_FC_STEPS) && (frame.data[end + 1] == LPP_DIGITAL_INPUT);
+			size_t fc_steps_pos = end + 2;
+			end += has_fc_steps ? 3 : 0;
+			uint32_t has_time = (frame.len >= end + 6) && (frame.data[end] == KIT1_CH_TIME) && (frame.data[end + 1] == LPP_UNIXTIME);
+			size_t time_pos = end + 2;
+			end += has_time ? 6 : 0;
+			uint32_t has_time_req = (frame.len >= end + 3) && (frame.data[end] == KIT1_CH_TIME_REQ) && (frame.data[end + 1] == LPP_DIGITAL_INPUT);
+			size_t time_req_pos = end + 2;
+			end += has_time_req ? 3 : 0;
+			if (frame.len != end)
+			{
+				return false;
+			}
+			uint32_t match;
+#if defined(__SSSE3__)
+			match = simd ? extract_simd(frame.data, out, idx) : extract_scalar(frame.data, out, idx);
+#else
+			match = extract_scalar(frame.data, out, idx);
+#endif
+			if (!match)
+			{
+				return false;
+			}
+			out.present[idx] = (1 << COL_BATT) | (1 << COL_HUMID) | (1 << COL_TEMP) | (1 << COL_PRESS) | (1 << COL_LIGHT);
+			out.raw[COL_DEVID][idx] = 0;
+			out.raw[COL_RUNTIME][idx] = 0;
+			out.raw[COL_PROFILE][idx] = 0;
+			out.raw[COL_FC_STEPS][idx] = 0;
+			out.raw[COL_TIME][idx] = 0;
+			out.raw[COL_TIME_REQ][idx] = 0;
+			out.raw[COL_SENSOR_ERR][idx] = 0;
+			out.raw[COL_P2P_SEQ][idx] = 0;
+			out.raw[COL_DEW_POINT][idx] = 0;
+			out.raw[COL_ABS_HUMID][idx] = 0;
+			out.raw[COL_ALTITUDE][idx] = 0;
+			out.raw[COL_TENDENCY][idx] = 0;
+			out.raw[COL_PRESS_DELTA][idx] = 0;
+			if (has_runtime)
+			{
+				out.raw[COL_RUNTIME][idx] = (int16_t)((frame.data[runtime_pos] << 8) | frame.data[runtime_pos + 1]);
+				out.present[idx] |= (1 << COL_RUNTIME);
+			}
+			if (has_profile)
+			{
+				out.raw[COL_PROFILE][idx] = frame.data[profile_pos];
+				out.present[idx] |= (1 << COL_PROFILE);
+			}
+			if (has_fc_steps)
+			{
+				out.raw[COL_FC_STEPS][idx] = frame.data[fc_steps_pos];
+				out.present[idx] |= (1 << COL_FC_STEPS);
+			}
+			if (has_time)
+			{
+				out.raw[COL_TIME][idx] = read_be(&frame.data[time_pos], 4, 0);
+				out.present[idx] |= (1 << COL_TIME);
+			}
+			if (has_time_req)
+			{
+				out.raw[COL_TIME_REQ][idx] = frame.data[time_req_pos];
+				out.present[idx] |= (1 << COL_TIME_REQ);
+			}
+			out.valid[idx] = 1;
+			return true;
+		}
+
+		/**
+		 * @brief Scale the raw columns into physical units
+		 *        Plain loops over contiguous arrays, vectorized by the compiler
+		 */
+		static void scale(batch &out, size_t count)
+		{
+			const int32_t *raw_batt = out.raw[COL_BATT].data();
+			const int32_t *raw_humid = out.raw[COL_HUMID].data();
+			const int32_t *raw_temp = out.raw[COL_TEMP].data();
+			const int32_t *raw_press = out.raw[COL_PRESS].data();
+			const int32_t *raw_light = out.raw[COL_LIGHT].data();
+			const int32_t *raw_devid = out.raw[COL_DEVID].data();
+			const int32_t *raw_runtime = out.raw[COL_RUNTIME].data();
+			const int32_t *raw_profile = out.raw[COL_PROFILE].data();
+			const int32_t *raw_fc_steps = out.raw[COL_FC_STEPS].data();
+			const int32_t *raw_time = out.raw[COL_TIME].data();
+			const int32_t *raw_time_req = out.raw[COL_TIME_REQ].data();
+			const int32_t *raw_sensor_err = out.raw[COL_SENSOR_ERR].data();
+			const int32_t *raw_p2p_seq = out.raw[COL_P2P_SEQ].data();
+			const int32_t *raw_dew_point = out.raw[COL_DEW_POINT].data();
+			const int32_t *raw_abs_humid = out.raw[COL_ABS_HUMID].data();
+			const int32_t *raw_altitude = out.raw[COL_ALTITUDE].data();
+			const int32_t *raw_tendency = out.raw[COL_TENDENCY].data();
+			const int32_t *raw_press_delta = out.raw[COL_PRESS_DELTA].data();
+			const uint32_t *present = out.present.data();
+			float *batt_v = out.batt_v.data();
+			float *humid = out.humid.data();
+			float *temp = out.temp.data();
+			float *press = out.press.data();
+			float *lux = out.lux.data();
+			uint32_t *dev_id = out.dev_id.data();
+			float *runtime_d = out.runtime_d.data();
+			uint8_t *profile = out.profile.data();
+			uint8_t *fc_steps = out.fc_steps.data();
+			uint32_t *time = out.time.data();
+			uint8_t *time_req = out.time_req.data();
+			uint8_t *time_seq = out.time_seq.data();
+			uint8_t *sensor_err = out.sensor_err.data();
+			uint8_t *p2p_seq = out.p2p_seq.data();
+			float *dew_point = out.dew_point.data();
+			float *abs_humid = out.abs_humid.data();
+			float *altitude = out.altitude.data();
+			uint8_t *tendency = out.tendency.data();
+			float *press_delta = out.press_delta.data();
+
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				batt_v[idx] = raw_batt[idx] * 0.01f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				humid[idx] = raw_humid[idx] * 0.5f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				temp[idx] = raw_temp[idx] * 0.1f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				press[idx] = raw_press[idx] * 0.1f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				lux[idx] = (float)raw_light[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				dev_id[idx] = (uint32_t)raw_devid[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				runtime_d[idx] = raw_runtime[idx] * 0.01f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				profile[idx] = (uint8_t)raw_profile[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				fc_steps[idx] = (uint8_t)raw_fc_steps[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				time[idx] = (uint32_t)raw_time[idx];
+				time_req[idx] = (uint8_t)((present[idx] >> COL_TIME_REQ) & 1);
+				time_seq[idx] = (uint8_t)raw_time_req[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				sensor_err[idx] = (uint8_t)raw_sensor_err[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				p2p_seq[idx] = (uint8_t)raw_p2p_seq[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				dew_point[idx] = raw_dew_point[idx] * 0.1f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				abs_humid[idx] = raw_abs_humid[idx] * 0.01f;
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				altitude[idx] = (float)raw_altitude[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				tendency[idx] = (uint8_t)raw_tendency[idx];
+			}
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				press_delta[idx] = raw_press_delta[idx] * 0.01f;
+			}
+		}
+	};
+}
+
+#endif
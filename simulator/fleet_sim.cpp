@@ -0,0 +1,543 @@
+/**
+ * @file fleet_sim.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Fleet soak simulator for the WisBlock Kit 1 LoRaWAN behavior
+ *        Runs many nodes against a simulated channel and network server
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each node follows the logic of app_event_handler() and lora_data_handler()
+ * in src/app.cpp:
+ * - join after boot, restart the join when it fails
+ * - STATUS timer every send interval, the event is skipped while lora_busy
+ * - send_fail counts failed confirmed uplinks, at 10 the node resets
+ *   (send_fail is never cleared by a successful uplink)
+ *
+ * The channel models time-on-air, collisions of overlapping uplinks on the
+ * same channel, a half-duplex gateway that cannot receive while it transmits
+ * downlinks, one downlink at a time, and a random ACK/downlink loss.
+ *
+ * Each node has a crystal drift, its timer runs fast or slow by a fixed ppm
+ * value, and each uplink starts with a random delay after the timer event
+ * (sensor acquisition time). Without slot scheduling the send timer is the
+ * periodic timer of the WisBlock API.
+ *
+ * Build: g++ -O2 -std=c++11 -o fleet_sim simulator/fleet_sim.cpp
+ * Usage: fleet_sim [options], see print_usage()
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <queue>
+#include <random>
+#include <vector>
+
+/** Simulation parameters */
+struct sim_config
+{
+	std::vector<int> node_counts{10, 50, 100, 200, 500};
+	double hours = 24.0;
+	double send_interval = 300.0; // g_lorawan_settings.send_repeat_time in s
+	int sf = 9;					  // Spreading factor of uplinks and downlinks
+	int channels = 8;			  // Uplink channels of the gateway
+	bool confirmed = true;		  // LMH_CONFIRMED_MSG
+	double dl_loss = 0.02;		  // Random loss of downlinks (ACK, join accept)
+	bool power_cut = true;		  // All nodes boot at the same time
+	bool slots = false;			  // Transmit slot scheduling of src/slot.cpp
+	double drift_ppm = 20.0;	  // Maximum crystal drift of the nodes
+	double timer_jitter = 0.05;	  // Maximum delay of the uplink after the timer event in s
+	int payload = 19;			  // Application payload size
+	uint32_t seed = 1;
+};
+
+/** LoRaWAN frame overhead MHDR + FHDR + FPort + MIC */
+#define LORAWAN_OVERHEAD 13
+#define JOIN_REQUEST_SIZE 23
+#define JOIN_ACCEPT_SIZE 17
+#define ACK_SIZE 12
+/** RX window delays in s */
+#define RX1_DELAY 1.0
+#define JOIN_ACCEPT_DELAY 5.0
+/** Delay between join trials in s, plus up to JOIN_RETRY_JITTER from the MAC scheduling */
+#define JOIN_RETRY_DELAY 8.0
+#define JOIN_RETRY_JITTER 2.0
+/** Delay of the reset after 10 failed uplinks */
+#define RESET_DELAY 0.1
+/** Time from reset to the first join request */
+#define BOOT_TIME 2.0
+
+/**
+ * @brief LoRa time on air in s, 125 kHz, CR 4/5, explicit header, CRC on
+ *
+ * @param sf spreading factor
+ * @param size PHY payload size
+ */
+static double time_on_air(int sf, int size)
+{
+	double t_sym = (double)(1 << sf) / 125000.0;
+	int de = sf >= 11 ? 1 : 0;
+	double t_preamble = (8 + 4.25) * t_sym;
+	double num = 8.0 * size - 4.0 * sf + 28 + 16;
+	double payload_symb = 8 + fmax(ceil(num / (4.0 * (sf - 2 * de))) * 5, 0);
+	return t_preamble + payload_symb * t_sym;
+}
+
+/** Event types */
+enum event_type
+{
+	EV_BOOT,
+	EV_JOIN_TX,
+	EV_JOIN_RX,
+	EV_STATUS,
+	EV_UPLINK_END,
+	EV_TX_FIN,
+};
+
+struct event
+{
+	double time;
+	int node;
+	event_type type;
+	uint32_t generation; // Ignore events scheduled before a node reset
+	uint32_t timer_gen;	 // Ignore STATUS events of a restarted timer
+	bool operator>(const event &other) const { return time > other.time; }
+};
+
+/** Node state, mirrors the globals of app.cpp */
+struct node_state
+{
+	bool joined = false;
+	bool lora_busy = false;
+	double boot_time = 0;
+	double drift = 0;		 // Clock drift, node time = real time * (1 + drift)
+	double timer_time = 0;	 // Time the send timer fires, without the uplink delay
+	double slot_offset = 0;	 // Slot phase offset after failed uplinks in s
+	uint32_t timer_gen = 0;	 // Ignore STATUS events of a restarted timer
+	uint8_t send_fail = 0;
+	uint32_t generation = 0;
+	int uplink = -1; // Index of the ongoing uplink
+	double airtime = 0;
+	uint32_t readings = 0;
+	uint32_t skipped = 0;
+	uint32_t resets = 0;
+	uint32_t join_requests = 0;
+};
+
+/** Uplink on the air */
+struct uplink
+{
+	int node;
+	int channel;
+	double start;
+	double end;
+	bool join;
+	bool lost;
+};
+
+/** Result of one run */
+struct sim_result
+{
+	uint64_t readings = 0;
+	uint64_t delivered = 0;
+	uint64_t skipped = 0;
+	uint64_t resets = 0;
+	uint64_t join_requests = 0;
+	uint32_t peak_joins_per_min = 0;
+	double airtime_per_node = 0;
+	double collisions = 0;
+	uint64_t uplinks = 0;
+};
+
+class fleet_sim
+{
+public:
+	fleet_sim(const sim_config &cfg, int node_num) : cfg(cfg), nodes(node_num), rng(cfg.seed), ack_result(node_num, true) {}
+
+	sim_result run(void)
+	{
+		std::uniform_real_distribution<double> boot(0.0, cfg.power_cut ? 1.0 : cfg.send_interval);
+		for (size_t idx = 0; idx < nodes.size(); idx++)
+		{
+			nodes[idx].drift = random(-cfg.drift_ppm, cfg.drift_ppm) * 1e-6;
+			schedule(boot(rng), idx, EV_BOOT);
+		}
+
+		double end_time = cfg.hours * 3600.0;
+		joins_per_min.assign((size_t)(end_time / 60.0) + 1, 0);
+		while (!events.empty() && events.top().time < end_time)
+		{
+			event ev = events.top();
+			events.pop();
+			if ((ev.generation != nodes[ev.node].generation) || ((ev.type == EV_STATUS) && (ev.timer_gen != nodes[ev.node].timer_gen)))
+			{
+				continue;
+			}
+			now = ev.time;
+			handle(ev);
+		}
+
+		sim_result result;
+		for (size_t idx = 0; idx < nodes.size(); idx++)
+		{
+			result.readings += nodes[idx].readings;
+			result.skipped += nodes[idx].skipped;
+			result.resets += nodes[idx].resets;
+			result.join_requests += nodes[idx].join_requests;
+			result.airtime_per_node += nodes[idx].airtime;
+		}
+		result.airtime_per_node /= nodes.size();
+		result.delivered = ns_delivered;
+		result.uplinks = uplinks_total;
+		result.collisions = uplinks_total ? (double)uplinks_lost / uplinks_total : 0;
+		for (size_t idx = 0; idx < joins_per_min.size(); idx++)
+		{
+			result.peak_joins_per_min = joins_per_min[idx] > result.peak_joins_per_min ? joins_per_min[idx] : result.peak_joins_per_min;
+		}
+		return result;
+	}
+
+private:
+	const sim_config &cfg;
+	std::vector<node_state> nodes;
+	std::mt19937 rng;
+	std::priority_queue<event, std::vector<event>, std::greater<event>> events;
+	std::vector<uplink> air;
+	std::vector<int> on_air;
+	std::vector<bool> ack_result;
+	std::vector<uint32_t> joins_per_min;
+	double now = 0;
+	double gw_busy_from = 0;
+	double gw_busy_until = 0;
+	uint64_t ns_delivered = 0;
+	uint64_t uplinks_total = 0;
+	uint64_t uplinks_lost = 0;
+
+	void schedule(double time, int node, event_type type)
+	{
+		events.push(event{time, node, type, nodes[node].generation, nodes[node].timer_gen});
+	}
+
+	double random(double min, double max)
+	{
+		return std::uniform_real_distribution<double>(min, max)(rng);
+	}
+
+	/**
+	 * @brief Start the send timer for the next STATUS event
+	 *        Without slots the periodic timer of the WisBlock API, which keeps its period
+	 *        in node time. With slot scheduling the same as slot_timer_restart() in
+	 *        src/slot.cpp, the phase is a hash of the node number instead of the DevEUI.
+	 *        The STATUS event is delayed by the acquisition time
+	 *
+	 * @param restart true if the timer is restarted outside of the STATUS event
+	 */
+	void start_timer(int node, bool restart)
+	{
+		node_state &state = nodes[node];
+		if (!cfg.slots)
+		{
+			state.timer_time += cfg.send_interval / (1.0 + state.drift);
+		}
+		else
+		{
+			uint32_t hash = 2166136261UL;
+			for (uint8_t idx = 0; idx < 4; idx++)
+			{
+				hash ^= (uint8_t)(node >> (idx * 8));
+				hash *= 16777619UL;
+			}
+			// Uptime is counted by the node clock from boot, all nodes boot together after a power cut
+			double uptime = (now - state.boot_time) * (1.0 + state.drift);
+			double phase = fmod((hash % (uint32_t)(cfg.send_interval * 1000)) / 1000.0 + state.slot_offset, cfg.send_interval);
+			double next_slot = (floor((uptime - phase) / cfg.send_interval) + 1) * cfg.send_interval + phase;
+			// Lead time of the slot, acquisition and time-on-air, at least 1 s (SLOT_LEAD_MIN_MS)
+			double lead = fmax(1.0, cfg.timer_jitter + time_on_air(cfg.sf, cfg.payload + LORAWAN_OVERHEAD));
+			if ((next_slot - uptime) < lead)
+			{
+				next_slot += cfg.send_interval;
+			}
+			state.timer_time = state.boot_time + next_slot / (1.0 + state.drift);
+		}
+		if (restart)
+		{
+			state.timer_gen++;
+		}
+		schedule(state.timer_time + random(0, cfg.timer_jitter), node, EV_STATUS);
+	}
+
+	/**
+	 * @brief Put an uplink on the air and check it against all overlapping uplinks
+	 *
+	 * @return int index of the uplink
+	 */
+	int start_uplink(int node, int size, bool join)
+	{
+		double toa = time_on_air(cfg.sf, size);
+		bool gw_busy = (now < gw_busy_until) && (now + toa > gw_busy_from);
+		uplink up{node, (int)random(0, cfg.channels), now, now + toa, join, gw_busy};
+
+		// Drop uplinks that ended, check the others for collisions
+		size_t keep = 0;
+		for (size_t idx = 0; idx < on_air.size(); idx++)
+		{
+			uplink &other = air[on_air[idx]];
+			if (other.end <= now)
+			{
+				continue;
+			}
+			if (other.channel == up.channel)
+			{
+				other.lost = true;
+				up.lost = true;
+			}
+			on_air[keep++] = on_air[idx];
+		}
+		on_air.resize(keep);
+
+		air.push_back(up);
+		on_air.push_back(air.size() - 1);
+		nodes[node].airtime += toa;
+		uplinks_total++;
+		return air.size() - 1;
+	}
+
+	/**
+	 * @brief Send a downlink from the gateway at the given time
+	 *        Gateway is half-duplex and sends one downlink at a time
+	 *
+	 * @return true if the downlink reached the node
+	 */
+	bool send_downlink(double time, int size)
+	{
+		double toa = time_on_air(cfg.sf, size);
+		if ((time < gw_busy_until) && (time + toa > gw_busy_from))
+		{
+			return false;
+		}
+		gw_busy_from = time;
+		gw_busy_until = time + toa;
+		// Uplinks on the air during the downlink are lost
+		for (size_t idx = 0; idx < on_air.size(); idx++)
+		{
+			uplink &other = air[on_air[idx]];
+			if ((other.end > time) && (other.start < gw_busy_until))
+			{
+				other.lost = true;
+			}
+		}
+		return random(0, 1) >= cfg.dl_loss;
+	}
+
+	void handle(const event &ev)
+	{
+		node_state &node = nodes[ev.node];
+		switch (ev.type)
+		{
+		case EV_BOOT:
+			node.boot_time = now;
+			node.slot_offset = 0;
+			node.joined = false;
+			node.lora_busy = false;
+			node.send_fail = 0;
+			schedule(now + BOOT_TIME, ev.node, EV_JOIN_TX);
+			break;
+		case EV_JOIN_TX:
+			node.join_requests++;
+			joins_per_min[(size_t)(now / 60.0)]++;
+			node.uplink = start_uplink(ev.node, JOIN_REQUEST_SIZE, true);
+			schedule(air[node.uplink].end, ev.node, EV_UPLINK_END);
+			break;
+		case EV_UPLINK_END:
+		{
+			const uplink &up = air[node.uplink];
+			node.uplink = -1;
+			if (up.lost)
+			{
+				uplinks_lost++;
+			}
+			if (up.join)
+			{
+				if (!up.lost && send_downlink(now + JOIN_ACCEPT_DELAY, JOIN_ACCEPT_SIZE))
+				{
+					schedule(now + JOIN_ACCEPT_DELAY + time_on_air(cfg.sf, JOIN_ACCEPT_SIZE), ev.node, EV_JOIN_RX);
+				}
+				else
+				{
+					// Next trial, after the last trial the app calls lmh_join() again
+					schedule(now + JOIN_ACCEPT_DELAY + JOIN_RETRY_DELAY + random(0, JOIN_RETRY_JITTER), ev.node, EV_JOIN_TX);
+				}
+			}
+			else
+			{
+				if (!up.lost)
+				{
+					ns_delivered++;
+				}
+				bool ack = !cfg.confirmed || (!up.lost && send_downlink(now + RX1_DELAY, ACK_SIZE));
+				ack_result[ev.node] = ack;
+				// TX finished after the RX windows
+				double fin = now + RX1_DELAY + ((ack && cfg.confirmed) ? time_on_air(cfg.sf, ACK_SIZE) : 2.0);
+				schedule(fin, ev.node, EV_TX_FIN);
+			}
+			break;
+		}
+		case EV_JOIN_RX:
+			node.joined = true;
+			node.timer_time = now;
+			start_timer(ev.node, false);
+			break;
+		case EV_STATUS:
+			start_timer(ev.node, false);
+			node.readings++;
+			if (node.lora_busy)
+			{
+				// "LoRaWAN TX cycle not finished, skip this event"
+				node.skipped++;
+				break;
+			}
+			node.lora_busy = true;
+			node.uplink = start_uplink(ev.node, cfg.payload + LORAWAN_OVERHEAD, false);
+			schedule(air[node.uplink].end, ev.node, EV_UPLINK_END);
+			break;
+		case EV_TX_FIN:
+			if (!ack_result[ev.node])
+			{
+				if (cfg.slots)
+				{
+					// slot_tx_failed(), move to a random phase and re-align the timer
+					node.slot_offset = random(0, cfg.send_interval);
+					start_timer(ev.node, true);
+				}
+				node.send_fail++;
+				if (node.send_fail == 10)
+				{
+					// api_reset()
+					node.resets++;
+					node.generation++;
+					schedule(now + RESET_DELAY, ev.node, EV_BOOT);
+				}
+			}
+			node.lora_busy = false;
+			break;
+		}
+	}
+};
+
+static void print_usage(void)
+{
+	printf("fleet_sim [options]\n");
+	printf("  -n 10,50,100   node counts to simulate\n");
+	printf("  -h 24          simulated hours\n");
+	printf("  -i 300         send interval in s\n");
+	printf("  -s 9           spreading factor\n");
+	printf("  -c 8           gateway channels\n");
+	printf("  -u             unconfirmed uplinks\n");
+	printf("  -l 0.02        downlink loss probability\n");
+	printf("  -r             random boot times instead of a common power cut\n");
+	printf("  -t             transmit slot scheduling\n");
+	printf("  -d 20          maximum crystal drift in ppm\n");
+	printf("  -j 0.05        maximum uplink delay after the timer event in s\n");
+	printf("  -p 19          application payload size\n");
+	printf("  -x 1           random seed\n");
+}
+
+int main(int argc, char **argv)
+{
+	sim_config cfg;
+	for (int idx = 1; idx < argc; idx++)
+	{
+		const char *arg = argv[idx];
+		const char *value = (idx + 1 < argc) ? argv[idx + 1] : "";
+		if (!strcmp(arg, "-n"))
+		{
+			cfg.node_counts.clear();
+			for (char *tok = strtok((char *)value, ","); tok; tok = strtok(NULL, ","))
+			{
+				cfg.node_counts.push_back(atoi(tok));
+			}
+			idx++;
+		}
+		else if (!strcmp(arg, "-h"))
+		{
+			cfg.hours = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-i"))
+		{
+			cfg.send_interval = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-s"))
+		{
+			cfg.sf = atoi(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-c"))
+		{
+			cfg.channels = atoi(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-u"))
+		{
+			cfg.confirmed = false;
+		}
+		else if (!strcmp(arg, "-l"))
+		{
+			cfg.dl_loss = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-r"))
+		{
+			cfg.power_cut = false;
+		}
+		else if (!strcmp(arg, "-t"))
+		{
+			cfg.slots = true;
+		}
+		else if (!strcmp(arg, "-d"))
+		{
+			cfg.drift_ppm = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-j"))
+		{
+			cfg.timer_jitter = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-p"))
+		{
+			cfg.payload = atoi(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-x"))
+		{
+			cfg.seed = (uint32_t)atoi(value);
+			idx++;
+		}
+		else
+		{
+			print_usage();
+			return 1;
+		}
+	}
+
+	printf("SF%d %d channels %s interval %.0f s %.1f h %s%s\n", cfg.sf, cfg.channels, cfg.confirmed ? "confirmed" : "unconfirmed",
+		   cfg.send_interval, cfg.hours, cfg.power_cut ? "common power cut" : "random boot", cfg.slots ? " slots" : "");
+	printf("%7s %10s %10s %9s %8s %10s %8s %8s %10s\n", "nodes", "readings", "delivered", "ratio", "lost up", "airtime/h", "resets", "joins", "joins/min");
+	for (size_t idx = 0; idx < cfg.node_counts.size(); idx++)
+	{
+		fleet_sim sim(cfg, cfg.node_counts[idx]);
+		sim_result res = sim.run();
+		printf("%7d %10llu %10llu %8.1f%% %7.1f%% %9.2fs %8llu %8llu %10u\n", cfg.node_counts[idx],
+			   (unsigned long long)res.readings, (unsigned long long)res.delivered,
+			   res.readings ? 100.0 * res.delivered / res.readings : 0.0, 100.0 * res.collisions,
+			   res.airtime_per_node / cfg.hours, (unsigned long long)res.resets,
+			   (unsigned long long)res.join_requests, res.peak_joins_per_min);
+	}
+	return 0;
+}
@@ -0,0 +1,676 @@
+/**
+ * @file p2p_sim.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Simulated LoRa P2P channel for the listen-before-talk of src/p2p_mac.h
+ *        Many sensor nodes send to one collector on a single channel
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each node follows p2p_send(), p2p_tx_finished() and p2p_rx() of
+ * src/p2p_mac.cpp, the frames are built and checked with the functions of
+ * src/p2p_mac.h. Three modes are compared per node count:
+ * - ALOHA: frames are sent without CAD (firmware before the listen-before-talk)
+ * - LBT: CAD before each frame, binary exponential backoff if the channel is busy
+ * - LBT+ACK: as LBT, frames are repeated until the collector acknowledges them,
+ *   nodes and collector fall back to LBT while their channel load estimate is high
+ *
+ * The channel models time-on-air, collisions of overlapping frames without
+ * capture effect, a half-duplex collector, CAD that misses a signal with a
+ * small probability, hidden nodes that cannot hear each other (the collector
+ * hears all nodes) and a random frame loss.
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o p2p_sim simulator/p2p_sim.cpp
+ * Usage: p2p_sim [options], see print_usage()
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <queue>
+#include <random>
+#include <vector>
+#include "p2p_mac.h"
+
+/** Simulation parameters */
+struct sim_config
+{
+	std::vector<int> node_counts{5, 20, 50, 100, 200, 400};
+	double hours = 2.0;
+	double send_interval = 60.0; // g_lorawan_settings.send_repeat_time in s
+	int sf = 7;					 // g_lorawan_settings.p2p_sf, 125 kHz, CR 4/5, 8 symbols preamble
+	int payload = 32;			 // Application payload with device ID and sequence number
+	double cad_miss = 0.05;		 // CAD does not detect an ongoing frame
+	double hidden = 0.0;		 // Probability that two nodes cannot hear each other
+	double loss = 0.01;			 // Random loss of frames and ACKs
+	uint32_t seed = 1;
+};
+
+/** Simulated modes */
+enum sim_mode
+{
+	MODE_ALOHA = 0,
+	MODE_LBT,
+	MODE_LBT_ACK,
+	MODE_NUM
+};
+static const char *mode_names[MODE_NUM] = {"ALOHA", "LBT", "LBT+ACK"};
+
+/** The collector as sender of a frame */
+#define COLLECTOR -1
+
+/**
+ * @brief LoRa time on air in ms, 125 kHz, CR 4/5, explicit header, CRC on
+ *
+ * @param sf spreading factor
+ * @param size payload size
+ */
+static double time_on_air(int sf, int size)
+{
+	double t_sym = (double)(1 << sf) / 125.0;
+	int de = sf >= 11 ? 1 : 0;
+	double t_preamble = (8 + 4.25) * t_sym;
+	double num = 8.0 * size - 4.0 * sf + 28 + 16;
+	double payload_symb = 8 + fmax(ceil(num / (4.0 * (sf - 2 * de))) * 5, 0);
+	return t_preamble + payload_symb * t_sym;
+}
+
+/** Event types */
+enum event_type
+{
+	EV_MEASURE,
+	EV_CAD,
+	EV_CAD_GAP,
+	EV_TX_END,
+	EV_ACK_END,
+	EV_ACK_TIMEOUT,
+};
+
+struct event
+{
+	double time;
+	int node;
+	event_type type;
+	uint32_t token; // Frame on the air or retry timer
+	bool operator>(const event &other) const { return time > other.time; }
+};
+
+/** Node state, mirrors the statics of p2p_mac.cpp and the pending frame of app.cpp */
+struct node_state
+{
+	bool busy = false;		// has_pending_frame or TX running
+	bool wait_ack = false;	// p2p_wait_ack
+	uint8_t seq = 0;		// p2p_seq
+	uint8_t attempts = 0;	// p2p_attempts
+	uint32_t timer = 0;		// Token of the running retry timer
+	uint32_t reading = 0;	// Reading of the running frame
+	uint8_t frame[64];		// Running frame
+	uint8_t frame_len = 0;
+	bool seq_added = false; // p2p_seq_added
+	p2p_load_s load{0, 0};	// p2p_load, frames received from other nodes
+};
+
+/** Frame on the air */
+struct transmission
+{
+	int src;
+	double start;
+	double end;
+	uint32_t token;	  // Matches the event of the frame end
+	uint32_t reading; // Reading of a data frame
+	uint8_t data[64];
+	uint8_t len;
+};
+
+/** Result of one run */
+struct sim_result
+{
+	uint64_t readings = 0;
+	uint64_t delivered = 0;
+	uint64_t frames = 0;
+	uint64_t frames_lost = 0;
+	uint64_t dropped = 0;	 // Frames dropped after P2P_MAX_ATTEMPTS
+	uint64_t duplicates = 0; // Repetitions the collector reported as new data
+	double airtime_per_node = 0;
+};
+
+class p2p_sim
+{
+public:
+	p2p_sim(const sim_config &cfg, int node_num, sim_mode mode)
+		: cfg(cfg), mode(mode), nodes(node_num), rng(cfg.seed), delivered(node_num), hidden(node_num * node_num, false)
+	{
+		toa_ms = time_on_air(cfg.sf, cfg.payload);
+		ack_toa_ms = time_on_air(cfg.sf, P2P_ACK_SIZE);
+		// CAD of 4 symbols plus processing
+		cad_ms = 5.0 * (1 << cfg.sf) / 125.0;
+		p2p_peers_reset(peers);
+	}
+
+	sim_result run(void)
+	{
+		for (int idx = 0; idx < (int)nodes.size(); idx++)
+		{
+			for (int other = idx + 1; other < (int)nodes.size(); other++)
+			{
+				bool is_hidden = random(0, 1) < cfg.hidden;
+				hidden[idx * nodes.size() + other] = is_hidden;
+				hidden[other * nodes.size() + idx] = is_hidden;
+			}
+			schedule(random(0, cfg.send_interval * 1000.0), idx, EV_MEASURE, 0);
+		}
+
+		double end_time = cfg.hours * 3600.0 * 1000.0;
+		while (!events.empty() && events.top().time < end_time)
+		{
+			event ev = events.top();
+			events.pop();
+			now = ev.time;
+			handle(ev);
+		}
+		result.airtime_per_node /= nodes.size() * 1000.0;
+		return result;
+	}
+
+private:
+	const sim_config &cfg;
+	sim_mode mode;
+	std::vector<node_state> nodes;
+	std::mt19937 rng;
+	std::priority_queue<event, std::vector<event>, std::greater<event>> events;
+	std::vector<transmission> air;
+	std::vector<std::vector<bool>> delivered;
+	std::vector<bool> hidden;
+	p2p_peer_s peers[P2P_PEERS];
+	p2p_load_s collector_load{0, 0};
+	uint32_t rx_counter = 0;
+	double toa_ms;
+	double ack_toa_ms;
+	double cad_ms;
+	double now = 0;
+	uint32_t next_token = 1;
+	sim_result result;
+
+	void schedule(double time, int node, event_type type, uint32_t token)
+	{
+		events.push(event{time, node, type, token});
+	}
+
+	double random(double min, double max)
+	{
+		return std::uniform_real_distribution<double>(min, max)(rng);
+	}
+
+	/**
+	 * @brief Check if a node hears the sender of a frame, the collector is heard by all nodes
+	 */
+	bool hears(int node, int src)
+	{
+		return (src == COLLECTOR) || (node == COLLECTOR) || !hidden[node * nodes.size() + src];
+	}
+
+	/**
+	 * @brief Check if a frame is disturbed at the receiver by another frame
+	 *        The receiver cannot receive while it transmits itself
+	 */
+	bool collided(const transmission &tx, int receiver)
+	{
+		for (size_t idx = 0; idx < air.size(); idx++)
+		{
+			const transmission &other = air[idx];
+			if ((other.token == tx.token) || (other.start >= tx.end) || (other.end <= tx.start))
+			{
+				continue;
+			}
+			if ((other.src == receiver) || hears(receiver, other.src))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Put a frame on the air, frames that ended are removed
+	 */
+	uint32_t start_tx(int src, double start, double duration, const uint8_t *data, uint8_t len, uint32_t reading)
+	{
+		size_t keep = 0;
+		for (size_t idx = 0; idx < air.size(); idx++)
+		{
+			// Keep frames that can still overlap a frame that is being received
+			if (air[idx].end > now - 2 * toa_ms)
+			{
+				air[keep++] = air[idx];
+			}
+		}
+		air.resize(keep);
+		transmission tx;
+		tx.src = src;
+		tx.start = start;
+		tx.end = start + duration;
+		tx.token = next_token++;
+		tx.reading = reading;
+		memcpy(tx.data, data, len);
+		tx.len = len;
+		air.push_back(tx);
+		return tx.token;
+	}
+
+	/**
+	 * @brief Find a frame on the air
+	 */
+	transmission *find_tx(uint32_t token)
+	{
+		for (size_t idx = 0; idx < air.size(); idx++)
+		{
+			if (air[idx].token == token)
+			{
+				return &air[idx];
+			}
+		}
+		return NULL;
+	}
+
+	/**
+	 * @brief Add a frame to the load estimate of the nodes that receive it, p2p_rx()
+	 */
+	void nodes_rx(const transmission &tx)
+	{
+		for (int node = 0; node < (int)nodes.size(); node++)
+		{
+			if ((node != tx.src) && hears(node, tx.src) && !collided(tx, node))
+			{
+				p2p_load_add(&nodes[node].load, (uint32_t)now, (uint32_t)ceil(tx.end - tx.start));
+			}
+		}
+	}
+
+	/**
+	 * @brief Build the Cayenne LPP frame of a reading: device ID, sensor values, sequence number
+	 */
+	void build_frame(int node)
+	{
+		node_state &state = nodes[node];
+		state.seq_added = (mode == MODE_LBT_ACK) && !p2p_load_high(&state.load, (uint32_t)now, P2P_ACK_LOAD_MAX);
+		uint8_t *data = state.frame;
+		uint8_t len = 0;
+		data[len++] = P2P_LPP_CH_DEVID;
+		data[len++] = P2P_LPP_DEVID;
+		data[len++] = 0xAC;
+		data[len++] = 0x1F;
+		data[len++] = (uint8_t)(node >> 8);
+		data[len++] = (uint8_t)node;
+		uint8_t values = state.seq_added ? cfg.payload - 3 : cfg.payload;
+		while (len + 4 <= values)
+		{
+			// Temperature entries as sensor values
+			data[len++] = 3;
+			data[len++] = 0x67;
+			data[len++] = 0x00;
+			data[len++] = 0xE1;
+		}
+		while (len + 3 <= values)
+		{
+			data[len++] = 2;
+			data[len++] = 0x68;
+			data[len++] = 0x50;
+		}
+		if (state.seq_added)
+		{
+			// p2p_stamp()
+			state.seq++;
+			data[len++] = P2P_LPP_CH_SEQ;
+			data[len++] = 0x00;
+			data[len++] = state.seq;
+		}
+		state.frame_len = len;
+	}
+
+	/**
+	 * @brief End of the running frame
+	 */
+	void finish(int node, bool dropped)
+	{
+		nodes[node].busy = false;
+		nodes[node].wait_ack = false;
+		nodes[node].timer = next_token++;
+		result.dropped += dropped ? 1 : 0;
+	}
+
+	/**
+	 * @brief CAD starting now, a frame that this node hears must cover at least 2 symbols
+	 */
+	bool channel_busy(int node)
+	{
+		double t_sym = (double)(1 << cfg.sf) / 125.0;
+		for (size_t idx = 0; idx < air.size(); idx++)
+		{
+			const transmission &other = air[idx];
+			double overlap = fmin(other.end, now + cad_ms) - fmax(other.start, now);
+			if ((overlap >= 2 * t_sym) && hears(node, other.src) && (random(0, 1) >= cfg.cad_miss))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Channel busy, retry after the backoff or drop the frame
+	 */
+	void backoff(int node)
+	{
+		node_state &state = nodes[node];
+		state.attempts++;
+		if (state.attempts >= P2P_MAX_ATTEMPTS)
+		{
+			finish(node, true);
+			return;
+		}
+		state.timer = next_token++;
+		uint32_t wait = p2p_backoff_ms((uint32_t)ceil(toa_ms), state.attempts, rng());
+		schedule(now + cad_ms + wait, node, EV_CAD, state.timer);
+	}
+
+	/**
+	 * @brief Put the running frame of a node on the air
+	 */
+	void transmit(int node, double tx_start)
+	{
+		node_state &state = nodes[node];
+		uint32_t token = start_tx(node, tx_start, toa_ms, state.frame, state.frame_len, state.reading);
+		result.frames++;
+		result.airtime_per_node += toa_ms;
+		schedule(tx_start + toa_ms, node, EV_TX_END, token);
+	}
+
+	/**
+	 * @brief p2p_send(), CAD and send or backoff
+	 *        With ACKs a second CAD after P2P_LBT_GAP_MS finds an ACK that follows a frame
+	 */
+	void send(int node)
+	{
+		node_state &state = nodes[node];
+		if (state.attempts >= P2P_MAX_ATTEMPTS)
+		{
+			finish(node, true);
+			return;
+		}
+		if (mode == MODE_ALOHA)
+		{
+			transmit(node, now);
+		}
+		else if (channel_busy(node))
+		{
+			backoff(node);
+		}
+		else if (state.seq_added)
+		{
+			state.timer = next_token++;
+			schedule(now + cad_ms + P2P_LBT_GAP_MS, node, EV_CAD_GAP, state.timer);
+		}
+		else
+		{
+			transmit(node, now + cad_ms);
+		}
+	}
+
+	/**
+	 * @brief Collector receives a frame, p2p_rx() in P2P_ACK_SEND mode
+	 */
+	void collector_rx(int node, const transmission &tx)
+	{
+		bool is_new = true;
+		uint32_t id = 0;
+		uint8_t seq = 0;
+		p2p_load_add(&collector_load, (uint32_t)now, (uint32_t)ceil(tx.end - tx.start));
+		if ((mode == MODE_LBT_ACK) && p2p_frame_seq(tx.data, tx.len, &id, &seq))
+		{
+			// ACK after the turnaround without CAD, skipped while the collector sends another ACK
+			// or the channel load is high
+			bool collector_busy = p2p_load_high(&collector_load, (uint32_t)now, P2P_ACK_LOAD_SKIP);
+			double ack_start = now + P2P_ACK_TURNAROUND_MS;
+			for (size_t idx = 0; idx < air.size(); idx++)
+			{
+				if ((air[idx].src == COLLECTOR) && (air[idx].end > ack_start))
+				{
+					collector_busy = true;
+				}
+			}
+			if (!collector_busy)
+			{
+				uint8_t ack[P2P_ACK_SIZE];
+				p2p_ack_build(ack, id, seq);
+				uint32_t token = start_tx(COLLECTOR, ack_start, ack_toa_ms, ack, P2P_ACK_SIZE, 0);
+				schedule(ack_start + ack_toa_ms, node, EV_ACK_END, token);
+			}
+			rx_counter++;
+			is_new = p2p_peer_check(peers, id, seq, rx_counter);
+		}
+		if (!is_new)
+		{
+			return;
+		}
+		if (delivered[node][tx.reading])
+		{
+			result.duplicates++;
+			return;
+		}
+		delivered[node][tx.reading] = true;
+		result.delivered++;
+	}
+
+	void handle(const event &ev)
+	{
+		node_state &state = nodes[ev.node];
+		switch (ev.type)
+		{
+		case EV_MEASURE:
+			schedule(now + cfg.send_interval * 1000.0 * random(0.995, 1.005), ev.node, EV_MEASURE, 0);
+			result.readings++;
+			if (state.busy)
+			{
+				// The STATUS event sends the pending frame instead of a new acquisition
+				break;
+			}
+			state.reading = (uint32_t)delivered[ev.node].size();
+			delivered[ev.node].push_back(false);
+			state.busy = true;
+			state.attempts = 0;
+			build_frame(ev.node);
+			send(ev.node);
+			break;
+		case EV_CAD:
+			if (state.busy && (ev.token == state.timer))
+			{
+				send(ev.node);
+			}
+			break;
+		case EV_CAD_GAP:
+			if (state.busy && (ev.token == state.timer))
+			{
+				if (channel_busy(ev.node))
+				{
+					backoff(ev.node);
+				}
+				else
+				{
+					transmit(ev.node, now + cad_ms);
+				}
+			}
+			break;
+		case EV_ACK_TIMEOUT:
+			if (state.busy && (ev.token == state.timer))
+			{
+				state.wait_ack = false;
+				send(ev.node);
+			}
+			break;
+		case EV_TX_END:
+		{
+			transmission *tx = find_tx(ev.token);
+			if (tx == NULL)
+			{
+				break;
+			}
+			transmission frame = *tx;
+			bool lost = collided(frame, COLLECTOR) || (random(0, 1) < cfg.loss);
+			result.frames_lost += lost ? 1 : 0;
+			if (!lost)
+			{
+				collector_rx(ev.node, frame);
+			}
+			if (mode == MODE_LBT_ACK)
+			{
+				nodes_rx(frame);
+			}
+			if (!state.seq_added)
+			{
+				finish(ev.node, false);
+				break;
+			}
+			// p2p_tx_finished()
+			state.attempts++;
+			state.wait_ack = true;
+			state.timer = next_token++;
+			double ack_window = P2P_ACK_TURNAROUND_MS + 2 * ceil(ack_toa_ms);
+			uint32_t backoff = p2p_backoff_ms((uint32_t)ceil(toa_ms), state.attempts, rng());
+			schedule(now + ack_window + backoff, ev.node, EV_ACK_TIMEOUT, state.timer);
+			break;
+		}
+		case EV_ACK_END:
+		{
+			transmission *tx = find_tx(ev.token);
+			if (tx != NULL)
+			{
+				nodes_rx(*tx);
+			}
+			if ((tx == NULL) || !state.wait_ack || collided(*tx, ev.node) || (random(0, 1) < cfg.loss))
+			{
+				break;
+			}
+			uint32_t id;
+			uint8_t seq;
+			uint32_t own_id = 0xAC1F0000UL | (uint32_t)ev.node;
+			if (p2p_ack_parse(tx->data, tx->len, &id, &seq) && (id == own_id) && (seq == state.seq))
+			{
+				finish(ev.node, false);
+			}
+			break;
+		}
+		}
+	}
+};
+
+static void print_usage(void)
+{
+	printf("p2p_sim [options]\n");
+	printf("  -n 5,20,50     node counts to simulate\n");
+	printf("  -h 2           simulated hours\n");
+	printf("  -i 60          send interval in s\n");
+	printf("  -s 7           spreading factor\n");
+	printf("  -p 32          application payload size\n");
+	printf("  -c 0.05        probability that the CAD misses a frame\n");
+	printf("  -d 0.0         probability that two nodes cannot hear each other\n");
+	printf("  -l 0.01        random frame loss\n");
+	printf("  -x 1           random seed\n");
+}
+
+int main(int argc, char **argv)
+{
+	sim_config cfg;
+	for (int idx = 1; idx < argc; idx++)
+	{
+		const char *arg = argv[idx];
+		const char *value = (idx + 1 < argc) ? argv[idx + 1] : "";
+		if (!strcmp(arg, "-n"))
+		{
+			cfg.node_counts.clear();
+			for (char *tok = strtok((char *)value, ","); tok; tok = strtok(NULL, ","))
+			{
+				cfg.node_counts.push_back(atoi(tok));
+			}
+			idx++;
+		}
+		else if (!strcmp(arg, "-h"))
+		{
+			cfg.hours = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-i"))
+		{
+			cfg.send_interval = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-s"))
+		{
+			cfg.sf = atoi(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-p"))
+		{
+			cfg.payload = atoi(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-c"))
+		{
+			cfg.cad_miss = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-d"))
+		{
+			cfg.hidden = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-l"))
+		{
+			cfg.loss = atof(value);
+			idx++;
+		}
+		else if (!strcmp(arg, "-x"))
+		{
+			cfg.seed = (uint32_t)atoi(value);
+			idx++;
+		}
+		else
+		{
+			print_usage();
+			return 1;
+		}
+	}
+	if ((cfg.payload < 12) || (cfg.payload > 64) || (cfg.sf < 7) || (cfg.sf > 12))
+	{
+		print_usage();
+		return 1;
+	}
+
+	printf("SF%d payload %d interval %.0f s %.1f h, CAD miss %.2f, hidden %.2f, loss %.2f\n", cfg.sf, cfg.payload,
+		   cfg.send_interval, cfg.hours, cfg.cad_miss, cfg.hidden, cfg.loss);
+	printf("%7s %8s %10s %10s %9s %8s %9s %8s %10s\n", "nodes", "mode", "readings", "delivered", "ratio", "lost", "frames/r", "dropped", "airtime/h");
+	bool ok = true;
+	for (size_t idx = 0; idx < cfg.node_counts.size(); idx++)
+	{
+		double ratio[MODE_NUM];
+		for (int mode = 0; mode < MODE_NUM; mode++)
+		{
+			p2p_sim sim(cfg, cfg.node_counts[idx], (sim_mode)mode);
+			sim_result res = sim.run();
+			ratio[mode] = res.readings ? (double)res.delivered / res.readings : 0.0;
+			printf("%7d %8s %10llu %10llu %8.1f%% %7.1f%% %9.2f %8llu %9.2fs\n", cfg.node_counts[idx], mode_names[mode],
+				   (unsigned long long)res.readings, (unsigned long long)res.delivered, 100.0 * ratio[mode],
+				   res.frames ? 100.0 * res.frames_lost / res.frames : 0.0, res.readings ? (double)res.frames / res.readings : 0.0,
+				   (unsigned long long)res.dropped, res.airtime_per_node / cfg.hours);
+			// Repetitions must be filtered by the sequence numbers
+			ok &= res.duplicates == 0;
+		}
+		// The ACKs may not deliver fewer readings than sending without CAD, at high load they fall back to LBT
+		ok &= ratio[MODE_LBT_ACK] >= ratio[MODE_ALOHA];
+		ok &= ratio[MODE_LBT_ACK] >= ratio[MODE_LBT] - 0.02;
+	}
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file acquisition.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Sensor acquisition and payload encoding
+ *        On dual-core MCU's the acquisition runs on the second core and hands the
+ *        encoded frames to the LoRa/BLE core through lock-free queues.
+ *        The acquisition side only uses the settings snapshot of its request
+ *        (g_acq_settings), it owns g_solution_data, the forecasters and the
+ *        battery filters. Values from the LoRa/BLE core are passed in the
+ *        request or through single-writer atomics (forecast.cpp, battery.cpp)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "spsc_queue.h"
+
+#if defined ESP32
+#include <esp_ipc.h>
+/** Core of the acquisition task, the LoRa/BLE stack runs on ARDUINO_RUNNING_CORE */
+#define ACQ_CORE (ARDUINO_RUNNING_CORE == 0 ? 1 : 0)
+/** Handle of the acquisition task */
+static TaskHandle_t acq_task_handle = NULL;
+#endif
+
+/** Acquisition request from the radio core */
+struct acq_request_s
+{
+	bool read_sensors;		 // false to read only the battery (battery protection)
+	bool add_dev_id;		 // LoRa P2P, add the device ID
+	bool confirmed;			 // Lost frames are reported (confirmed uplinks or P2P ACKs)
+	app_settings_s settings; // Settings at the time of the request
+};
+
+/** Acquisition requests from the radio core */
+static spsc_queue<acq_request_s, 4> acq_requests;
+/** Encoded frames to the radio core */
+static spsc_queue<acq_frame_s, 4> acq_frames;
+
+/** Settings of the running acquisition, only written by the acquisition side */
+app_settings_s g_acq_settings;
+
+/**
+ * @brief Read the sensors and encode the payload
+ *        Owns the sensors and g_solution_data while it runs
+ *
+ * @param request acquisition request with the settings snapshot
+ * @param frame returns the encoded frame
+ */
+static void acquire_frame(const acq_request_s &request, acq_frame_s *frame)
+{
+	uint32_t active_start = millis();
+	bool read_sensors = request.read_sensors;
+	memcpy((void *)&g_acq_settings, (void *)&request.settings, sizeof(app_settings_s));
+	frame->time_ms = active_start;
+
+	// Battery is measured before the sensors are powered, the radio is idle
+	frame->batt_mv = measure_batt();
+
+	// Reset the packet
+	g_solution_data.reset();
+	g_solution_data.addVoltage(LPP_CHANNEL_BATT, frame->batt_mv / 1000.0);
+
+	// Enable modules power
+	digitalWrite(WB_IO2, HIGH);
+
+	if (read_sensors)
+	{
+		// Sensor modes and settle time of the measurement profile
+		apply_profile();
+		delay(get_profile()->settle_ms);
+		frame->time_ms = millis();
+
+		uint8_t sensor_errors = 0;
+		if (has_rak1901)
+		{
+			// Read temperature and humidity
+			read_th();
+			sensor_errors |= g_sensor_values.th_valid ? 0 : SENSOR_ERR_RAK1901;
+		}
+		if (has_rak1902)
+		{
+			// Read air pressure
+			read_press();
+			sensor_errors |= g_sensor_values.press_valid ? 0 : SENSOR_ERR_RAK1902;
+		}
+		if (has_rak1903)
+		{
+			// Read luminosity
+			read_light();
+			sensor_errors |= g_sensor_values.light_valid ? 0 : SENSOR_ERR_RAK1903;
+		}
+		if (sensor_errors != 0)
+		{
+			// Failed readings are not in the frame, tell the backend which ones
+			g_solution_data.addDigitalInput(LPP_CHANNEL_SENSOR_ERR, sensor_errors);
+		}
+		if (g_acq_settings.derived_enable)
+		{
+			// Add dew point, absolute humidity, altitude and pressure tendency
+			add_derived_values();
+		}
+		if (g_acq_settings.burst_enable)
+		{
+			// Capture pressure and light burst and add the summary
+			read_burst();
+		}
+	}
+
+	// Remaining runtime from the measured active time and the radio charge per cycle
+	batt_active_time(millis() - active_start);
+	add_batt_runtime(frame->batt_mv);
+
+	// Profile the values were measured with
+	g_solution_data.addDigitalInput(LPP_CHANNEL_PROFILE, g_acq_settings.profile);
+
+	// Skip the frame if the backend can forecast the values, frames without values restart the forecasters
+	frame->send = forecast_check(request.confirmed, read_sensors);
+
+	if (request.add_dev_id)
+	{
+		g_solution_data.addDevID(0, &g_lorawan_settings.node_device_eui[4]);
+	}
+
+	frame->len = g_solution_data.getSize();
+	memcpy(frame->data, g_solution_data.getBuffer(), frame->len);
+
+	// Disable modules power, unless BLE streaming needs the sensors
+	if (!ble_stream_resume())
+	{
+		digitalWrite(WB_IO2, LOW);
+	}
+}
+
+#if defined ESP32
+/**
+ * @brief Runs on the LoRa/BLE core, wakes the app loop
+ *
+ * @param unused
+ */
+static void acq_wake_loop(void *unused)
+{
+	api_wake_loop(ACQ_DONE);
+}
+
+/**
+ * @brief Acquisition task on the second core
+ *
+ * @param unused
+ */
+static void acq_task(void *unused)
+{
+	acq_request_s request;
+	acq_frame_s frame;
+	while (true)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		while (acq_requests.pop(request))
+		{
+			acquire_frame(request, &frame);
+			if (!acq_frames.push(frame))
+			{
+				MYLOG("ACQ", "Frame queue full");
+			}
+			// Event flags are only changed on the LoRa/BLE core
+			esp_ipc_call(ARDUINO_RUNNING_CORE, acq_wake_loop, NULL);
+		}
+	}
+}
+#endif
+
+/**
+ * @brief Start the acquisition task on the second core
+ *        On single core MCU's (RAK4631) and on the RAK11300 the acquisition
+ *        runs in request_acquisition(). The Arduino-mbed RTOS and its Wire driver
+ *        are not safe to use from the second core of the RP2040
+ *
+ */
+void init_acquisition(void)
+{
+	// Settings until the first request, the task is not yet running
+	memcpy((void *)&g_acq_settings, (void *)&g_app_settings, sizeof(app_settings_s));
+#if defined ESP32
+	xTaskCreatePinnedToCore(acq_task, "ACQ", 4096, NULL, 1, &acq_task_handle, ACQ_CORE);
+	MYLOG("ACQ", "Acquisition runs on core %d", ACQ_CORE);
+#endif
+}
+
+/**
+ * @brief Request a new frame, ACQ_DONE is raised when the frame is ready
+ *
+ * @param read_sensors false to read only the battery (battery protection)
+ * @return true if the request was queued
+ * @return false if the acquisition is still busy
+ */
+bool request_acquisition(bool read_sensors)
+{
+	acq_request_s request;
+	request.read_sensors = read_sensors;
+	request.add_dev_id = !g_lorawan_settings.lorawan_enable;
+	request.confirmed = g_lorawan_settings.lorawan_enable ? g_lorawan_settings.confirmed_msg_enabled == LMH_CONFIRMED_MSG : g_app_settings.p2p_ack == P2P_ACK_REQUEST;
+	memcpy((void *)&request.settings, (void *)&g_app_settings, sizeof(app_settings_s));
+	if (!acq_requests.push(request))
+	{
+		return false;
+	}
+#if defined ESP32
+	xTaskNotifyGive(acq_task_handle);
+#else
+	acq_frame_s frame;
+	acq_requests.pop(request);
+	acquire_frame(request, &frame);
+	acq_frames.push(frame);
+	api_wake_loop(ACQ_DONE);
+#endif
+	return true;
+}
+
+/**
+ * @brief Get the next encoded frame
+ *
+ * @param frame returns the frame
+ * @return true if a frame was available
+ * @return false if no frame is ready
+ */
+bool get_acquisition(acq_frame_s *frame)
+{
+	return acq_frames.pop(*frame);
+}
@@ -0,0 +1,391 @@
+/**
+ * @file airtime.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Time-on-air calculation and duty-cycle budget per region
+ *        Frames are only built when the budget allows to send them
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** LoRaWAN overhead: MHDR + FHDR (without FOpts) + FPort + MIC */
+#define AIRTIME_LORAWAN_OVERHEAD 13
+/** Preamble length of LoRaWAN uplinks */
+#define AIRTIME_LORAWAN_PREAMBLE 8
+/** Symbols of a receive window without downlink, LoRaMac minimum of 6 plus margin */
+#define AIRTIME_RX_WINDOW_SYMBOLS 8
+/** Antenna gain the LoRaWAN stack subtracts from the EIRP in dB */
+#define AIRTIME_ANTENNA_GAIN 2
+/** Output power range of the SX1262 in dBm */
+#define AIRTIME_TX_POWER_MIN -9
+#define AIRTIME_TX_POWER_MAX 22
+/** Window of the regulatory duty-cycle in ms (1 hour) */
+#define AIRTIME_DUTY_WINDOW (60 * 60 * 1000UL)
+
+/** Duty-cycle band of the uplink channels */
+struct airtime_band_s
+{
+	uint16_t duty_div; // 1 / duty-cycle, 100 = 1 %, 0 = no duty-cycle
+	uint16_t dwell_ms; // Maximum time-on-air per frame, 0 = no limit
+};
+
+/** Token bucket of the uplink band */
+struct airtime_bucket_s
+{
+	uint32_t tokens_ms;	 // Available airtime in ms
+	uint32_t remainder;	 // Refill remainder, ms * duty_div
+	uint32_t last_fill;	 // Last refill
+	uint32_t off_until;	 // Band off time of the LoRaWAN stack ends
+	bool off_active;	 // Band off time is running
+	bool init;			 // Bucket was filled once
+};
+
+static airtime_bucket_s airtime_bucket;
+
+/**
+ * @brief Duty-cycle and dwell time of the uplink band of the region
+ *        EU868, EU433, RU864, CN779: default uplink channels are in a 1 % band
+ *        AS923: 1 % (Japan, most other countries use LBT or 1 %)
+ *        US915, AU915: no duty-cycle, 400 ms dwell time
+ *        KR920, IN865, CN470: no duty-cycle
+ *
+ * @param region LoRaWAN region
+ * @return airtime_band_s band limits
+ */
+static airtime_band_s airtime_band(uint8_t region)
+{
+	switch (region)
+	{
+	case LORAMAC_REGION_EU868:
+	case LORAMAC_REGION_EU433:
+	case LORAMAC_REGION_RU864:
+	case LORAMAC_REGION_CN779:
+	case LORAMAC_REGION_AS923:
+	case LORAMAC_REGION_AS923_2:
+	case LORAMAC_REGION_AS923_3:
+	case LORAMAC_REGION_AS923_4:
+		return {100, 0};
+	case LORAMAC_REGION_US915:
+	case LORAMAC_REGION_AU915:
+		return {0, 400};
+	default:
+		return {0, 0};
+	}
+}
+
+/**
+ * @brief Spreading factor and bandwidth of a data rate, see AT-Commands.md Appendix I
+ *
+ * @param region LoRaWAN region
+ * @param dr data rate
+ * @param sf returns the spreading factor, 0 for FSK
+ * @param bw_khz returns the bandwidth in kHz
+ * @return true if the data rate is defined
+ */
+static bool airtime_dr_params(uint8_t region, uint8_t dr, uint8_t *sf, uint16_t *bw_khz)
+{
+	*bw_khz = 125;
+	if ((region == LORAMAC_REGION_US915) || (region == LORAMAC_REGION_AU915))
+	{
+		// US915 DR0 to DR4 start at SF10, AU915 DR0 to DR6 at SF12
+		uint8_t first_sf = region == LORAMAC_REGION_US915 ? 10 : 12;
+		uint8_t dr_500 = region == LORAMAC_REGION_US915 ? 4 : 6;
+		if (dr < dr_500)
+		{
+			*sf = first_sf - dr;
+			return true;
+		}
+		*bw_khz = 500;
+		if (dr == dr_500)
+		{
+			*sf = 8;
+			return true;
+		}
+		if ((dr >= 8) && (dr <= 13))
+		{
+			*sf = 12 - (dr - 8);
+			return true;
+		}
+		return false;
+	}
+
+	if (dr <= 5)
+	{
+		*sf = 12 - dr;
+		return true;
+	}
+	if ((region == LORAMAC_REGION_KR920) || (region == LORAMAC_REGION_CN470))
+	{
+		return false;
+	}
+	if ((dr == 6) && (region != LORAMAC_REGION_IN865))
+	{
+		*sf = 7;
+		*bw_khz = 250;
+		return true;
+	}
+	if (dr == 7)
+	{
+		// FSK 50 kbps
+		*sf = 0;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Time-on-air of a LoRa packet (Semtech AN1200.13)
+ *        Explicit header and CRC on
+ *
+ * @param len PHY payload length
+ * @param sf spreading factor, 0 for FSK 50 kbps
+ * @param bw_khz bandwidth in kHz
+ * @param cr coding rate 1 = 4/5 to 4 = 4/8
+ * @param preamble preamble length in symbols
+ * @return uint32_t time-on-air in ms, rounded up
+ */
+static uint32_t airtime_toa_ms(uint16_t len, uint8_t sf, uint16_t bw_khz, uint8_t cr, uint16_t preamble)
+{
+	if (sf == 0)
+	{
+		// Preamble 5, sync word 3, length 1, payload, CRC 2 bytes with 50 kbps
+		return ((5 + 3 + 1 + len + 2) * 8 * 1000UL + 49999) / 50000;
+	}
+	uint32_t symbol_us = (1000UL << sf) / bw_khz;
+	uint8_t low_dr_opt = symbol_us >= 16000 ? 1 : 0;
+	int32_t num = 8 * len - 4 * sf + 28 + 16;
+	int32_t den = 4 * (sf - 2 * low_dr_opt);
+	uint32_t payload_symbols = 8;
+	if (num > 0)
+	{
+		payload_symbols += ((num + den - 1) / den) * (cr + 4);
+	}
+	// Preamble + 4.25 symbols, in 1/4 symbols
+	uint32_t quarter_symbols = (preamble + payload_symbols) * 4 + 17;
+	return (quarter_symbols * symbol_us / 4 + 999) / 1000;
+}
+
+/**
+ * @brief Current data rate, with ADR the data rate of the LoRaWAN stack
+ *
+ * @return uint8_t data rate
+ */
+static uint8_t airtime_dr(void)
+{
+	if (g_lorawan_settings.adr_enabled)
+	{
+		MibRequestConfirm_t mib_req;
+		mib_req.Type = MIB_CHANNELS_DATARATE;
+		if (LoRaMacMibGetRequestConfirm(&mib_req) == LORAMAC_STATUS_OK)
+		{
+			return mib_req.Param.ChannelsDatarate;
+		}
+	}
+	return g_lorawan_settings.data_rate;
+}
+
+/**
+ * @brief Duration of a receive window that gets no downlink
+ *
+ * @param region LoRaWAN region
+ * @param dr data rate of the window
+ * @return uint32_t window duration in us
+ */
+static uint32_t airtime_window_us(uint8_t region, uint8_t dr)
+{
+	uint8_t sf;
+	uint16_t bw_khz;
+	if (!airtime_dr_params(region, dr, &sf, &bw_khz) || (sf == 0))
+	{
+		return 1000;
+	}
+	return AIRTIME_RX_WINDOW_SYMBOLS * ((1000UL << sf) / bw_khz);
+}
+
+/**
+ * @brief Receive time of a LoRaWAN TX cycle without downlink
+ *        RX1 is estimated with the uplink data rate, RX2 uses the default data rate of the region
+ *
+ * @return uint32_t receive time of both windows in ms
+ */
+uint32_t airtime_rx_ms(void)
+{
+	uint8_t region = g_lorawan_settings.lora_region;
+	uint8_t rx2_dr = 0;
+	switch (region)
+	{
+	case LORAMAC_REGION_US915:
+	case LORAMAC_REGION_AU915:
+		rx2_dr = 8;
+		break;
+	case LORAMAC_REGION_AS923:
+	case LORAMAC_REGION_AS923_2:
+	case LORAMAC_REGION_AS923_3:
+	case LORAMAC_REGION_AS923_4:
+		rx2_dr = 2;
+		break;
+	default:
+		break;
+	}
+	return (airtime_window_us(region, airtime_dr()) + airtime_window_us(region, rx2_dr) + 999) / 1000;
+}
+
+/**
+ * @brief Output power of the transceiver with the current settings
+ *        LoRaWAN: max EIRP of the region, 2 dB less per TX power index and
+ *        without the antenna gain, as calculated by the LoRaWAN stack
+ *
+ * @return int8_t TX power in dBm
+ */
+int8_t airtime_tx_power(void)
+{
+	int16_t dbm;
+	if (!g_lorawan_settings.lorawan_enable)
+	{
+		dbm = g_lorawan_settings.p2p_tx_power;
+	}
+	else
+	{
+		int16_t max_eirp;
+		switch (g_lorawan_settings.lora_region)
+		{
+		case LORAMAC_REGION_US915:
+		case LORAMAC_REGION_AU915:
+		case LORAMAC_REGION_IN865:
+			max_eirp = 30;
+			break;
+		case LORAMAC_REGION_CN470:
+			max_eirp = 19;
+			break;
+		case LORAMAC_REGION_KR920:
+			max_eirp = 14;
+			break;
+		case LORAMAC_REGION_EU433:
+		case LORAMAC_REGION_CN779:
+			max_eirp = 12;
+			break;
+		default:
+			max_eirp = 16;
+			break;
+		}
+		dbm = max_eirp - 2 * g_lorawan_settings.tx_power - AIRTIME_ANTENNA_GAIN;
+	}
+	dbm = dbm < AIRTIME_TX_POWER_MIN ? AIRTIME_TX_POWER_MIN : dbm;
+	return (int8_t)(dbm > AIRTIME_TX_POWER_MAX ? AIRTIME_TX_POWER_MAX : dbm);
+}
+
+/**
+ * @brief Time-on-air of an application payload with the current settings
+ *
+ * @param len application payload length
+ * @return uint32_t time-on-air in ms, 0 if the data rate is unknown
+ */
+uint32_t airtime_frame_ms(uint8_t len)
+{
+	if (!g_lorawan_settings.lorawan_enable)
+	{
+		uint16_t bw_khz = g_lorawan_settings.p2p_bandwidth == 2 ? 500 : g_lorawan_settings.p2p_bandwidth == 1 ? 250 : 125;
+		return airtime_toa_ms(len, g_lorawan_settings.p2p_sf, bw_khz, g_lorawan_settings.p2p_cr + 1, g_lorawan_settings.p2p_preamble_len);
+	}
+	uint8_t sf;
+	uint16_t bw_khz;
+	if (!airtime_dr_params(g_lorawan_settings.lora_region, airtime_dr(), &sf, &bw_khz))
+	{
+		return 0;
+	}
+	return airtime_toa_ms(len + AIRTIME_LORAWAN_OVERHEAD, sf, bw_khz, 1, AIRTIME_LORAWAN_PREAMBLE);
+}
+
+/**
+ * @brief Refill the token bucket
+ *        The bucket holds the airtime of one duty-cycle window
+ *
+ * @param band band limits
+ */
+static void airtime_refill(airtime_band_s band)
+{
+	uint32_t now = millis();
+	uint32_t capacity = AIRTIME_DUTY_WINDOW / band.duty_div;
+	if (!airtime_bucket.init)
+	{
+		airtime_bucket.tokens_ms = capacity;
+		airtime_bucket.remainder = 0;
+		airtime_bucket.last_fill = now;
+		airtime_bucket.init = true;
+		return;
+	}
+	uint32_t elapsed = now - airtime_bucket.last_fill;
+	airtime_bucket.last_fill = now;
+	uint64_t fill = (uint64_t)elapsed + airtime_bucket.remainder;
+	uint64_t tokens = airtime_bucket.tokens_ms + fill / band.duty_div;
+	airtime_bucket.remainder = fill % band.duty_div;
+	airtime_bucket.tokens_ms = tokens > capacity ? capacity : (uint32_t)tokens;
+}
+
+/**
+ * @brief Time until a frame with the given time-on-air can be sent
+ *        Checks the regulatory budget and the band off time that the
+ *        LoRaWAN stack applies after each uplink if its duty-cycle is enabled
+ *
+ * @param toa_ms time-on-air of the frame
+ * @return uint32_t wait time in ms, 0 if the frame can be sent now,
+ *                  UINT32_MAX if the frame exceeds the dwell time
+ */
+uint32_t airtime_wait_ms(uint32_t toa_ms)
+{
+	airtime_band_s band = airtime_band(g_lorawan_settings.lora_region);
+	if ((band.dwell_ms != 0) && (toa_ms > band.dwell_ms))
+	{
+		return UINT32_MAX;
+	}
+	if (band.duty_div == 0)
+	{
+		return 0;
+	}
+
+	airtime_refill(band);
+	uint32_t wait = 0;
+	if (toa_ms > airtime_bucket.tokens_ms)
+	{
+		wait = (toa_ms - airtime_bucket.tokens_ms) * band.duty_div;
+	}
+	if (airtime_bucket.off_active)
+	{
+		int32_t off_left = (int32_t)(airtime_bucket.off_until - millis());
+		if (off_left <= 0)
+		{
+			airtime_bucket.off_active = false;
+		}
+		else if ((uint32_t)off_left > wait)
+		{
+			wait = off_left;
+		}
+	}
+	return wait;
+}
+
+/**
+ * @brief Charge a sent frame to the budget
+ *
+ * @param toa_ms time-on-air of the frame
+ */
+void airtime_charge(uint32_t toa_ms)
+{
+	airtime_band_s band = airtime_band(g_lorawan_settings.lora_region);
+	if (band.duty_div == 0)
+	{
+		return;
+	}
+	airtime_refill(band);
+	airtime_bucket.tokens_ms = toa_ms < airtime_bucket.tokens_ms ? airtime_bucket.tokens_ms - toa_ms : 0;
+	if (g_lorawan_settings.lorawan_enable && g_lorawan_settings.duty_cycle_enabled)
+	{
+		// Band off time of the LoRaWAN stack, (1 / duty - 1) * time-on-air after the TX
+		airtime_bucket.off_until = millis() + toa_ms * band.duty_div;
+		airtime_bucket.off_active = true;
+	}
+	MYLOG("AIR", "Frame %lu ms, budget left %lu ms", toa_ms, airtime_bucket.tokens_ms);
+}
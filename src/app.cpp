@@ -12,12 +12,16 @@
  */
 
 #include "app.h"
+#include "i2c_async.h"
 
 /** Set the device name, max length is 10 characters */
 char g_ble_dev_name[10] = "RAK-WEA";
 
-/** Packet buffer for sending */
-WisCayenne g_solution_data(255);
+/** Packet buffer for sending, sized at compile time for the largest possible frame */
+WisCayenne g_solution_data(PAYLOAD_MAX_SIZE);
+
+/** Buffer for the hex log of received data, 2 characters per byte + terminator */
+static char rx_log_buff[RX_MAX_SIZE * 2 + 1];
 
 /** Flag showing if TX cycle is ongoing */
 bool lora_busy = false;
@@ -30,6 +34,19 @@ uint8_t send_fail = 0;
 
 /** Flag for low battery protection */
 bool low_batt_protection = false;
+/** State of charge that activates the battery protection in % */
+#define BATT_PROTECT_ON_SOC 5
+/** State of charge that deactivates the battery protection in % */
+#define BATT_PROTECT_OFF_SOC 90
+
+/** Frame waiting for airtime budget */
+static acq_frame_s pending_frame;
+static bool has_pending_frame = false;
+/** Size of the last frame, used to plan the next acquisition */
+static uint8_t last_frame_len = PAYLOAD_SIZE_BATT + PAYLOAD_SIZE_RAK1901 + PAYLOAD_SIZE_RAK1902 + PAYLOAD_SIZE_RAK1903;
+/** Time from acquisition request to the finished frame */
+static uint32_t acq_request_time = 0;
+static uint32_t acq_lead_ms = 0;
 
 /** Flag for temp/humid sensor */
 bool has_rak1901 = false;
@@ -38,14 +55,19 @@ bool has_rak1902 = false;
 /** flag for light sensor */
 bool has_rak1903 = false;
 
+/** Last sensor readings */
+sensor_values_s g_sensor_values;
+
 /**
  * @brief Application specific setup functions
  *
  */
 void setup_app(void)
 {
+#if defined NRF52_SERIES || defined ESP32
 	// Enable BLE
 	g_enable_ble = true;
+#endif
 
 #if API_DEBUG == 0
 	// Initialize Serial for debug output
@@ -67,6 +89,9 @@ void setup_app(void)
 	}
 #endif
 	sprintf(g_custom_fw_ver, "WisBlock Kit 1 V%d.%d.%d", SW_VERSION_1, SW_VERSION_2, SW_VERSION_3);
+
+	// Initialize the user AT commands and read application settings
+	init_user_at();
 }
 
 /**
@@ -79,22 +104,26 @@ bool init_app(void)
 {
 	MYLOG("APP", "init_app");
 
+	// Derive the transmit slot from the DevEUI
+	init_slot();
+
 	bool init_result = true;
 
 	// Reset the packet
 	g_solution_data.reset();
 
-	Wire.begin();
-	Wire.setClock(400000);
+	// I2C transport for the sensors, on the RAK4631 the CPU sleeps during transfers
+	i2c_init(400000);
 
-	for (int adr = 0; adr < 127; adr++)
+#if MY_DEBUG > 0
+	for (uint8_t adr = 1; adr < 127; adr++)
 	{
-		Wire.beginTransmission(adr);
-		if (Wire.endTransmission() == 0)
+		if (i2c_probe(adr))
 		{
 			MYLOG("APP", "Found device on adresse %0X", adr);
 		}
 	}
+#endif
 
 	has_rak1901 = init_th();
 
@@ -132,9 +161,123 @@ bool init_app(void)
 
 	// Disable modules power
 	digitalWrite(WB_IO2, LOW);
+
+	// Add the BLE stream service
+	init_ble_stream();
+
+	// Start the sensor acquisition, on dual-core MCU's it runs on the second core
+	init_acquisition();
 	return init_result;
 }
 
+/**
+ * @brief Send a frame over LoRaWAN or LoRa P2P
+ *        If the airtime budget does not allow to send now, the frame is kept
+ *        and sent by the next timer event
+ *
+ * @param frame encoded frame
+ */
+static void send_frame(acq_frame_s *frame)
+{
+	uint32_t toa_ms = airtime_frame_ms(frame->len);
+	uint32_t wait = airtime_wait_ms(toa_ms);
+	has_pending_frame = false;
+	if (wait == UINT32_MAX)
+	{
+		MYLOG("APP", "Packet error, %ld ms exceeds the dwell time", toa_ms);
+		forecast_resync();
+		return;
+	}
+	if (wait != 0)
+	{
+		MYLOG("APP", "Airtime budget exhausted, send in %ld ms", wait);
+		if (frame != &pending_frame)
+		{
+			memcpy(&pending_frame, frame, sizeof(acq_frame_s));
+		}
+		has_pending_frame = true;
+		api_timer_restart(wait);
+		return;
+	}
+
+	if (g_lorawan_settings.lorawan_enable)
+	{
+		// Request the network time with this uplink if a sync is due
+		timesync_request();
+
+		// Enqueue the packet
+		lmh_error_status result = send_lora_packet(frame->data, frame->len);
+		switch (result)
+		{
+		case LMH_SUCCESS:
+			MYLOG("APP", "Packet enqueued");
+			/// \todo set a flag that TX cycle is running
+			lora_busy = true;
+			batt_radio_tx(toa_ms);
+			airtime_charge(toa_ms);
+			timesync_uplink(toa_ms);
+#if defined NRF52_SERIES
+			if (g_ble_uart_is_connected)
+			{
+				g_ble_uart.println("Packet enqueued");
+			}
+#endif
+			break;
+		case LMH_BUSY:
+			MYLOG("APP", "LoRa transceiver is busy");
+			forecast_resync();
+#if defined NRF52_SERIES
+			if (g_ble_uart_is_connected)
+			{
+				g_ble_uart.println("LoRa transceiver is busy");
+			}
+#endif
+			break;
+		case LMH_ERROR:
+			MYLOG("APP", "Packet error, too big to send with current DR");
+			forecast_resync();
+#if defined NRF52_SERIES
+			if (g_ble_uart_is_connected)
+			{
+				g_ble_uart.println("Packet error, too big to send with current DR");
+			}
+#endif
+			break;
+		}
+	}
+	else
+	{
+		// Send packet over LoRa if the channel is free
+		uint32_t backoff = p2p_send(frame, toa_ms);
+		if (backoff == 0)
+		{
+			MYLOG("APP", "P2P packet enqueued");
+			batt_radio_tx(toa_ms);
+			airtime_charge(toa_ms);
+			if (frame != &pending_frame)
+			{
+				// Kept for the repetition if the ACK does not arrive
+				memcpy(&pending_frame, frame, sizeof(acq_frame_s));
+			}
+		}
+		else if (backoff == UINT32_MAX)
+		{
+			MYLOG("APP", "P2P packet not sent");
+			forecast_resync();
+		}
+		else
+		{
+			// Channel busy, the frame is sent by the next timer event
+			if (frame != &pending_frame)
+			{
+				memcpy(&pending_frame, frame, sizeof(acq_frame_s));
+			}
+			has_pending_frame = true;
+			api_timer_restart(backoff);
+		}
+	}
+}
+
 /**
  * @brief Application specific event handler
  *        Requires as minimum the handling of STATUS event
@@ -148,115 +291,98 @@ void app_event_handler(void)
 		g_task_event_type &= N_STATUS;
 		MYLOG("APP", "Timer wakeup");
 
-		// Enable modules power
-		digitalWrite(WB_IO2, HIGH);
+		// Align the next wakeup with the transmit slot of this device
+		slot_timer_restart(low_batt_protection ? BATT_PROTECT_INTERVAL : g_lorawan_settings.send_repeat_time);
 
+#if defined NRF52_SERIES || defined ESP32
 		// If BLE is enabled, restart Advertising
 		if (g_enable_ble)
 		{
 			restart_advertising(15);
 		}
-
-		// Reset the packet
-		g_solution_data.reset();
+#endif
 
 		if (lora_busy)
 		{
 			MYLOG("APP", "LoRaWAN TX cycle not finished, skip this event");
+#if defined NRF52_SERIES
 			if (g_ble_uart_is_connected)
 			{
 				g_ble_uart.println("LoRaWAN TX cycle not finished, skip this event");
 			}
+#endif
+		}
+		else if (has_pending_frame)
+		{
+			// Frame that was waiting for airtime budget, a free P2P channel or its ACK
+			send_frame(&pending_frame);
 		}
 		else
 		{
-			if (!low_batt_protection)
+			// Start the acquisition so that the frame is ready when the airtime budget allows to send it
+			uint32_t wait = airtime_wait_ms(airtime_frame_ms(last_frame_len));
+			if ((wait != UINT32_MAX) && (wait > acq_lead_ms))
 			{
-				if (has_rak1901)
-				{
-					// Read temperature and humidity
-					read_th();
-				}
-				if (has_rak1902)
-				{
-					// Read air pressure
-					read_press();
-				}
-				if (has_rak1903)
-				{
-					// Read luminosity
-					read_light();
-				}
+				MYLOG("APP", "Airtime budget exhausted, acquisition in %ld ms", wait - acq_lead_ms);
+				api_timer_restart(wait - acq_lead_ms);
 			}
+			else if (request_acquisition(!low_batt_protection))
+			{
+				acq_request_time = millis();
+			}
+			else
+			{
+				MYLOG("APP", "Acquisition not finished, skip this event");
+			}
+		}
+	}
 
-			// Get battery level
-			float batt_level_f = read_batt();
-			g_solution_data.addVoltage(LPP_CHANNEL_BATT, batt_level_f / 1000.0);
+	// Sensor acquisition finished
+	if ((g_task_event_type & ACQ_DONE) == ACQ_DONE)
+	{
+		g_task_event_type &= N_ACQ_DONE;
+		acq_lead_ms = millis() - acq_request_time;
+		slot_set_lead(acq_lead_ms + airtime_frame_ms(last_frame_len));
 
-			// Protection against battery drain
-			if (batt_level_f < 2900)
+		acq_frame_s frame;
+		while (get_acquisition(&frame))
+		{
+			// Protection against battery drain, on the filtered voltage
+			uint8_t batt_soc_pct = batt_soc(frame.batt_mv);
+			if ((batt_soc_pct <= BATT_PROTECT_ON_SOC) && !low_batt_protection)
 			{
 				// Battery is very low, change send time to 1 hour to protect battery
-				low_batt_protection = true;			   // Set low_batt_protection active
-				api_timer_restart(1 * 60 * 60 * 1000); // Set send time to one hour
+				low_batt_protection = true;				   // Set low_batt_protection active
+				slot_timer_restart(BATT_PROTECT_INTERVAL); // Set send time to one hour
 				MYLOG("APP", "Battery protection activated");
 			}
-			else if ((batt_level_f > 4100) && low_batt_protection)
+			else if ((batt_soc_pct >= BATT_PROTECT_OFF_SOC) && low_batt_protection)
 			{
-				// Battery is higher than 4V, change send time back to original setting
+				// Battery is charged again, change send time back to original setting
 				low_batt_protection = false;
-				api_timer_restart(g_lorawan_settings.send_repeat_time);
+				slot_timer_restart(g_lorawan_settings.send_repeat_time);
 				MYLOG("APP", "Battery protection deactivated");
 			}
 
-			if (g_lorawan_settings.lorawan_enable)
-			{
-				// Enqueue the packet
-				lmh_error_status result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
-				switch (result)
-				{
-				case LMH_SUCCESS:
-					MYLOG("APP", "Packet enqueued");
-					/// \todo set a flag that TX cycle is running
-					lora_busy = true;
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.println("Packet enqueued");
-					}
-					break;
-				case LMH_BUSY:
-					MYLOG("APP", "LoRa transceiver is busy");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.println("LoRa transceiver is busy");
-					}
-					break;
-				case LMH_ERROR:
-					MYLOG("APP", "Packet error, too big to send with current DR");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.println("Packet error, too big to send with current DR");
-					}
-					break;
-				}
-			}
-			else
+			if (!frame.send)
 			{
-				g_solution_data.addDevID(0, &g_lorawan_settings.node_device_eui[4]);
-
-				// Send packet over LoRa
-				if (send_p2p_packet(g_solution_data.getBuffer(), g_solution_data.getSize()))
-				{
-					MYLOG("APP", "P2P packet enqueued");
-				}
-				else
-				{
-					MYLOG("APP", "P2P packet too big");
-				}
+				MYLOG("APP", "Values match the forecast, frame not sent");
+				continue;
 			}
+			// Measurement time, the frame may wait for airtime or be retransmitted
+			timesync_stamp(&frame);
+			// LoRa P2P sequence number if ACKs are requested
+			p2p_stamp(&frame);
+			last_frame_len = frame.len;
+			send_frame(&frame);
 		}
-		// Disable modules power
-		digitalWrite(WB_IO2, LOW);
+	}
+
+	// BLE stream sample event
+	if ((g_task_event_type & BLE_STREAM) == BLE_STREAM)
+	{
+		g_task_event_type &= N_BLE_STREAM;
+		ble_stream_handler();
 	}
 }
 
@@ -266,6 +392,7 @@ void app_event_handler(void)
  */
 void ble_data_handler(void)
 {
+#if defined NRF52_SERIES
 	if (g_enable_ble)
 	{
 		// BLE UART data handling
@@ -283,6 +410,7 @@ void ble_data_handler(void)
 			at_serial_input(uint8_t('\n'));
 		}
 	}
+#endif
 }
 
 /**
@@ -300,6 +428,9 @@ void lora_data_handler(void)
 		{
 			MYLOG("APP", "Successfully joined network");
 			AT_PRINTF("+EVT:JOINED");
+
+			// Start sending in the transmit slot of this device
+			slot_timer_restart(g_lorawan_settings.send_repeat_time);
 		}
 		else
 		{
@@ -308,11 +439,13 @@ void lora_data_handler(void)
 			/// \todo here join could be restarted.
 			lmh_join();
 
+#if defined NRF52_SERIES || defined ESP32
 			// If BLE is enabled, restart Advertising
 			if (g_enable_ble)
 			{
 				restart_advertising(15);
 			}
+#endif
 		}
 	}
 
@@ -325,6 +458,10 @@ void lora_data_handler(void)
 
 		if (g_lorawan_settings.lorawan_enable)
 		{
+			// DeviceTimeAns arrives with the downlink of the TX cycle
+			timesync_tx_finished();
+			batt_radio_rx(airtime_rx_ms());
+
 			if (g_lorawan_settings.confirmed_msg_enabled == LMH_UNCONFIRMED_MSG)
 			{
 				AT_PRINTF("+EVT:TX_DONE");
@@ -332,20 +469,39 @@ void lora_data_handler(void)
 			else
 			{
 				AT_PRINTF("+EVT:%s", g_rx_fin_result ? "SEND_CONFIRMED_OK" : "SEND_CONFIRMED_FAILED");
+				if (!g_rx_fin_result)
+				{
+					// The uplink or its ACK collided, the same slot would collide again
+					slot_move();
+					slot_timer_restart(low_batt_protection ? BATT_PROTECT_INTERVAL : g_lorawan_settings.send_repeat_time);
+				}
 			}
 		}
 		else
 		{
 			AT_PRINTF("+EVT:TXP2P_DONE");
+
+			// Repeat the frame if the ACK does not arrive in time
+			uint32_t ack_wait = p2p_tx_finished(airtime_frame_ms(pending_frame.len));
+			if (ack_wait != 0)
+			{
+				has_pending_frame = true;
+				api_timer_restart(ack_wait);
+			}
 		}
 
+#if defined NRF52_SERIES
 		if (g_ble_uart_is_connected)
 		{
 			g_ble_uart.printf("%s TX cycle %s", g_lorawan_settings.lorawan_enable ? "LoRaWAN" : "LoRa", g_rx_fin_result ? "finished ACK" : "failed NAK");
 		}
+#endif
 
 		if (!g_rx_fin_result)
 		{
+			// The backend may have missed the frame, restart the forecast with the next frame
+			forecast_resync();
+
 			// Increase fail send counter
 			send_fail++;
 
@@ -371,39 +527,68 @@ void lora_data_handler(void)
 		/**************************************************************/
 		g_task_event_type &= N_LORA_DATA;
 		MYLOG("APP", "Received package over LoRa");
-		char log_buff[g_rx_data_len * 3] = {0};
-		uint8_t log_idx = 0;
-		for (int idx = 0; idx < g_rx_data_len; idx++)
+		// g_rx_data_len comes from the radio, never trust it to fit the log buffer
+		uint16_t rx_len = g_rx_data_len < RX_MAX_SIZE ? g_rx_data_len : RX_MAX_SIZE;
+		uint16_t log_idx = 0;
+		for (int idx = 0; idx < rx_len; idx++)
 		{
-			sprintf(&log_buff[log_idx], "%02X ", g_rx_lora_data[idx]);
-			log_idx += 3;
-		}
-		lora_busy = false;
-		MYLOG("APP", "%s", log_buff);
-
-		log_idx = 0;
-		for (int idx = 0; idx < g_rx_data_len; idx++)
-		{
-			sprintf(&log_buff[log_idx], "%02X", g_rx_lora_data[idx]);
+			sprintf(&rx_log_buff[log_idx], "%02X", g_rx_lora_data[idx]);
 			log_idx += 2;
 		}
+		rx_log_buff[log_idx] = 0;
+		lora_busy = false;
+		MYLOG("APP", "%s", rx_log_buff);
 
 		if (g_lorawan_settings.lorawan_enable)
 		{
-			AT_PRINTF("+EVT:RX_1:%d:%d:UNICAST:%d:%s", g_last_rssi, g_last_snr, g_last_fport, log_buff);
+			AT_PRINTF("+EVT:RX_1:%d:%d:UNICAST:%d:%s", g_last_rssi, g_last_snr, g_last_fport, rx_log_buff);
+
+			if (g_last_fport == OTA_DELTA_FPORT)
+			{
+				// Fragment of a delta firmware update
+				ota_delta_rx(g_rx_lora_data, rx_len);
+			}
+			else if (g_last_fport == TIME_FPORT)
+			{
+				// Network time fallback if DeviceTimeReq is not answered
+				timesync_rx(g_rx_lora_data, rx_len);
+			}
+			else if ((g_last_fport == PROFILE_FPORT) && (rx_len == 1))
+			{
+				// Measurement profile, used from the next acquisition
+				if (set_profile(g_rx_lora_data[0]))
+				{
+					save_app_settings();
+					AT_PRINTF("+EVT:PROFILE:%d", g_rx_lora_data[0]);
+				}
+			}
 		}
 		else
 		{
-			AT_PRINTF("+EVT:RXP2P:%d:%d:%s", g_last_rssi, g_last_snr, log_buff);
+			switch (p2p_rx(g_rx_lora_data, rx_len))
+			{
+			case P2P_RX_ACK:
+				// Frame delivered, back to the transmit slot
+				has_pending_frame = false;
+				slot_timer_restart(low_batt_protection ? BATT_PROTECT_INTERVAL : g_lorawan_settings.send_repeat_time);
+				break;
+			case P2P_RX_DATA:
+				AT_PRINTF("+EVT:RXP2P:%d:%d:%s", g_last_rssi, g_last_snr, rx_log_buff);
+				break;
+			default:
+				break;
+			}
 		}
 
+#if defined NRF52_SERIES
 		if (g_ble_uart_is_connected && g_enable_ble)
 		{
-			for (int idx = 0; idx < g_rx_data_len; idx++)
+			for (int idx = 0; idx < rx_len; idx++)
 			{
 				g_ble_uart.printf("%02X ", g_rx_lora_data[idx]);
 			}
 			g_ble_uart.println("");
 		}
+#endif
 	}
 }
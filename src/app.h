@@ -48,23 +48,233 @@ void lora_data_handler(void);
 /** Application stuff */
 extern BaseType_t g_higher_priority_task_woken;
 
+/** Application events */
+#define BLE_STREAM 0b0000000100000000
+#define N_BLE_STREAM 0b1111111011111111
+#define ACQ_DONE 0b0000001000000000
+#define N_ACQ_DONE 0b1111110111111111
+
 // LoRaWan functions
 #include "wisblock_cayenne.h"
+#include "p2p_mac.h"
 // Cayenne LPP Channel numbers per sensor value
 #define LPP_CHANNEL_BATT 1	  // Base Board
 #define LPP_CHANNEL_HUMID 2			   // RAK1901
 #define LPP_CHANNEL_TEMP 3			   // RAK1901
 #define LPP_CHANNEL_PRESS 4			   // RAK1902
 #define LPP_CHANNEL_LIGHT 5			   // RAK1903
+// 6 to 8 are LPP_CHANNEL_HUMID_2, LPP_CHANNEL_TEMP_2 and LPP_CHANNEL_PRESS_2 of WisBlock-API-V2, pressure is sent on 8
+#define LPP_CHANNEL_BURST_P_MEAN 11	   // Burst
+#define LPP_CHANNEL_BURST_P_MIN 12	   // Burst
+#define LPP_CHANNEL_BURST_P_MAX 13	   // Burst
+#define LPP_CHANNEL_BURST_P_STD 14	   // Burst
+#define LPP_CHANNEL_BURST_P_BAND 15	   // Burst, 4 channels 15 to 18
+#define LPP_CHANNEL_BURST_L_MEAN 19	   // Burst
+#define LPP_CHANNEL_BURST_L_MIN 20	   // Burst
+#define LPP_CHANNEL_BURST_L_MAX 21	   // Burst
+#define LPP_CHANNEL_BURST_L_STD 22	   // Burst
+#define LPP_CHANNEL_BATT_RUNTIME 23	   // Battery
+#define LPP_CHANNEL_PROFILE 24		   // Measurement profile
+#define LPP_CHANNEL_FC_STEPS 25		   // Forecast, frames since the last sent frame
+#define LPP_CHANNEL_TIME 26			   // Measurement time, Unix time in s (LPP_UNIXTIME)
+#define LPP_CHANNEL_TIME_REQ 27		   // Time request, sequence number echoed in the time downlink
+#define LPP_CHANNEL_SENSOR_ERR 28	   // Sensors that were found but could not be read, SENSOR_ERR_xxx
+#define LPP_CHANNEL_P2P_SEQ 29		   // LoRa P2P sequence number, the collector sends an ACK
+#define LPP_CHANNEL_DEW_POINT 30	   // Derived
+#define LPP_CHANNEL_ABS_HUMID 31	   // Derived
+#define LPP_CHANNEL_ALTITUDE 32		   // Derived
+#define LPP_CHANNEL_TENDENCY 33		   // Derived
+#define LPP_CHANNEL_PRESS_DELTA 34	   // Derived
+
+/** Bits of LPP_CHANNEL_SENSOR_ERR, the reading is missing in the frame */
+#define SENSOR_ERR_RAK1901 0x01
+#define SENSOR_ERR_RAK1902 0x02
+#define SENSOR_ERR_RAK1903 0x04
+
+/** Size of one Cayenne LPP entry, channel + type + data */
+#define LPP_ENTRY_SIZE(data_size) (2 + (data_size))
+/** Size of the device ID added by WisCayenne::addDevID() */
+#define LPP_DEVID_DATA_SIZE 4
+
+/** Payload size per sensor group */
+#define PAYLOAD_SIZE_BATT (LPP_ENTRY_SIZE(LPP_VOLTAGE_SIZE) + LPP_ENTRY_SIZE(LPP_ANALOG_INPUT_SIZE))
+#define PAYLOAD_SIZE_RAK1901 (LPP_ENTRY_SIZE(LPP_RELATIVE_HUMIDITY_SIZE) + LPP_ENTRY_SIZE(LPP_TEMPERATURE_SIZE))
+#define PAYLOAD_SIZE_RAK1902 LPP_ENTRY_SIZE(LPP_BAROMETRIC_PRESSURE_SIZE)
+#define PAYLOAD_SIZE_RAK1903 LPP_ENTRY_SIZE(LPP_LUMINOSITY_SIZE)
+#define PAYLOAD_SIZE_DEVID LPP_ENTRY_SIZE(LPP_DEVID_DATA_SIZE)
+#define PAYLOAD_SIZE_PROFILE LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE)
+#define PAYLOAD_SIZE_FORECAST LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE)
+#define PAYLOAD_SIZE_TIME LPP_ENTRY_SIZE(LPP_UNIXTIME_SIZE)
+#define PAYLOAD_SIZE_TIME_REQ LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE)
+#define PAYLOAD_SIZE_SENSOR_ERR LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE)
+#define PAYLOAD_SIZE_P2P_SEQ LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE)
+#define PAYLOAD_SIZE_DERIVED (LPP_ENTRY_SIZE(LPP_TEMPERATURE_SIZE) + 2 * LPP_ENTRY_SIZE(LPP_ANALOG_INPUT_SIZE) + \
+							  LPP_ENTRY_SIZE(LPP_ALTITUDE_SIZE) + LPP_ENTRY_SIZE(LPP_DIGITAL_INPUT_SIZE))
+#define PAYLOAD_SIZE_BURST (LPP_ENTRY_SIZE(LPP_BAROMETRIC_PRESSURE_SIZE) + 7 * LPP_ENTRY_SIZE(LPP_ANALOG_INPUT_SIZE) + \
+							4 * LPP_ENTRY_SIZE(LPP_LUMINOSITY_SIZE))
+
+/** Largest frame the application can create */
+#define PAYLOAD_MAX_SIZE (PAYLOAD_SIZE_BATT + PAYLOAD_SIZE_RAK1901 + PAYLOAD_SIZE_RAK1902 + PAYLOAD_SIZE_RAK1903 + \
+						  PAYLOAD_SIZE_DEVID + PAYLOAD_SIZE_DERIVED + PAYLOAD_SIZE_BURST + PAYLOAD_SIZE_PROFILE + \
+						  PAYLOAD_SIZE_FORECAST + PAYLOAD_SIZE_TIME + PAYLOAD_SIZE_TIME_REQ + PAYLOAD_SIZE_SENSOR_ERR + \
+						  PAYLOAD_SIZE_P2P_SEQ)
+static_assert(PAYLOAD_MAX_SIZE <= 242, "Payload does not fit into the largest LoRaWAN frame");
+
+/** Largest received packet that is handled, longer packets are truncated */
+#define RX_MAX_SIZE 255
 
 extern WisCayenne g_solution_data;
 
+/** Encoded frame from the sensor acquisition */
+struct acq_frame_s
+{
+	uint8_t data[PAYLOAD_MAX_SIZE];
+	uint8_t len;
+	uint16_t batt_mv;
+	bool send;		  // false if the values are within their forecast
+	uint32_t time_ms; // millis() of the measurement
+};
+
+/** Sensor acquisition */
+void init_acquisition(void);
+bool request_acquisition(bool read_sensors);
+bool get_acquisition(acq_frame_s *frame);
+
+/** Last sensor readings in fixed-point, used for derived values */
+struct sensor_values_s
+{
+	int16_t temp_x10 = 0;	  // Temperature in 1/10 degC
+	uint16_t humid_x2 = 0;	  // Relative humidity in 1/2 %
+	uint16_t press_x10 = 0;	  // Pressure in 1/10 hPa
+	bool th_valid = false;	  // Temperature and humidity valid
+	bool press_valid = false; // Pressure valid
+	bool light_valid = false; // Light valid
+};
+extern sensor_values_s g_sensor_values;
+
+/** Application settings, saved in flash
+ *  New fields are added at the end and increment APP_SETTINGS_LAYOUT in user_at.cpp */
+struct app_settings_s
+{
+	uint8_t valid_mark;	 // Marker for valid settings
+	uint8_t layout;		 // Layout of the saved settings, APP_SETTINGS_LAYOUT
+	bool derived_enable; // Send derived values
+	uint16_t qnh_x10;	 // Sea level pressure in 1/10 hPa
+	bool burst_enable;	 // Send burst capture summary
+	uint8_t profile;	 // Measurement precision profile
+	bool forecast_enable; // Suppress frames that match the forecast
+	uint8_t p2p_ack;	  // LoRa P2P ACK mode, p2p_ack_mode_e
+};
+extern app_settings_s g_app_settings;
+/** Copy of g_app_settings taken with each acquisition request, used by the acquisition side */
+extern app_settings_s g_acq_settings;
+
+/** User AT commands and settings */
+void init_user_at(void);
+void read_app_settings(void);
+bool save_app_settings(void);
+
+/** Derived values */
+void add_press_history(uint16_t press_x10);
+void add_derived_values(void);
+
+/** Burst capture */
+void read_burst(void);
+
+/** BLE live stream */
+void init_ble_stream(void);
+void ble_stream_handler(void);
+bool ble_stream_resume(void);
+
+/** Measurement precision profiles */
+#define PROFILE_ULP 0
+#define PROFILE_BALANCED 1
+#define PROFILE_PRECISION 2
+#define PROFILE_NUM 3
+/** LoRaWAN port to select the profile, 1 byte profile ID */
+#define PROFILE_FPORT 21
+
+/** Sensor settings of a profile */
+struct sensor_profile_s
+{
+	bool shtc3_low_power;	  // SHTC3 low power measurement
+	bool opt3001_800ms;		  // OPT3001 800 ms conversion time, 100 ms if false and during burst capture
+	bool lps22hb_low_current; // LPS22HB low-current mode, low-noise if false
+	uint8_t lps22hb_samples;  // Averaged LPS22HB conversions
+	uint16_t settle_ms;		  // Wait after the sensors are powered
+};
+const sensor_profile_s *get_profile(void);
+bool set_profile(uint8_t profile);
+void apply_profile(void);
+
+/** Forecast based uplink suppression */
+bool forecast_check(bool confirmed, bool has_values);
+void forecast_resync(void);
+
+/** Network time sync and measurement timestamps */
+void timesync_request(void);
+void timesync_uplink(uint32_t toa_ms);
+void timesync_tx_finished(void);
+void timesync_rx(uint8_t *data, uint16_t len);
+bool timesync_set(uint32_t unix_s);
+bool timesync_get(uint32_t *unix_s, int32_t *drift_ppb);
+void timesync_stamp(acq_frame_s *frame);
+/** LoRaWAN port of the time downlink, Unix time of the last uplink reception */
+#define TIME_FPORT 22
+
+/** LoRa P2P listen-before-talk and ACKs */
+void p2p_stamp(acq_frame_s *frame);
+uint32_t p2p_send(acq_frame_s *frame, uint32_t toa_ms);
+uint32_t p2p_tx_finished(uint32_t toa_ms);
+p2p_rx_e p2p_rx(uint8_t *data, uint16_t len);
+
+/** Delta firmware update */
+void ota_delta_rx(uint8_t *data, uint16_t len);
+/** LoRaWAN port for delta firmware fragments */
+#define OTA_DELTA_FPORT 20
+
+/** Battery */
+uint16_t measure_batt(void);
+uint8_t batt_soc(uint16_t batt_mv);
+void batt_radio_tx(uint32_t toa_ms);
+void batt_radio_rx(uint32_t rx_ms);
+void batt_active_time(uint32_t active_ms);
+void add_batt_runtime(uint16_t batt_mv);
+
+/** Airtime budget */
+uint32_t airtime_frame_ms(uint8_t len);
+uint32_t airtime_rx_ms(void);
+int8_t airtime_tx_power(void);
+uint32_t airtime_wait_ms(uint32_t toa_ms);
+void airtime_charge(uint32_t toa_ms);
+
+/** Transmit slot scheduling */
+void init_slot(void);
+void slot_timer_restart(uint32_t interval);
+void slot_set_lead(uint32_t lead_ms);
+void slot_move(void);
+uint64_t get_uptime(void);
+/** Send interval while the battery protection is active (1 hour) */
+#define BATT_PROTECT_INTERVAL (1 * 60 * 60 * 1000)
+
+/** Sensor flags */
+extern bool has_rak1901;
+extern bool has_rak1902;
+extern bool has_rak1903;
+
 /** Sensor functions */
 bool init_th(void);
 void read_th(void);
+bool read_th_sample(int16_t *temp_x10, uint8_t *humid_x2);
 bool init_press(void);
 void read_press(void);
 bool init_light(void);
 void read_light();
+void start_press_burst(void);
+bool read_press_sample(float *value);
+void stop_press_burst(void);
+void start_light_burst(void);
+bool read_light_sample(float *value);
+void stop_light_burst(void);
 
 #endif
\ No newline at end of file
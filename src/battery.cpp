@@ -0,0 +1,241 @@
+/**
+ * @file battery.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Battery voltage filtering, state of charge and runtime estimation
+ *        The voltage is sampled at the start of a measurement cycle, with
+ *        sensors powered off and the radio idle, so it does not sag under load
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <atomic>
+
+/** ADC readings per battery measurement */
+#define BATT_OVERSAMPLE 16
+/** Voltage step that resets the filter (charger plugged in or removed) in mV */
+#define BATT_STEP_RESET 200
+/** Filter weight of a new voltage reading, 1/2^n */
+#define BATT_FILTER_SHIFT 2
+/** Filter weight of a new cycle current, 1/2^n */
+#define BATT_CURRENT_SHIFT 3
+
+/** Battery capacity in mAh */
+#ifndef BATT_CAPACITY_MAH
+#define BATT_CAPACITY_MAH 3200
+#endif
+/** Average currents of the device states in uA */
+#define BATT_I_SLEEP_UA 40
+#define BATT_I_ACTIVE_UA 6000
+/** SX1262 receive current in uA (DC-DC, 125 kHz) */
+#define BATT_I_RX_UA 4600
+
+/** SX1262 TX current in uA, PA set up for +22 dBm as done by the SX126x library (datasheet) */
+static const int8_t batt_tx_dbm[4] = {22, 20, 17, 14};
+static const uint32_t batt_tx_ua[4] = {118000, 102000, 95000, 90000};
+
+/** LiPo open circuit voltage in mV for 100 % to 0 % in 10 % steps */
+static const uint16_t batt_curve[11] = {4200, 4060, 3980, 3920, 3870, 3820, 3790, 3770, 3740, 3680, 3300};
+
+/** Filtered voltage in 1/16 mV, 0 until the first measurement */
+static uint32_t batt_mv_x16 = 0;
+/** Filtered average current in uA, 0 until the first full cycle */
+static uint32_t batt_current_ua = 0;
+
+/** Start of the current measurement cycle */
+static uint32_t batt_cycle_start = 0;
+/** Active (MCU and sensors) time of the current cycle in ms */
+static uint32_t batt_active_ms = 0;
+/** Total radio charge in uA * ms, wraps around, only written by the LoRa task, read by the acquisition */
+static std::atomic<uint32_t> batt_radio_total(0);
+/** Radio charge already counted in earlier cycles */
+static uint32_t batt_radio_counted = 0;
+
+/**
+ * @brief Oversample the battery voltage, the highest and lowest reading are dropped
+ *
+ * @return uint32_t battery voltage in mV
+ */
+static uint32_t read_batt_oversampled(void)
+{
+	uint32_t sum = 0;
+	uint32_t min_mv = UINT32_MAX;
+	uint32_t max_mv = 0;
+	for (uint8_t idx = 0; idx < BATT_OVERSAMPLE; idx++)
+	{
+		uint32_t sample = (uint32_t)read_batt();
+		sum += sample;
+		min_mv = sample < min_mv ? sample : min_mv;
+		max_mv = sample > max_mv ? sample : max_mv;
+	}
+	return (sum - min_mv - max_mv) / (BATT_OVERSAMPLE - 2);
+}
+
+/**
+ * @brief Measure the battery and update the filtered voltage
+ *        Call at the start of the measurement cycle, before sensors are powered
+ *
+ * @return uint16_t filtered battery voltage in mV
+ */
+uint16_t measure_batt(void)
+{
+	uint32_t sample_x16 = read_batt_oversampled() * 16;
+	uint32_t step = sample_x16 > batt_mv_x16 ? sample_x16 - batt_mv_x16 : batt_mv_x16 - sample_x16;
+	if ((batt_mv_x16 == 0) || (step > BATT_STEP_RESET * 16))
+	{
+		batt_mv_x16 = sample_x16;
+	}
+	else
+	{
+		batt_mv_x16 = batt_mv_x16 - (batt_mv_x16 >> BATT_FILTER_SHIFT) + (sample_x16 >> BATT_FILTER_SHIFT);
+	}
+	return (uint16_t)(batt_mv_x16 / 16);
+}
+
+/**
+ * @brief State of charge from the discharge curve
+ *
+ * @param batt_mv battery voltage in mV
+ * @return uint8_t state of charge in %
+ */
+uint8_t batt_soc(uint16_t batt_mv)
+{
+	if (batt_mv >= batt_curve[0])
+	{
+		return 100;
+	}
+	for (uint8_t idx = 1; idx < 11; idx++)
+	{
+		if (batt_mv >= batt_curve[idx])
+		{
+			// Linear between the two points of the curve
+			uint16_t span = batt_curve[idx - 1] - batt_curve[idx];
+			return (uint8_t)((10 - idx) * 10 + ((batt_mv - batt_curve[idx]) * 10 + span / 2) / span);
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief TX current at an output power, interpolated in the datasheet table
+ *        Below +14 dBm the PA bias dominates, the +14 dBm current is used
+ *
+ * @param dbm output power in dBm
+ * @return uint32_t TX current in uA
+ */
+static uint32_t batt_tx_current(int8_t dbm)
+{
+	if (dbm >= batt_tx_dbm[0])
+	{
+		return batt_tx_ua[0];
+	}
+	for (uint8_t idx = 1; idx < 4; idx++)
+	{
+		if (dbm >= batt_tx_dbm[idx])
+		{
+			return batt_tx_ua[idx] + (batt_tx_ua[idx - 1] - batt_tx_ua[idx]) * (dbm - batt_tx_dbm[idx]) / (batt_tx_dbm[idx - 1] - batt_tx_dbm[idx]);
+		}
+	}
+	return batt_tx_ua[3];
+}
+
+/**
+ * @brief Add the charge of a sent frame
+ *        Called from the LoRa task
+ *
+ * @param toa_ms time-on-air of the frame
+ */
+void batt_radio_tx(uint32_t toa_ms)
+{
+	uint32_t charge = toa_ms * batt_tx_current(airtime_tx_power());
+	batt_radio_total.store(batt_radio_total.load(std::memory_order_relaxed) + charge, std::memory_order_release);
+}
+
+/**
+ * @brief Add the charge of the receive windows of a TX cycle
+ *        Called from the LoRa task
+ *
+ * @param rx_ms receive time in ms
+ */
+void batt_radio_rx(uint32_t rx_ms)
+{
+	batt_radio_total.store(batt_radio_total.load(std::memory_order_relaxed) + rx_ms * BATT_I_RX_UA, std::memory_order_release);
+}
+
+/**
+ * @brief Add the active time of the acquisition
+ *
+ * @param active_ms active time in ms
+ */
+void batt_active_time(uint32_t active_ms)
+{
+	batt_active_ms += active_ms;
+}
+
+/**
+ * @brief Close the measurement cycle and update the average current
+ *        Charge of the cycle from the measured active time and the charge of the
+ *        sent frames. In LoRa P2P mode the radio listens between the frames
+ *
+ */
+static void batt_close_cycle(void)
+{
+	uint32_t now = millis();
+	uint32_t cycle_ms = now - batt_cycle_start;
+	uint32_t radio_total = batt_radio_total.load(std::memory_order_acquire);
+	uint32_t radio_charge = radio_total - batt_radio_counted;
+	batt_radio_counted = radio_total;
+	uint32_t active_ms = batt_active_ms;
+	batt_active_ms = 0;
+
+	bool first = (batt_cycle_start == 0);
+	batt_cycle_start = now;
+	if (first || (cycle_ms == 0) || (active_ms > cycle_ms))
+	{
+		return;
+	}
+
+	// Charge in uA * ms
+	uint32_t idle_ua = g_lorawan_settings.lorawan_enable ? BATT_I_SLEEP_UA : BATT_I_SLEEP_UA + BATT_I_RX_UA;
+	uint64_t charge = (uint64_t)active_ms * BATT_I_ACTIVE_UA + radio_charge + (uint64_t)(cycle_ms - active_ms) * idle_ua;
+	uint32_t cycle_ua = (uint32_t)(charge / cycle_ms);
+	if (batt_current_ua == 0)
+	{
+		batt_current_ua = cycle_ua;
+	}
+	else
+	{
+		batt_current_ua = batt_current_ua - (batt_current_ua >> BATT_CURRENT_SHIFT) + (cycle_ua >> BATT_CURRENT_SHIFT);
+	}
+	MYLOG("BATT", "Cycle %lu ms, active %lu ms, radio %lu uAs, average %lu uA", cycle_ms, active_ms, radio_charge / 1000, batt_current_ua);
+}
+
+/**
+ * @brief Add the estimated remaining runtime in days to the payload
+ *        Called at the end of the acquisition, nothing is added until the
+ *        first full cycle was measured
+ *
+ * @param batt_mv filtered battery voltage in mV
+ */
+void add_batt_runtime(uint16_t batt_mv)
+{
+	batt_close_cycle();
+	if (batt_current_ua == 0)
+	{
+		return;
+	}
+	// Remaining charge in uAh, the capacity is derated below 0 degC
+	uint32_t remaining_uah = (uint32_t)batt_soc(batt_mv) * BATT_CAPACITY_MAH * 10;
+	if (g_sensor_values.th_valid && (g_sensor_values.temp_x10 < 0))
+	{
+		remaining_uah = remaining_uah / 10 * 8;
+	}
+	uint32_t runtime_h = remaining_uah / batt_current_ua;
+	float runtime_d = runtime_h / 24.0;
+	// Largest value of the LPP analog input
+	runtime_d = runtime_d > 327.0 ? 327.0 : runtime_d;
+	MYLOG("BATT", "%d mV, SoC %d %%, runtime %lu h", batt_mv, batt_soc(batt_mv), runtime_h);
+	g_solution_data.addAnalogInput(LPP_CHANNEL_BATT_RUNTIME, runtime_d);
+}
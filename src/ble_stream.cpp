@@ -0,0 +1,336 @@
+/**
+ * @file ble_stream.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Binary live streaming of sensor values over a BLE characteristic
+ *        Used during installation to position the enclosure.
+ *        The BLE callbacks run on the Bluefruit task, they only post a request.
+ *        Sensor power and I2C are only used on the app task (ble_stream_handler())
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <atomic>
+
+#if defined NRF52_SERIES
+
+/** UUID of the stream service 5EA10000-52D4-4E6B-9A5C-7A1D3B0A9F01 */
+static const uint8_t stream_service_uuid[] = {0x01, 0x9F, 0x0A, 0x3B, 0x1D, 0x7A, 0x5C, 0x9A, 0x6B, 0x4E, 0xD4, 0x52, 0x00, 0x00, 0xA1, 0x5E};
+/** UUID of the data characteristic 5EA10001-52D4-4E6B-9A5C-7A1D3B0A9F01 */
+static const uint8_t stream_data_uuid[] = {0x01, 0x9F, 0x0A, 0x3B, 0x1D, 0x7A, 0x5C, 0x9A, 0x6B, 0x4E, 0xD4, 0x52, 0x01, 0x00, 0xA1, 0x5E};
+/** UUID of the control characteristic 5EA10002-52D4-4E6B-9A5C-7A1D3B0A9F01 */
+static const uint8_t stream_ctrl_uuid[] = {0x01, 0x9F, 0x0A, 0x3B, 0x1D, 0x7A, 0x5C, 0x9A, 0x6B, 0x4E, 0xD4, 0x52, 0x02, 0x00, 0xA1, 0x5E};
+
+BLEService stream_service = BLEService(stream_service_uuid);
+BLECharacteristic stream_data = BLECharacteristic(stream_data_uuid);
+BLECharacteristic stream_ctrl = BLECharacteristic(stream_ctrl_uuid);
+
+/** Timer for the stream samples */
+SoftwareTimer stream_timer;
+
+/** Default sample interval in ms */
+#define STREAM_DEFAULT_INTERVAL 1000
+/** Shortest sample interval in ms */
+#define STREAM_MIN_INTERVAL 100
+/** Longest time a frame waits in the batch in ms */
+#define STREAM_MAX_LATENCY 1000
+/** Largest notification payload (MTU 247 - 3 bytes ATT header) */
+#define STREAM_MAX_BATCH 244
+
+/** Valid flags of a stream frame */
+#define STREAM_VALID_TH 0x01
+#define STREAM_VALID_PRESS 0x02
+#define STREAM_VALID_LIGHT 0x04
+
+/** One sample in the stream, little endian */
+struct __attribute__((packed)) stream_frame_s
+{
+	uint16_t seq;		// Sequence number
+	uint16_t time_ms;	// Lower 16 bit of the sample time in ms
+	uint8_t valid;		// STREAM_VALID_xx flags
+	int16_t temp_x10;	// Temperature in 1/10 degC
+	uint8_t humid_x2;	// Relative humidity in 1/2 %
+	uint16_t press_x10; // Pressure in 1/10 hPa
+	uint32_t lux_x100;	// Light in 1/100 lux
+	uint16_t batt_mv;	// Battery in mV
+};
+
+/** Requests from the BLE callbacks */
+enum stream_req_e
+{
+	STREAM_REQ_NONE = 0, // No request pending
+	STREAM_REQ_START,	 // Notifications enabled, start and reset the sequence number
+	STREAM_REQ_INTERVAL, // New interval, restarts the timer if notifications are enabled
+	STREAM_REQ_STOP,	 // Notifications disabled or interval 0
+};
+
+/** Request of the BLE callbacks, written on the Bluefruit task, taken on the app task */
+static std::atomic<uint8_t> stream_request(STREAM_REQ_NONE);
+/** Requested sample interval in ms, written on the Bluefruit task */
+static std::atomic<uint16_t> stream_req_interval(STREAM_DEFAULT_INTERVAL);
+/** Sample interval in ms */
+static uint16_t stream_interval = STREAM_DEFAULT_INTERVAL;
+/** Flag if streaming is active, only changed on the app task */
+static bool stream_active = false;
+/** Sequence number of the next frame */
+static uint16_t stream_seq = 0;
+/** Batch of frames waiting for the next notification */
+static uint8_t stream_batch[STREAM_MAX_BATCH];
+/** Bytes in the batch */
+static uint16_t stream_batch_len = 0;
+/** Time the first frame was added to the batch */
+static uint32_t stream_batch_start = 0;
+
+/**
+ * @brief Timer callback, wakes the loop to take the next sample
+ *
+ * @param unused
+ */
+void stream_timer_cb(TimerHandle_t unused)
+{
+	api_wake_loop(BLE_STREAM);
+}
+
+/**
+ * @brief Post a request to the app task
+ *
+ * @param request stream_req_e
+ */
+static void stream_post(uint8_t request)
+{
+	stream_request.store(request);
+	api_wake_loop(BLE_STREAM);
+}
+
+/**
+ * @brief Start streaming, sensors stay powered until streaming stops
+ *        Runs on the app task
+ *
+ */
+static void start_stream(void)
+{
+	if (stream_active)
+	{
+		stream_timer.setPeriod(stream_interval);
+		return;
+	}
+	MYLOG("STREAM", "Start streaming every %d ms", stream_interval);
+	digitalWrite(WB_IO2, HIGH);
+	if (has_rak1902)
+	{
+		start_press_burst();
+	}
+	stream_batch_len = 0;
+	stream_active = true;
+	stream_timer.setPeriod(stream_interval);
+	stream_timer.start();
+}
+
+/**
+ * @brief Stop streaming and return the sensors to low power mode
+ *        Runs on the app task
+ *
+ */
+static void stop_stream(void)
+{
+	if (!stream_active)
+	{
+		return;
+	}
+	MYLOG("STREAM", "Stop streaming");
+	stream_timer.stop();
+	stream_active = false;
+	if (has_rak1902)
+	{
+		stop_press_burst();
+	}
+	digitalWrite(WB_IO2, LOW);
+}
+
+/**
+ * @brief Callback if the client enables or disables notifications
+ *
+ * @param conn_hdl connection handle
+ * @param chr characteristic
+ * @param cccd_value notification enabled if BLE_GATT_HVX_NOTIFICATION is set
+ */
+void stream_cccd_cb(uint16_t conn_hdl, BLECharacteristic *chr, uint16_t cccd_value)
+{
+	stream_post((cccd_value & BLE_GATT_HVX_NOTIFICATION) ? STREAM_REQ_START : STREAM_REQ_STOP);
+}
+
+/**
+ * @brief Callback if the client writes the sample interval
+ *        2 bytes little endian in ms, 0 stops the stream
+ *
+ * @param conn_hdl connection handle
+ * @param chr characteristic
+ * @param data received data
+ * @param len length of the received data
+ */
+void stream_ctrl_cb(uint16_t conn_hdl, BLECharacteristic *chr, uint8_t *data, uint16_t len)
+{
+	if (len != 2)
+	{
+		return;
+	}
+	uint16_t interval = data[0] | (data[1] << 8);
+	if (interval == 0)
+	{
+		stream_post(STREAM_REQ_STOP);
+		return;
+	}
+	stream_req_interval.store(interval < STREAM_MIN_INTERVAL ? STREAM_MIN_INTERVAL : interval);
+	// A pending start or stop is not replaced
+	uint8_t none = STREAM_REQ_NONE;
+	stream_request.compare_exchange_strong(none, STREAM_REQ_INTERVAL);
+	api_wake_loop(BLE_STREAM);
+}
+
+/**
+ * @brief Handle a request of the BLE callbacks
+ *
+ */
+static void stream_take_request(void)
+{
+	uint8_t request = stream_request.exchange(STREAM_REQ_NONE);
+	stream_interval = stream_req_interval.load();
+	switch (request)
+	{
+	case STREAM_REQ_START:
+		stream_seq = 0;
+		start_stream();
+		break;
+	case STREAM_REQ_INTERVAL:
+		if (stream_data.notifyEnabled())
+		{
+			start_stream();
+		}
+		break;
+	case STREAM_REQ_STOP:
+		stop_stream();
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Initialize the BLE stream service
+ *
+ */
+void init_ble_stream(void)
+{
+	stream_timer.begin(STREAM_DEFAULT_INTERVAL, stream_timer_cb, NULL, true);
+
+	stream_service.begin();
+
+	stream_data.setProperties(CHR_PROPS_NOTIFY);
+	stream_data.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+	stream_data.setMaxLen(STREAM_MAX_BATCH);
+	stream_data.setCccdWriteCallback(stream_cccd_cb);
+	stream_data.begin();
+
+	stream_ctrl.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+	stream_ctrl.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+	stream_ctrl.setFixedLen(2);
+	stream_ctrl.setWriteCallback(stream_ctrl_cb);
+	stream_ctrl.begin();
+	stream_ctrl.write16(stream_interval);
+}
+
+/**
+ * @brief Check if streaming is active and restore the stream sensor setup
+ *        Called by acquire_frame() before it switches the sensor power off.
+ *        Runs on the app task like ble_stream_handler(), a stop request of
+ *        the BLE callbacks is applied after the acquisition
+ *
+ * @return true if streaming is active, sensors must stay powered
+ * @return false if streaming is not active
+ */
+bool ble_stream_resume(void)
+{
+	if (stream_active && has_rak1902)
+	{
+		start_press_burst();
+	}
+	return stream_active;
+}
+
+/**
+ * @brief Handle requests of the BLE callbacks, take one sample and send the batch
+ *        if it is full or would be too old at the next sample
+ *        Called from app_event_handler() on the BLE_STREAM event
+ *
+ */
+void ble_stream_handler(void)
+{
+	stream_take_request();
+	if (!stream_active)
+	{
+		return;
+	}
+	if (!g_ble_uart_is_connected || !stream_data.notifyEnabled())
+	{
+		stop_stream();
+		return;
+	}
+
+	stream_frame_s frame;
+	memset(&frame, 0, sizeof(stream_frame_s));
+	frame.seq = stream_seq++;
+	frame.time_ms = (uint16_t)millis();
+
+	float value;
+	if (has_rak1901 && read_th_sample(&frame.temp_x10, &frame.humid_x2))
+	{
+		frame.valid |= STREAM_VALID_TH;
+	}
+	if (has_rak1902 && read_press_sample(&value))
+	{
+		frame.press_x10 = (uint16_t)(value * 10);
+		frame.valid |= STREAM_VALID_PRESS;
+	}
+	if (has_rak1903 && read_light_sample(&value))
+	{
+		frame.lux_x100 = (uint32_t)(value * 100);
+		frame.valid |= STREAM_VALID_LIGHT;
+	}
+	frame.batt_mv = (uint16_t)read_batt();
+
+	if (stream_batch_len == 0)
+	{
+		stream_batch_start = millis();
+	}
+	memcpy(&stream_batch[stream_batch_len], &frame, sizeof(stream_frame_s));
+	stream_batch_len += sizeof(stream_frame_s);
+
+	// Notification payload is limited by the negotiated MTU
+	uint16_t max_len = Bluefruit.Connection(Bluefruit.connHandle())->getMtu() - 3;
+	max_len = max_len > STREAM_MAX_BATCH ? STREAM_MAX_BATCH : max_len;
+	// The batch is only checked when a sample is taken. Send it now if it would be
+	// older than the latency limit at the next sample
+	if (((stream_batch_len + sizeof(stream_frame_s)) > max_len) || ((millis() - stream_batch_start + stream_interval) > STREAM_MAX_LATENCY))
+	{
+		stream_data.notify(stream_batch, stream_batch_len);
+		stream_batch_len = 0;
+	}
+}
+#else
+// The stream service uses the Bluefruit stack, not available on the RAK11300 and RAK3112
+
+void init_ble_stream(void)
+{
+}
+
+bool ble_stream_resume(void)
+{
+	return false;
+}
+
+void ble_stream_handler(void)
+{
+}
+#endif
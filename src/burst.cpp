@@ -0,0 +1,125 @@
+/**
+ * @file burst.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief High rate burst capture of pressure and light with statistics summary
+ *        Statistics and spectrum kernels are in burst_dsp.h
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "burst_dsp.h"
+
+/** Number of pressure samples, power of 2 for the FFT (~3.4 s at 75 Hz) */
+#define BURST_PRESS_SAMPLES 256
+/** Pressure sample interval in us (75 Hz) */
+#define BURST_PRESS_INTERVAL_US 13333
+/** Light samples, one per OPT3001 conversion of 100 ms */
+#define BURST_LIGHT_SAMPLES 32
+/** Number of pressure samples between two light samples */
+#define BURST_LIGHT_DIVIDER (BURST_PRESS_SAMPLES / BURST_LIGHT_SAMPLES)
+
+/** Burst sample buffers */
+static float press_samples[BURST_PRESS_SAMPLES];
+static float light_samples[BURST_LIGHT_SAMPLES];
+/** Spectrum buffer, the FFT output needs the same size as the input */
+static float spectrum[BURST_PRESS_SAMPLES];
+
+/**
+ * @brief Capture a burst of pressure and light samples and add the summary to the payload
+ *        Pressure is sampled with 75 Hz, light with the fastest OPT3001 conversion time of 100 ms.
+ *        The 800 ms conversion time of PROFILE_PRECISION is restored after the burst
+ *
+ */
+void read_burst(void)
+{
+	uint16_t press_num = 0;
+	uint16_t light_num = 0;
+
+	MYLOG("BURST", "Start burst capture");
+	if (has_rak1903)
+	{
+		start_light_burst();
+	}
+	if (has_rak1902)
+	{
+		start_press_burst();
+	}
+
+	uint32_t next_sample = micros();
+	for (uint16_t idx = 0; idx < BURST_PRESS_SAMPLES; idx++)
+	{
+		if (has_rak1902 && read_press_sample(&press_samples[press_num]))
+		{
+			press_num++;
+		}
+		if (has_rak1903 && ((idx % BURST_LIGHT_DIVIDER) == 0) && read_light_sample(&light_samples[light_num]))
+		{
+			light_num++;
+		}
+		next_sample += BURST_PRESS_INTERVAL_US;
+		int32_t wait_time = (int32_t)(next_sample - micros());
+		if (wait_time > 1000)
+		{
+			delay(wait_time / 1000);
+		}
+		while ((int32_t)(next_sample - micros()) > 0)
+		{
+		}
+	}
+
+	if (has_rak1902)
+	{
+		stop_press_burst();
+	}
+	if (has_rak1903)
+	{
+		stop_light_burst();
+	}
+	MYLOG("BURST", "Captured %d pressure and %d light samples", press_num, light_num);
+
+	burst_stats_s stats;
+	if (press_num == BURST_PRESS_SAMPLES)
+	{
+		float bands[BURST_BANDS];
+		// Work on deviations from the first sample, otherwise the float variance
+		// of values around 1000 hPa loses the resolution of small pulses
+		float press_ref = press_samples[0];
+		for (uint16_t idx = 0; idx < press_num; idx++)
+		{
+			press_samples[idx] -= press_ref;
+		}
+		burst_statistics(press_samples, press_num, &stats);
+		burst_spectrum(press_samples, spectrum, press_num, stats.mean, bands);
+		stats.min += press_ref;
+		stats.max += press_ref;
+		stats.mean += press_ref;
+
+		MYLOG("BURST", "P mean %.2f min %.2f max %.2f std %.3f", stats.mean, stats.min, stats.max, stats.std_dev);
+		MYLOG("BURST", "P bands %.1f %.1f %.1f %.1f", bands[0], bands[1], bands[2], bands[3]);
+
+		// Deviations are sent in Pa to keep the resolution of the pulses
+		g_solution_data.addBarometricPressure(LPP_CHANNEL_BURST_P_MEAN, stats.mean);
+		g_solution_data.addAnalogInput(LPP_CHANNEL_BURST_P_MIN, (stats.min - stats.mean) * 100.0f);
+		g_solution_data.addAnalogInput(LPP_CHANNEL_BURST_P_MAX, (stats.max - stats.mean) * 100.0f);
+		g_solution_data.addAnalogInput(LPP_CHANNEL_BURST_P_STD, stats.std_dev * 100.0f);
+		for (uint8_t band = 0; band < BURST_BANDS; band++)
+		{
+			g_solution_data.addAnalogInput(LPP_CHANNEL_BURST_P_BAND + band, bands[band]);
+		}
+	}
+
+	if (light_num > 1)
+	{
+		burst_statistics(light_samples, light_num, &stats);
+
+		MYLOG("BURST", "L mean %.2f min %.2f max %.2f std %.3f", stats.mean, stats.min, stats.max, stats.std_dev);
+
+		g_solution_data.addLuminosity(LPP_CHANNEL_BURST_L_MEAN, (uint32_t)stats.mean);
+		g_solution_data.addLuminosity(LPP_CHANNEL_BURST_L_MIN, (uint32_t)stats.min);
+		g_solution_data.addLuminosity(LPP_CHANNEL_BURST_L_MAX, (uint32_t)stats.max);
+		g_solution_data.addLuminosity(LPP_CHANNEL_BURST_L_STD, (uint32_t)stats.std_dev);
+	}
+}
@@ -0,0 +1,182 @@
+/**
+ * @file burst_dsp.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Statistics and band energy kernels of the burst capture
+ *        Shared by the device (burst.cpp) and the host benchmark (tools/burst_bench.cpp).
+ *        Uses the CMSIS-DSP library on the Cortex-M4F, a radix-2 FFT otherwise
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef BURST_DSP_H
+#define BURST_DSP_H
+
+#include <math.h>
+#include <stdint.h>
+#ifdef ARM_MATH_CM4
+#include <arm_math.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Number of frequency bands of the spectrum summary */
+#define BURST_BANDS 4
+
+/** Statistics of one burst channel */
+struct burst_stats_s
+{
+	float min;
+	float max;
+	float mean;
+	float std_dev;
+};
+
+/**
+ * @brief Calculate min, max, mean and standard deviation of a sample buffer
+ *
+ * @param samples sample buffer
+ * @param num number of samples, at least 2
+ * @param stats returns the statistics
+ */
+static inline void burst_statistics(float *samples, uint16_t num, burst_stats_s *stats)
+{
+#ifdef ARM_MATH_CM4
+	uint32_t index;
+	arm_min_f32(samples, num, &stats->min, &index);
+	arm_max_f32(samples, num, &stats->max, &index);
+	arm_mean_f32(samples, num, &stats->mean);
+	arm_std_f32(samples, num, &stats->std_dev);
+#else
+	stats->min = samples[0];
+	stats->max = samples[0];
+	float sum = 0;
+	for (uint16_t idx = 0; idx < num; idx++)
+	{
+		stats->min = samples[idx] < stats->min ? samples[idx] : stats->min;
+		stats->max = samples[idx] > stats->max ? samples[idx] : stats->max;
+		sum += samples[idx];
+	}
+	stats->mean = sum / num;
+	float sum_sq = 0;
+	for (uint16_t idx = 0; idx < num; idx++)
+	{
+		float diff = samples[idx] - stats->mean;
+		sum_sq += diff * diff;
+	}
+	stats->std_dev = sqrtf(sum_sq / (num - 1));
+#endif
+}
+
+#ifndef ARM_MATH_CM4
+/**
+ * @brief In-place iterative radix-2 complex FFT
+ *
+ * @param re real parts, returns the real parts of the bins
+ * @param im imaginary parts, returns the imaginary parts of the bins
+ * @param num number of points, power of 2
+ */
+static inline void burst_fft(float *re, float *im, uint16_t num)
+{
+	// Bit reversed order
+	for (uint16_t idx = 1, rev = 0; idx < num; idx++)
+	{
+		uint16_t bit = num >> 1;
+		for (; rev & bit; bit >>= 1)
+		{
+			rev ^= bit;
+		}
+		rev ^= bit;
+		if (idx < rev)
+		{
+			float tmp = re[idx];
+			re[idx] = re[rev];
+			re[rev] = tmp;
+			tmp = im[idx];
+			im[idx] = im[rev];
+			im[rev] = tmp;
+		}
+	}
+	for (uint16_t len = 2; len <= num; len <<= 1)
+	{
+		uint16_t half = len >> 1;
+		for (uint16_t k = 0; k < half; k++)
+		{
+			// One twiddle factor per butterfly column, num - 1 sin/cos pairs in total
+			float angle = -2.0f * (float)M_PI * k / len;
+			float w_re = cosf(angle);
+			float w_im = sinf(angle);
+			for (uint16_t start = 0; start < num; start += len)
+			{
+				uint16_t top = start + k;
+				uint16_t bottom = top + half;
+				float t_re = re[bottom] * w_re - im[bottom] * w_im;
+				float t_im = re[bottom] * w_im + im[bottom] * w_re;
+				re[bottom] = re[top] - t_re;
+				im[bottom] = im[top] - t_im;
+				re[top] += t_re;
+				im[top] += t_im;
+			}
+		}
+	}
+}
+#endif
+
+/**
+ * @brief Calculate the share of the AC energy in 4 frequency bands
+ *        Bands are 0..1/16, 1/16..1/8, 1/8..1/4 and 1/4..1/2 of the sample rate
+ *        The sample buffer is overwritten
+ *
+ * @param samples sample buffer
+ * @param spectrum work buffer of the same size as the sample buffer
+ * @param num number of samples, power of 2 and at least 16
+ * @param mean mean value of the samples
+ * @param bands returns the energy share in % per band
+ */
+static inline void burst_spectrum(float *samples, float *spectrum, uint16_t num, float mean, float *bands)
+{
+	uint16_t half = num / 2;
+
+#ifdef ARM_MATH_CM4
+	arm_rfft_fast_instance_f32 rfft;
+	arm_offset_f32(samples, -mean, samples, num);
+	arm_rfft_fast_init_f32(&rfft, num);
+	arm_rfft_fast_f32(&rfft, samples, spectrum, 0);
+	// spectrum[0] is DC, spectrum[1] is Nyquist, then complex pairs
+	arm_cmplx_mag_squared_f32(&spectrum[2], &spectrum[1], half - 1);
+#else
+	// Complex FFT with the imaginary parts in the spectrum buffer
+	for (uint16_t idx = 0; idx < num; idx++)
+	{
+		samples[idx] -= mean;
+		spectrum[idx] = 0;
+	}
+	burst_fft(samples, spectrum, num);
+	for (uint16_t bin = 1; bin < half; bin++)
+	{
+		spectrum[bin] = samples[bin] * samples[bin] + spectrum[bin] * spectrum[bin];
+	}
+#endif
+
+	uint16_t band_start[BURST_BANDS + 1] = {1, (uint16_t)(half / 8), (uint16_t)(half / 4), (uint16_t)(half / 2), half};
+	float total = 0;
+	for (uint8_t band = 0; band < BURST_BANDS; band++)
+	{
+		bands[band] = 0;
+		for (uint16_t bin = band_start[band]; bin < band_start[band + 1]; bin++)
+		{
+			bands[band] += spectrum[bin];
+		}
+		total += bands[band];
+	}
+	for (uint8_t band = 0; band < BURST_BANDS; band++)
+	{
+		bands[band] = total > 0 ? bands[band] * 100.0f / total : 0;
+	}
+}
+
+#endif
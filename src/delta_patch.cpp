@@ -0,0 +1,346 @@
+/**
+ * @file delta_patch.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Streaming applier for firmware delta images
+ *        The delta can arrive in chunks of any size, the old image is read
+ *        from flash when needed, the new image is written page by page
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "delta_patch.h"
+#include <string.h>
+
+/** Parser states */
+#define DELTA_STATE_HEADER 0
+#define DELTA_STATE_OP 1
+#define DELTA_STATE_LEN 2
+#define DELTA_STATE_ADJ 3
+#define DELTA_STATE_INSERT 4
+#define DELTA_STATE_END 5
+
+/**
+ * @brief CRC32 (IEEE 802.3) of the old image, read in pages from flash
+ *
+ * @param ctx patch state, the page buffer is used as read buffer
+ * @param crc returns the CRC32
+ * @return true if the old image could be read
+ */
+static bool delta_old_crc(delta_patch_s *ctx, uint32_t *crc)
+{
+	uint32_t value = 0xFFFFFFFF;
+	for (uint32_t offset = 0; offset < ctx->header.old_size; offset += DELTA_PAGE_SIZE)
+	{
+		uint32_t len = ctx->header.old_size - offset;
+		len = len < DELTA_PAGE_SIZE ? len : DELTA_PAGE_SIZE;
+		if (!ctx->io->read_old(offset, ctx->page, len))
+		{
+			return false;
+		}
+		for (uint32_t idx = 0; idx < len; idx++)
+		{
+			value ^= ctx->page[idx];
+			for (uint8_t bit = 0; bit < 8; bit++)
+			{
+				value = (value >> 1) ^ (0xEDB88320 & (0 - (value & 1)));
+			}
+		}
+	}
+	*crc = ~value;
+	return true;
+}
+
+/**
+ * @brief Write the page buffer to the inactive bank
+ *
+ * @param ctx patch state
+ * @return true if the page was written
+ */
+static bool delta_flush(delta_patch_s *ctx)
+{
+	if (ctx->page_fill == 0)
+	{
+		return true;
+	}
+	uint32_t offset = ctx->new_pos - ctx->page_fill;
+	if (!ctx->io->write_new(offset, ctx->page, ctx->page_fill))
+	{
+		return false;
+	}
+	ctx->page_fill = 0;
+	return true;
+}
+
+/**
+ * @brief Check the header and the old image
+ *
+ * @param ctx patch state
+ * @return delta_result_e DELTA_MORE if the patch can start
+ */
+static delta_result_e delta_check_header(delta_patch_s *ctx)
+{
+	if ((ctx->header.magic != DELTA_MAGIC) || (ctx->header.old_size > ctx->io->max_size) || (ctx->header.new_size > ctx->io->max_size))
+	{
+		return DELTA_ERR_HEADER;
+	}
+	uint32_t crc;
+	if (!delta_old_crc(ctx, &crc))
+	{
+		return DELTA_ERR_FLASH;
+	}
+	if (crc != ctx->header.old_crc)
+	{
+		return DELTA_ERR_BASE;
+	}
+	return DELTA_MORE;
+}
+
+/**
+ * @brief Finish the new image and verify the hash
+ *        The hash is checked over the written data and again over the
+ *        data read back from the inactive bank
+ *
+ * @param ctx patch state
+ * @return delta_result_e DELTA_DONE if the new image is valid
+ */
+static delta_result_e delta_finish(delta_patch_s *ctx)
+{
+	if (!delta_flush(ctx))
+	{
+		return DELTA_ERR_FLASH;
+	}
+
+	uint8_t hash[SHA256_SIZE];
+	sha256_final(&ctx->hash, hash);
+	if (memcmp(hash, ctx->header.new_hash, SHA256_SIZE) != 0)
+	{
+		return DELTA_ERR_HASH;
+	}
+	if (ctx->io->read_new == NULL)
+	{
+		return DELTA_DONE;
+	}
+
+	sha256_init(&ctx->hash);
+	for (uint32_t offset = 0; offset < ctx->header.new_size; offset += DELTA_PAGE_SIZE)
+	{
+		uint32_t len = ctx->header.new_size - offset;
+		len = len < DELTA_PAGE_SIZE ? len : DELTA_PAGE_SIZE;
+		if (!ctx->io->read_new(offset, ctx->page, len))
+		{
+			return DELTA_ERR_FLASH;
+		}
+		sha256_update(&ctx->hash, ctx->page, len);
+	}
+	sha256_final(&ctx->hash, hash);
+	if (memcmp(hash, ctx->header.new_hash, SHA256_SIZE) != 0)
+	{
+		return DELTA_ERR_HASH;
+	}
+	return DELTA_DONE;
+}
+
+/**
+ * @brief Copy bytes from the old image into the new image
+ *
+ * @param ctx patch state
+ * @return delta_result_e DELTA_MORE if the copy succeeded
+ */
+static delta_result_e delta_copy(delta_patch_s *ctx)
+{
+	if (((uint64_t)ctx->old_pos + ctx->op_len > ctx->header.old_size) ||
+		((uint64_t)ctx->new_pos + ctx->op_len > ctx->header.new_size))
+	{
+		return DELTA_ERR_FORMAT;
+	}
+	while (ctx->op_len > 0)
+	{
+		uint32_t len = DELTA_PAGE_SIZE - ctx->page_fill;
+		len = len < ctx->op_len ? len : ctx->op_len;
+		if (!ctx->io->read_old(ctx->old_pos, &ctx->page[ctx->page_fill], len))
+		{
+			return DELTA_ERR_FLASH;
+		}
+		sha256_update(&ctx->hash, &ctx->page[ctx->page_fill], len);
+		ctx->page_fill += len;
+		ctx->old_pos += len;
+		ctx->new_pos += len;
+		ctx->op_len -= len;
+		if ((ctx->page_fill == DELTA_PAGE_SIZE) && !delta_flush(ctx))
+		{
+			return DELTA_ERR_FLASH;
+		}
+	}
+	return DELTA_MORE;
+}
+
+/**
+ * @brief Handle one byte of the operation stream
+ *        INSERT data is handled in blocks by delta_patch_write()
+ *
+ * @param ctx patch state
+ * @param value next byte of the delta
+ * @return delta_result_e DELTA_MORE if the byte was accepted
+ */
+static delta_result_e delta_parse(delta_patch_s *ctx, uint8_t value)
+{
+	switch (ctx->state)
+	{
+	case DELTA_STATE_HEADER:
+		((uint8_t *)&ctx->header)[ctx->header_len++] = value;
+		if (ctx->header_len < sizeof(delta_header_s))
+		{
+			return DELTA_MORE;
+		}
+		ctx->state = DELTA_STATE_OP;
+		return delta_check_header(ctx);
+	case DELTA_STATE_OP:
+		if ((value != DELTA_OP_COPY) && (value != DELTA_OP_INSERT))
+		{
+			return DELTA_ERR_FORMAT;
+		}
+		ctx->op = value;
+		ctx->varint = 0;
+		ctx->varint_shift = 0;
+		ctx->state = DELTA_STATE_LEN;
+		return DELTA_MORE;
+	case DELTA_STATE_LEN:
+	case DELTA_STATE_ADJ:
+		if (ctx->varint_shift > 28)
+		{
+			return DELTA_ERR_FORMAT;
+		}
+		ctx->varint |= (uint32_t)(value & 0x7F) << ctx->varint_shift;
+		ctx->varint_shift += 7;
+		if (value & 0x80)
+		{
+			return DELTA_MORE;
+		}
+		if (ctx->state == DELTA_STATE_LEN)
+		{
+			ctx->op_len = ctx->varint;
+			ctx->varint = 0;
+			ctx->varint_shift = 0;
+			if (ctx->op == DELTA_OP_COPY)
+			{
+				ctx->state = DELTA_STATE_ADJ;
+				return DELTA_MORE;
+			}
+			if ((uint64_t)ctx->new_pos + ctx->op_len > ctx->header.new_size)
+			{
+				return DELTA_ERR_FORMAT;
+			}
+			ctx->state = DELTA_STATE_INSERT;
+			return DELTA_MORE;
+		}
+		// Zigzag decoding of the offset adjust
+		ctx->old_pos += (uint32_t)((ctx->varint >> 1) ^ (0 - (ctx->varint & 1)));
+		ctx->state = DELTA_STATE_OP;
+		return delta_copy(ctx);
+	default:
+		return DELTA_ERR_FORMAT;
+	}
+}
+
+/**
+ * @brief Start a new patch
+ *
+ * @param ctx patch state
+ * @param io flash access of the platform
+ */
+void delta_patch_begin(delta_patch_s *ctx, const delta_io_s *io)
+{
+	// The page buffer is the last member and does not need to be cleared
+	memset(ctx, 0, sizeof(delta_patch_s) - DELTA_PAGE_SIZE);
+	ctx->io = io;
+	ctx->state = DELTA_STATE_HEADER;
+	ctx->result = DELTA_MORE;
+	sha256_init(&ctx->hash);
+}
+
+/**
+ * @brief Add the next chunk of the delta
+ *        Once an error or DELTA_DONE was returned, further data is ignored
+ *
+ * @param ctx patch state
+ * @param data delta data
+ * @param len length of the data
+ * @return delta_result_e DELTA_MORE while more data is expected,
+ *                        DELTA_DONE if the new image is written and verified,
+ *                        otherwise the error
+ */
+delta_result_e delta_patch_write(delta_patch_s *ctx, const uint8_t *data, uint32_t len)
+{
+	uint32_t idx = 0;
+	while ((ctx->result == DELTA_MORE) && (idx < len))
+	{
+		if (ctx->state == DELTA_STATE_END)
+		{
+			// Data after the end of the new image
+			ctx->result = DELTA_ERR_FORMAT;
+			break;
+		}
+		if (ctx->state == DELTA_STATE_INSERT)
+		{
+			uint32_t chunk = len - idx;
+			chunk = chunk < ctx->op_len ? chunk : ctx->op_len;
+			chunk = chunk < (DELTA_PAGE_SIZE - ctx->page_fill) ? chunk : (DELTA_PAGE_SIZE - ctx->page_fill);
+			memcpy(&ctx->page[ctx->page_fill], &data[idx], chunk);
+			sha256_update(&ctx->hash, &data[idx], chunk);
+			ctx->page_fill += chunk;
+			ctx->new_pos += chunk;
+			ctx->op_len -= chunk;
+			idx += chunk;
+			if ((ctx->page_fill == DELTA_PAGE_SIZE) && !delta_flush(ctx))
+			{
+				ctx->result = DELTA_ERR_FLASH;
+				break;
+			}
+			if (ctx->op_len == 0)
+			{
+				ctx->state = DELTA_STATE_OP;
+			}
+		}
+		else
+		{
+			ctx->result = delta_parse(ctx, data[idx++]);
+		}
+
+		if ((ctx->result == DELTA_MORE) && (ctx->state == DELTA_STATE_OP) && (ctx->new_pos == ctx->header.new_size))
+		{
+			ctx->state = DELTA_STATE_END;
+			ctx->result = delta_finish(ctx);
+		}
+	}
+	return ctx->result;
+}
+
+/**
+ * @brief Text for log output
+ *
+ * @param result result of the patch
+ * @return const char* name of the result
+ */
+const char *delta_result_str(delta_result_e result)
+{
+	switch (result)
+	{
+	case DELTA_MORE:
+		return "MORE";
+	case DELTA_DONE:
+		return "DONE";
+	case DELTA_ERR_HEADER:
+		return "HEADER";
+	case DELTA_ERR_BASE:
+		return "BASE";
+	case DELTA_ERR_FORMAT:
+		return "FORMAT";
+	case DELTA_ERR_FLASH:
+		return "FLASH";
+	case DELTA_ERR_HASH:
+		return "HASH";
+	}
+	return "UNKNOWN";
+}
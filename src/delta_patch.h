@@ -0,0 +1,97 @@
+/**
+ * @file delta_patch.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Streaming applier for firmware delta images created by create_delta.py
+ *        No Arduino dependencies, compiles as well on a Linux host
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Delta format, all values little endian:
+ * - Header (48 bytes): magic "WDL1", old image size, CRC32 of the old image,
+ *   new image size, SHA-256 of the new image
+ * - Operations until the new image is complete:
+ *   - 0x01 COPY: length (varint), offset adjust (zigzag varint)
+ *     moves the old image position by the adjust, then copies length bytes
+ *   - 0x02 INSERT: length (varint), followed by length literal bytes
+ * Varints are LEB128, 7 bits per byte, low bits first.
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include "sha256.h"
+
+/** Size of the output buffer, one flash page */
+#ifndef DELTA_PAGE_SIZE
+#define DELTA_PAGE_SIZE 4096
+#endif
+
+/** Magic number of the delta header "WDL1" */
+#define DELTA_MAGIC 0x314C4457
+
+/** Delta operations */
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_INSERT 0x02
+
+/** Result of the patch functions */
+enum delta_result_e
+{
+	DELTA_MORE = 0,	   // Waiting for more delta data
+	DELTA_DONE,		   // New image is complete and verified
+	DELTA_ERR_HEADER,  // Invalid magic or image too large
+	DELTA_ERR_BASE,	   // Old image does not match the delta
+	DELTA_ERR_FORMAT,  // Invalid operation or out of range
+	DELTA_ERR_FLASH,   // Read or write of the flash failed
+	DELTA_ERR_HASH,	   // New image hash does not match
+};
+
+/** Delta header */
+struct __attribute__((packed)) delta_header_s
+{
+	uint32_t magic;
+	uint32_t old_size;
+	uint32_t old_crc;
+	uint32_t new_size;
+	uint8_t new_hash[SHA256_SIZE];
+};
+
+/** Flash access of the platform */
+struct delta_io_s
+{
+	/** Read from the running image */
+	bool (*read_old)(uint32_t offset, uint8_t *buffer, uint32_t len);
+	/** Write to the inactive bank, called with increasing offsets and full pages except the last */
+	bool (*write_new)(uint32_t offset, const uint8_t *buffer, uint32_t len);
+	/** Read back from the inactive bank for the final hash check, can be NULL */
+	bool (*read_new)(uint32_t offset, uint8_t *buffer, uint32_t len);
+	/** Size of the inactive bank */
+	uint32_t max_size;
+};
+
+/** State of a running patch, RAM usage is fixed by DELTA_PAGE_SIZE */
+struct delta_patch_s
+{
+	const delta_io_s *io;
+	delta_header_s header;
+	uint8_t header_len;
+	uint8_t state;
+	uint8_t op;
+	uint8_t varint_shift;
+	uint32_t varint;
+	uint32_t op_len;
+	uint32_t old_pos;
+	uint32_t new_pos;
+	uint32_t page_fill;
+	delta_result_e result;
+	sha256_s hash;
+	uint8_t page[DELTA_PAGE_SIZE];
+};
+
+void delta_patch_begin(delta_patch_s *ctx, const delta_io_s *io);
+delta_result_e delta_patch_write(delta_patch_s *ctx, const uint8_t *data, uint32_t len);
+const char *delta_result_str(delta_result_e result);
+
+#endif
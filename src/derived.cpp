@@ -0,0 +1,194 @@
+/**
+ * @file derived.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Derived values (dew point, absolute humidity, altitude, pressure tendency)
+ *        calculated on the device with fixed-point math
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "derived.h"
+
+/** Minimum time between two entries in the pressure history (15 minutes) */
+#define PRESS_HIST_INTERVAL (15 * 60 * 1000UL)
+/** Length of the tendency window (3 hours) */
+#define PRESS_HIST_WINDOW (3 * 60 * 60 * 1000UL)
+/** Accepted tolerance for the oldest entry of the window (15 minutes) */
+#define PRESS_HIST_TOLERANCE (15 * 60 * 1000UL)
+/** Entries required to cover the window plus one spare */
+#define PRESS_HIST_SIZE 14
+/** Pressure change below this is treated as steady (in 1/10 hPa) */
+#define TENDENCY_STEADY 2
+
+/** Entry in the pressure history ring */
+struct press_hist_s
+{
+	uint32_t time;
+	uint16_t press_x10;
+};
+
+/** Pressure history ring */
+static press_hist_s press_hist[PRESS_HIST_SIZE];
+/** Next write position in the ring */
+static uint8_t press_hist_head = 0;
+/** Number of valid entries in the ring */
+static uint8_t press_hist_num = 0;
+
+/**
+ * @brief Add a pressure reading to the history ring
+ *        Only one entry per PRESS_HIST_INTERVAL is stored
+ *
+ * @param press_x10 pressure in 1/10 hPa
+ */
+void add_press_history(uint16_t press_x10)
+{
+	uint32_t now = millis();
+	if (press_hist_num != 0)
+	{
+		uint8_t last = (press_hist_head + PRESS_HIST_SIZE - 1) % PRESS_HIST_SIZE;
+		if ((now - press_hist[last].time) < PRESS_HIST_INTERVAL)
+		{
+			return;
+		}
+	}
+	press_hist[press_hist_head].time = now;
+	press_hist[press_hist_head].press_x10 = press_x10;
+	press_hist_head = (press_hist_head + 1) % PRESS_HIST_SIZE;
+	if (press_hist_num < PRESS_HIST_SIZE)
+	{
+		press_hist_num++;
+	}
+}
+
+/**
+ * @brief Find the history entry closest to the requested age
+ *
+ * @param now current time in ms
+ * @param age requested age in ms
+ * @return int index into the ring, -1 if history is empty
+ */
+static int find_press_history(uint32_t now, uint32_t age)
+{
+	int best = -1;
+	uint32_t best_diff = UINT32_MAX;
+	for (uint8_t idx = 0; idx < press_hist_num; idx++)
+	{
+		uint32_t entry_age = now - press_hist[idx].time;
+		uint32_t diff = entry_age > age ? entry_age - age : age - entry_age;
+		if (diff < best_diff)
+		{
+			best_diff = diff;
+			best = idx;
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief Calculate the WMO pressure tendency characteristic (code table 0200)
+ *
+ * @param current_x10 current pressure in 1/10 hPa
+ * @param delta_x10 returns the 3 hour pressure change in 1/10 hPa
+ * @return uint8_t tendency code 0 to 8, 255 if history does not cover 3 hours
+ */
+uint8_t get_press_tendency(uint16_t current_x10, int16_t *delta_x10)
+{
+	uint32_t now = millis();
+	int start = find_press_history(now, PRESS_HIST_WINDOW);
+	if ((start < 0) || ((now - press_hist[start].time) < (PRESS_HIST_WINDOW - PRESS_HIST_TOLERANCE)))
+	{
+		return 255;
+	}
+	int middle = find_press_history(now, PRESS_HIST_WINDOW / 2);
+
+	int16_t first_half = press_hist[middle].press_x10 - press_hist[start].press_x10;
+	int16_t second_half = current_x10 - press_hist[middle].press_x10;
+	int16_t total = current_x10 - press_hist[start].press_x10;
+	*delta_x10 = total;
+
+	bool first_up = first_half > TENDENCY_STEADY;
+	bool first_down = first_half < -TENDENCY_STEADY;
+	bool second_up = second_half > TENDENCY_STEADY;
+	bool second_down = second_half < -TENDENCY_STEADY;
+
+	if (total > TENDENCY_STEADY)
+	{
+		if (first_up && second_down)
+		{
+			return 0; // Increasing, then decreasing
+		}
+		if (first_up && !second_up)
+		{
+			return 1; // Increasing, then steady
+		}
+		if (!first_up && second_up)
+		{
+			return 3; // Decreasing or steady, then increasing
+		}
+		return 2; // Increasing
+	}
+	if (total < -TENDENCY_STEADY)
+	{
+		if (first_down && second_up)
+		{
+			return 5; // Decreasing, then increasing
+		}
+		if (first_down && !second_down)
+		{
+			return 6; // Decreasing, then steady
+		}
+		if (!first_down && second_down)
+		{
+			return 8; // Steady or increasing, then decreasing
+		}
+		return 7; // Decreasing
+	}
+	if (first_up && second_down)
+	{
+		return 0; // Increasing, then decreasing, same as 3 hours ago
+	}
+	if (first_down && second_up)
+	{
+		return 5; // Decreasing, then increasing, same as 3 hours ago
+	}
+	return 4; // Steady
+}
+
+/**
+ * @brief Add the derived values to the payload
+ *        Requires that read_th() and read_press() were called before
+ *
+ */
+void add_derived_values(void)
+{
+	if (g_sensor_values.th_valid)
+	{
+		int16_t dew_point_x10;
+		uint16_t abs_humid_x100;
+		if (calc_dew_point(g_sensor_values.temp_x10, g_sensor_values.humid_x2, &dew_point_x10, &abs_humid_x100))
+		{
+			MYLOG("DERIV", "Dew point %d/10 C Abs humid %d/100 g/m3", dew_point_x10, abs_humid_x100);
+			g_solution_data.addTemperature(LPP_CHANNEL_DEW_POINT, dew_point_x10 / 10.0);
+			g_solution_data.addAnalogInput(LPP_CHANNEL_ABS_HUMID, abs_humid_x100 / 100.0);
+		}
+	}
+
+	if (g_sensor_values.press_valid)
+	{
+		int32_t altitude = calc_altitude(g_sensor_values.press_x10, g_acq_settings.qnh_x10);
+		MYLOG("DERIV", "Altitude %ld m", altitude);
+		g_solution_data.addAltitude(LPP_CHANNEL_ALTITUDE, altitude);
+
+		int16_t delta_x10 = 0;
+		uint8_t tendency = get_press_tendency(g_sensor_values.press_x10, &delta_x10);
+		if (tendency != 255)
+		{
+			MYLOG("DERIV", "Tendency %d delta %d/10 hPa", tendency, delta_x10);
+			g_solution_data.addDigitalInput(LPP_CHANNEL_TENDENCY, tendency);
+			g_solution_data.addAnalogInput(LPP_CHANNEL_PRESS_DELTA, delta_x10 / 10.0);
+		}
+	}
+}
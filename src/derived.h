@@ -0,0 +1,79 @@
+/**
+ * @file derived.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Dew point, absolute humidity and barometric altitude in Q16.16 fixed-point
+ *        Shared by the device (derived.cpp) and the host check (tools/derived_check.cpp)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <stdint.h>
+#include "fixed_math.h"
+
+/** Magnus formula coefficient b = 17.62 in Q16.16 */
+#define MAGNUS_B 1154744L
+/** Magnus formula coefficient c = 243.12 degC in Q16.16 */
+#define MAGNUS_C 15933112L
+/** Largest absolute humidity of the payload, LPP analog input in 1/100 */
+#define ABS_HUMID_MAX_X100 32767
+
+/**
+ * @brief Calculate dew point and absolute humidity
+ *        Magnus formula with b = 17.62 and c = 243.12 degC
+ *
+ * @param temp_x10 temperature in 1/10 degC
+ * @param humid_x2 relative humidity in 1/2 %
+ * @param dew_point_x10 returns dew point in 1/10 degC
+ * @param abs_humid_x100 returns absolute humidity in 1/100 g/m3, saturates at ABS_HUMID_MAX_X100
+ * @return true if values could be calculated
+ * @return false if humidity is 0
+ */
+static inline bool calc_dew_point(int16_t temp_x10, uint16_t humid_x2, int16_t *dew_point_x10, uint16_t *abs_humid_x100)
+{
+	if (humid_x2 == 0)
+	{
+		return false;
+	}
+	int32_t temp = fp_from_scaled(temp_x10, 10);
+	int32_t rel_humid = fp_from_scaled(humid_x2, 200);
+
+	// b * T / (c + T)
+	int32_t magnus = fp_div(fp_mul(MAGNUS_B, temp), MAGNUS_C + temp);
+	int32_t gamma = fp_ln(rel_humid) + magnus;
+	*dew_point_x10 = fp_to_scaled(fp_div(fp_mul(MAGNUS_C, gamma), MAGNUS_B - gamma), 10);
+
+	// Vapor pressure e = RH * 6.112 hPa * exp(magnus), AH = 216.7 * e / (273.15 + T)
+	// e / (273.15 + T) first, 216.7 * e exceeds Q16.16 above 151 hPa (~54 degC at 100 %)
+	int32_t vapor = fp_mul(fp_mul(rel_humid, fp_from_scaled(6112, 1000)), (int32_t)fp_exp(magnus));
+	int32_t abs_humid = fp_mul(fp_div(vapor, fp_from_scaled(27315, 100) + temp), fp_from_scaled(2167, 10));
+	int32_t abs_humid_x100_raw = fp_to_scaled(abs_humid, 100);
+	*abs_humid_x100 = (uint16_t)(abs_humid_x100_raw > ABS_HUMID_MAX_X100 ? ABS_HUMID_MAX_X100 : abs_humid_x100_raw);
+	return true;
+}
+
+/**
+ * @brief Calculate barometric altitude against the configured QNH
+ *        h = 44330.8 m * (1 - (p / QNH) ^ 0.190263)
+ *
+ * @param press_x10 pressure in 1/10 hPa
+ * @param qnh_x10 sea level pressure in 1/10 hPa
+ * @return int32_t altitude in m
+ */
+static inline int32_t calc_altitude(uint16_t press_x10, uint16_t qnh_x10)
+{
+	if ((press_x10 == 0) || (qnh_x10 == 0))
+	{
+		return 0;
+	}
+	uint32_t ratio = (uint32_t)(((uint32_t)press_x10 << 16) / qnh_x10);
+	int32_t power = (int32_t)fp_exp2(fp_mul(fp_log2(ratio), fp_from_scaled(190263, 1000000)));
+	return fp_to_scaled(FP_ONE - power, 44331);
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file fixed_math.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Q16.16 fixed-point helpers, avoids pulling libm into the build
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FIXED_MATH_H
+#define FIXED_MATH_H
+
+#include <stdint.h>
+
+/** Fixed-point 1.0 in Q16.16 */
+#define FP_ONE 65536L
+/** ln(2) in Q16.16 */
+#define FP_LN2 45426L
+/** log2(e) in Q16.16 */
+#define FP_LOG2E 94548L
+
+/**
+ * @brief Convert a scaled integer into Q16.16
+ *
+ * @param value integer value
+ * @param scale scale of the integer value (e.g. 10 for 1/10 units)
+ * @return int32_t value in Q16.16
+ */
+static inline int32_t fp_from_scaled(int32_t value, int32_t scale)
+{
+	return (int32_t)(((int64_t)value << 16) / scale);
+}
+
+/**
+ * @brief Convert Q16.16 into a rounded scaled integer
+ *
+ * @param value Q16.16 value
+ * @param scale requested scale (e.g. 10 for 1/10 units)
+ * @return int32_t scaled integer
+ */
+static inline int32_t fp_to_scaled(int32_t value, int32_t scale)
+{
+	int64_t scaled = (int64_t)value * scale;
+	return (int32_t)((scaled + (scaled >= 0 ? 32768 : -32768)) / FP_ONE);
+}
+
+/**
+ * @brief Multiply two Q16.16 values
+ */
+static inline int32_t fp_mul(int32_t a, int32_t b)
+{
+	return (int32_t)(((int64_t)a * b) >> 16);
+}
+
+/**
+ * @brief Divide two Q16.16 values
+ *
+ * @return int32_t a / b, 0 if b is 0
+ */
+static inline int32_t fp_div(int32_t a, int32_t b)
+{
+	if (b == 0)
+	{
+		return 0;
+	}
+	return (int32_t)(((int64_t)a << 16) / b);
+}
+
+/**
+ * @brief Binary logarithm of a positive Q16.16 value
+ *        Integer part by normalization, fraction by repeated squaring
+ *
+ * @param x Q16.16 value, must be > 0
+ * @return int32_t log2(x) in Q16.16, INT32_MIN if x is 0
+ */
+static inline int32_t fp_log2(uint32_t x)
+{
+	if (x == 0)
+	{
+		return INT32_MIN;
+	}
+
+	int32_t result = 0;
+	while (x >= (uint32_t)(2 * FP_ONE))
+	{
+		x >>= 1;
+		result += FP_ONE;
+	}
+	while (x < (uint32_t)FP_ONE)
+	{
+		x <<= 1;
+		result -= FP_ONE;
+	}
+	for (int32_t bit = FP_ONE >> 1; bit > 0; bit >>= 1)
+	{
+		x = (uint32_t)(((uint64_t)x * x) >> 16);
+		if (x >= (uint32_t)(2 * FP_ONE))
+		{
+			x >>= 1;
+			result += bit;
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Binary exponent of a Q16.16 value
+ *        Fraction by a cubic polynomial, error < 1e-4
+ *
+ * @param x Q16.16 exponent
+ * @return uint32_t 2^x in Q16.16, saturates at UINT32_MAX
+ */
+static inline uint32_t fp_exp2(int32_t x)
+{
+	int32_t int_part = x >> 16;
+	uint64_t frac = (uint32_t)x & 0xFFFF;
+
+	// 2^f ~ 1 + 0.6951786 f + 0.2261487 f^2 + 0.0786727 f^3
+	uint64_t poly = 5156;
+	poly = 14821 + ((poly * frac) >> 16);
+	poly = 45559 + ((poly * frac) >> 16);
+	uint32_t result = (uint32_t)(FP_ONE + ((poly * frac) >> 16));
+
+	if (int_part >= 15)
+	{
+		return UINT32_MAX;
+	}
+	if (int_part >= 0)
+	{
+		return result << int_part;
+	}
+	if (int_part <= -32)
+	{
+		return 0;
+	}
+	return result >> (-int_part);
+}
+
+/**
+ * @brief Natural logarithm of a positive Q16.16 value
+ */
+static inline int32_t fp_ln(uint32_t x)
+{
+	return fp_mul(fp_log2(x), FP_LN2);
+}
+
+/**
+ * @brief Natural exponent of a Q16.16 value
+ */
+static inline uint32_t fp_exp(int32_t x)
+{
+	return fp_exp2(fp_mul(x, FP_LOG2E));
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file forecast.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Uplink suppression with a forecaster per sensor value
+ *        A frame is only sent if a value deviates from the forecast that the
+ *        backend calculates from the transmitted frames (forecast.h)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "forecast.h"
+#include <atomic>
+
+/** Forecaster state per channel, mirrors the state of the backend */
+static forecast_s fc_state[FC_CH_NUM];
+/** Frames since the last transmitted frame, including the current one */
+static uint8_t fc_frame_steps = 0;
+/** Suppressed frames since the last restart of the forecasters */
+static uint32_t fc_suppressed = 0;
+/** Restart requests, after boot or a lost frame. Only written by the LoRa/BLE core */
+static std::atomic<uint32_t> fc_resync_count(1);
+/** Restart requests handled by the acquisition. A flag set by one core and cleared
+ *  by the other could lose a request that arrives while the frame is encoded */
+static uint32_t fc_resync_done = 0;
+
+/**
+ * @brief Restart the forecasters with the next frame
+ *        Called on the LoRa/BLE core if a frame was not received by the backend
+ *
+ */
+void forecast_resync(void)
+{
+	fc_resync_count.store(fc_resync_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Decide if the encoded frame has to be sent
+ *        Called at the end of the acquisition with the sensor values in g_solution_data.
+ *        If the frame is sent, the forecasters are updated with its values and
+ *        the number of frames since the last sent frame is added to the payload.
+ *        Step 0 tells the backend to restart its forecasters. Without confirmed
+ *        uplinks the device does not see lost frames, the forecasters are restarted
+ *        with the first sent frame after FC_RESYNC_STEPS suppressed frames.
+ *        A frame without sensor values (battery protection) is always sent and
+ *        restarts the forecasters, like forecast_resync() does for the next frame.
+ *        Without the steps entry the backend would read step 0 and restart alone
+ *
+ * @param confirmed true if lost frames are reported by forecast_resync()
+ * @param has_values false if the frame has no sensor values
+ * @return true if the frame must be sent
+ * @return false if all values are within the bounds of their forecast
+ */
+bool forecast_check(bool confirmed, bool has_values)
+{
+	if (!g_acq_settings.forecast_enable)
+	{
+		return true;
+	}
+	uint32_t resync_count = fc_resync_count.load(std::memory_order_acquire);
+	bool fc_resync = (resync_count != fc_resync_done) || !has_values;
+	bool fc_periodic = !confirmed && (fc_suppressed >= FC_RESYNC_STEPS);
+
+	int32_t values[FC_CH_NUM];
+	uint8_t steps;
+	uint8_t present = fc_lpp_values(g_solution_data.getBuffer(), g_solution_data.getSize(), values, &steps);
+	fc_frame_steps++;
+
+	uint8_t reason = has_values ? fc_must_send(fc_state, values, present, fc_frame_steps) : 0;
+	if ((reason == 0) && !fc_resync)
+	{
+		MYLOG("FCAST", "All values within forecast, frame %d suppressed", fc_frame_steps);
+		fc_suppressed++;
+		return false;
+	}
+	MYLOG("FCAST", "Frame sent, channels 0x%02X outside of forecast", reason);
+
+	if (fc_resync || fc_periodic)
+	{
+		fc_resync_done = resync_count;
+		fc_frame_steps = 0;
+		fc_suppressed = 0;
+	}
+	// Same update as the backend does when it receives the frame
+	fc_receive(fc_state, values, present, fc_frame_steps);
+	g_solution_data.addDigitalInput(FC_LPP_CH_STEPS, fc_frame_steps);
+	fc_frame_steps = 0;
+	return true;
+}
+
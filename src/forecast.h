@@ -0,0 +1,299 @@
+/**
+ * @file forecast.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Fixed-point double exponential smoothing (Holt) forecaster
+ *        Shared by the device (forecast.cpp) and the backend (tools/forecast_replay.cpp).
+ *        Integer only with explicit rounding, device and host calculate bit-identical
+ *        forecasts from the same transmitted values
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <stdint.h>
+
+/** Fraction bits of level and trend */
+#define FC_SHIFT 8
+/** Weights alpha and beta are in 1/256 */
+#define FC_WEIGHT_ONE 256
+
+/** Frames without a transmitted value before one is forced (heartbeat) */
+#define FC_MAX_STEPS 24
+/** Suppressed frames after which the next sent frame restarts the forecasters if uplinks are
+ *  not confirmed. The device does not see a lost unconfirmed frame, the backend sees the
+ *  gap in the frame counter and has no valid forecast until the next restart */
+#define FC_RESYNC_STEPS 6
+
+/** Forecasted channels of the WisBlock Kit 1, values as encoded in the Cayenne LPP payload */
+enum fc_channel_e
+{
+	FC_CH_TEMP = 0, // 1/10 degC
+	FC_CH_HUMID,	// 1/2 %
+	FC_CH_PRESS,	// 1/10 hPa
+	FC_CH_LIGHT,	// lux
+	FC_CH_NUM
+};
+
+/** Cayenne LPP channel and type of the forecasted values, must match src/app.h. The derived values on channels 30 to 34 are not forecasted */
+static const uint8_t fc_lpp_channel[FC_CH_NUM] = {3, 2, 8, 5};
+static const uint8_t fc_lpp_type[FC_CH_NUM] = {0x67, 0x68, 0x73, 0x65};
+/** Channel of the number of frames since the last transmitted frame (LPP digital input) */
+#define FC_LPP_CH_STEPS 25
+
+/** Forecaster parameters of one channel */
+struct forecast_cfg_s
+{
+	uint16_t alpha;		// Level weight of a new value, 1/256
+	uint16_t beta;		// Trend weight of a new value, 1/256
+	int32_t bound;		// Allowed deviation from the forecast in channel units
+	uint16_t bound_rel; // Additional deviation relative to the forecast, 1/256
+};
+
+/** Parameters of the Kit 1 channels, device and backend must use the same
+ *  Values are only seen when they left the bound, so the level follows them completely
+ *  and only the trend is smoothed (see tools/forecast_replay.cpp) */
+static const forecast_cfg_s fc_kit1_cfg[FC_CH_NUM] = {
+	{256, 128, 5, 0},  // FC_CH_TEMP, 0.5 degC
+	{256, 128, 6, 0},  // FC_CH_HUMID, 3 %
+	{256, 128, 5, 0},  // FC_CH_PRESS, 0.5 hPa
+	{256, 128, 20, 38} // FC_CH_LIGHT, 20 lux + 15 %
+};
+
+/** Forecaster state of one channel, only changed by transmitted values */
+struct forecast_s
+{
+	int32_t level;	// Level in channel units << FC_SHIFT
+	int32_t trend;	// Trend per step in channel units << FC_SHIFT
+	uint16_t steps; // Steps since the last transmitted value
+	uint8_t init;	// 1 after the first transmitted value
+};
+
+/**
+ * @brief Division rounded half away from zero
+ *        Same result on every compiler, unlike shifts of negative values
+ *
+ * @param num numerator
+ * @param den denominator, > 0
+ * @return int32_t rounded quotient
+ */
+static inline int32_t fc_round_div(int64_t num, int64_t den)
+{
+	return (int32_t)(num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den));
+}
+
+/**
+ * @brief Reset the state of a channel
+ *
+ * @param state channel state
+ */
+static inline void fc_reset(forecast_s *state)
+{
+	state->level = 0;
+	state->trend = 0;
+	state->steps = 0;
+	state->init = 0;
+}
+
+/**
+ * @brief Forecast of the channel
+ *
+ * @param state channel state
+ * @param steps steps after the last transmitted value
+ * @return int32_t forecast in channel units << FC_SHIFT
+ */
+static inline int32_t fc_predict_raw(const forecast_s *state, uint32_t steps)
+{
+	return (int32_t)(state->level + (int64_t)state->trend * steps);
+}
+
+/**
+ * @brief Forecast of the channel in channel units
+ *
+ * @param state channel state
+ * @param steps steps after the last transmitted value
+ * @return int32_t forecast, rounded
+ */
+static inline int32_t fc_predict(const forecast_s *state, uint32_t steps)
+{
+	return fc_round_div(fc_predict_raw(state, steps), 1 << FC_SHIFT);
+}
+
+/**
+ * @brief Check if a value deviates too much from the forecast
+ *
+ * @param state channel state
+ * @param cfg channel parameters
+ * @param value measured value in channel units
+ * @param steps steps after the last transmitted value
+ * @return true if the value must be transmitted
+ */
+static inline bool fc_exceeds(const forecast_s *state, const forecast_cfg_s *cfg, int32_t value, uint32_t steps)
+{
+	if (!state->init)
+	{
+		return true;
+	}
+	int64_t forecast = fc_predict_raw(state, steps);
+	int64_t error = (int64_t)value * (1 << FC_SHIFT) - forecast;
+	int64_t abs_forecast = forecast >= 0 ? forecast : -forecast;
+	int64_t bound = (int64_t)cfg->bound * (1 << FC_SHIFT) + abs_forecast * cfg->bound_rel / FC_WEIGHT_ONE;
+	return (error > bound) || (-error > bound);
+}
+
+/**
+ * @brief Add steps without a transmitted value of the channel
+ *
+ * @param state channel state
+ * @param steps steps to add
+ */
+static inline void fc_advance(forecast_s *state, uint32_t steps)
+{
+	uint32_t total = state->steps + steps;
+	state->steps = total > 0xFFFF ? 0xFFFF : (uint16_t)total;
+}
+
+/**
+ * @brief Update the state with a transmitted value
+ *        Holt's method over state->steps steps since the last transmitted value
+ *
+ * @param state channel state
+ * @param cfg channel parameters
+ * @param value transmitted value in channel units
+ */
+static inline void fc_update(forecast_s *state, const forecast_cfg_s *cfg, int32_t value)
+{
+	int32_t value_raw = value * (1 << FC_SHIFT);
+	uint32_t steps = state->steps != 0 ? state->steps : 1;
+	state->steps = 0;
+	if (!state->init)
+	{
+		state->level = value_raw;
+		state->trend = 0;
+		state->init = 1;
+		return;
+	}
+	int32_t forecast = fc_predict_raw(state, steps);
+	int32_t level = forecast + fc_round_div((int64_t)(value_raw - forecast) * cfg->alpha, FC_WEIGHT_ONE);
+	int32_t slope = fc_round_div((int64_t)level - state->level, steps);
+	state->trend = state->trend + fc_round_div((int64_t)(slope - state->trend) * cfg->beta, FC_WEIGHT_ONE);
+	state->level = level;
+}
+
+/**
+ * @brief Check if a frame must be transmitted
+ *
+ * @param states state of the FC_CH_NUM channels
+ * @param values measured values
+ * @param present bit n set if channel n was measured
+ * @param frame_steps frames since the last transmitted frame, including this one
+ * @return uint8_t bit n set if channel n is outside of its bound,
+ *                 0x80 if the heartbeat is due, 0 if the frame can be skipped
+ */
+static inline uint8_t fc_must_send(const forecast_s *states, const int32_t *values, uint8_t present, uint8_t frame_steps)
+{
+	uint8_t result = frame_steps >= FC_MAX_STEPS ? 0x80 : 0;
+	for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+	{
+		if ((present & (1 << ch)) && fc_exceeds(&states[ch], &fc_kit1_cfg[ch], values[ch], states[ch].steps + frame_steps))
+		{
+			result |= (uint8_t)(1 << ch);
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Update all channels with a transmitted frame
+ *        Runs on the device when a frame is sent and on the backend when it is received
+ *
+ * @param states state of the FC_CH_NUM channels
+ * @param values values of the frame
+ * @param present bit n set if channel n is in the frame
+ * @param steps frames since the last transmitted frame, 0 restarts the forecasters
+ */
+static inline void fc_receive(forecast_s *states, const int32_t *values, uint8_t present, uint8_t steps)
+{
+	for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+	{
+		if (steps == 0)
+		{
+			fc_reset(&states[ch]);
+		}
+		fc_advance(&states[ch], steps);
+		if (present & (1 << ch))
+		{
+			fc_update(&states[ch], &fc_kit1_cfg[ch], values[ch]);
+		}
+	}
+}
+
+/**
+ * @brief Get the forecasted values from a Cayenne LPP payload
+ *        Device and backend use the encoded values, so both see the same integers
+ *
+ * @param data payload
+ * @param len payload length
+ * @param values returns the values of the channels found
+ * @param steps returns the steps entry, 0 if not found
+ * @return uint8_t bit n set if channel n was found, 0 if the payload has an unknown type
+ */
+static inline uint8_t fc_lpp_values(const uint8_t *data, uint8_t len, int32_t *values, uint8_t *steps)
+{
+	uint8_t present = 0;
+	uint8_t pos = 0;
+	*steps = 0;
+	while (pos + 2 <= len)
+	{
+		uint8_t channel = data[pos];
+		uint8_t type = data[pos + 1];
+		uint8_t size;
+		switch (type)
+		{
+		case 0x00: // Digital input
+		case 0x68: // Relative humidity
+			size = 1;
+			break;
+		case 0x02: // Analog input
+		case 0x65: // Luminosity
+		case 0x67: // Temperature
+		case 0x73: // Barometric pressure
+		case 0x74: // Voltage
+		case 0x79: // Altitude
+			size = 2;
+			break;
+		case 0x85: // Unix time
+		case 0xFF: // Device ID
+			size = 4;
+			break;
+		default:
+			return 0;
+		}
+		if (pos + 2 + size > len)
+		{
+			return 0;
+		}
+		const uint8_t *value = &data[pos + 2];
+		for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+		{
+			if ((channel == fc_lpp_channel[ch]) && (type == fc_lpp_type[ch]))
+			{
+				// Temperature is signed, the other values unsigned
+				values[ch] = size == 1 ? value[0] : type == 0x67 ? (int16_t)((value[0] << 8) | value[1]) : (value[0] << 8) | value[1];
+				present |= (uint8_t)(1 << ch);
+			}
+		}
+		if ((channel == FC_LPP_CH_STEPS) && (type == 0x00))
+		{
+			*steps = value[0];
+		}
+		pos += 2 + size;
+	}
+	return present;
+}
+
+#endif
@@ -0,0 +1,546 @@
+/**
+ * @file i2c_async.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief I2C transport for the sensor drivers
+ *        RAK4631: TWIM0 with EasyDMA. The Adafruit core owns the TWIM interrupt
+ *        handlers for the Wire classes, so the STOPPED event is routed through
+ *        PPI to EGU3 and handled in its interrupt. An ERROR event triggers the
+ *        STOP task through a second PPI channel.
+ *        RAK11300 and RAK3112: blocking Wire calls, transactions finish in i2c_submit()
+ *        After a timeout or bus error the bus is cleared with clock pulses and a STOP
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "i2c_async.h"
+#include "spsc_queue.h"
+
+/**
+ * @brief Finish a transaction, run the callback and post the app event
+ *
+ * @param xfer finished transaction
+ * @param result result of the transaction
+ */
+static void i2c_complete(i2c_xfer_s *xfer, i2c_result_e result)
+{
+	xfer->result = result;
+	if (xfer->callback != NULL)
+	{
+		xfer->callback(xfer);
+	}
+	if (xfer->event != 0)
+	{
+#if defined NRF52_SERIES
+		g_task_event_type |= xfer->event;
+		xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+#else
+		api_wake_loop(xfer->event);
+#endif
+	}
+}
+
+/** Half period of the bus clear clock, 100 kHz */
+#define I2C_CLEAR_HALF_US 5
+
+/** Bus clear could not release the lines, transactions fail without waiting for the deadline */
+static bool i2c_stuck = false;
+/** Bus clock for the re-initialization after a bus clear */
+static uint32_t i2c_frequency = 100000;
+
+/**
+ * @brief Drive a bus line like an open drain output
+ *
+ * @param pin Arduino pin number
+ * @param high true releases the line to the pull-up, false pulls it low
+ */
+static void i2c_line(uint32_t pin, bool high)
+{
+	if (high)
+	{
+		pinMode(pin, INPUT_PULLUP);
+	}
+	else
+	{
+		pinMode(pin, OUTPUT);
+		digitalWrite(pin, LOW);
+	}
+	delayMicroseconds(I2C_CLEAR_HALF_US);
+}
+
+/**
+ * @brief Bus clear (UM10204 3.1.16), the peripheral must not own the pins
+ *        A device that was stopped in the middle of a read holds SDA low. Up to
+ *        9 clock pulses let it shift out the rest of its byte, the following
+ *        STOP resets its interface
+ *
+ * @return true if SDA and SCL are released
+ */
+static bool i2c_clear_lines(void)
+{
+	i2c_line(PIN_WIRE_SDA, true);
+	i2c_line(PIN_WIRE_SCL, true);
+	for (uint8_t pulse = 0; (pulse < 9) && (digitalRead(PIN_WIRE_SDA) == LOW); pulse++)
+	{
+		i2c_line(PIN_WIRE_SCL, false);
+		i2c_line(PIN_WIRE_SCL, true);
+	}
+	// STOP, SDA rises while SCL is high
+	i2c_line(PIN_WIRE_SCL, false);
+	i2c_line(PIN_WIRE_SDA, false);
+	i2c_line(PIN_WIRE_SCL, true);
+	i2c_line(PIN_WIRE_SDA, true);
+	return (digitalRead(PIN_WIRE_SDA) == HIGH) && (digitalRead(PIN_WIRE_SCL) == HIGH);
+}
+
+#if defined NRF52_SERIES
+#include <nrf_soc.h>
+#include <nrf_sdm.h>
+
+/** TWIM instance, shared with the Wire class which is not used */
+#define I2C_TWIM NRF_TWIM0
+/** Event generator for the completion interrupt */
+#define I2C_EGU NRF_EGU3
+#define I2C_EGU_IRQn SWI3_EGU3_IRQn
+/** PPI channels, outside of the channels reserved by the SoftDevice */
+#define I2C_PPI_DONE 14
+#define I2C_PPI_ERROR 15
+/** Interrupt priority, allowed to call FreeRTOS functions */
+#define I2C_IRQ_PRIO 3
+
+/** Queued transactions, written by the task, read by the interrupt */
+static spsc_queue<i2c_xfer_s *, I2C_QUEUE_SIZE> i2c_queue;
+/** Running transaction, NULL if the bus is idle */
+static i2c_xfer_s *volatile i2c_current = NULL;
+/** Target of address only transactions */
+static uint8_t i2c_scratch;
+
+/**
+ * @brief Connect a TWIM event to a task through PPI
+ *        With the SoftDevice enabled the PPI is only accessible through its API
+ *
+ * @param channel PPI channel
+ * @param event event register
+ * @param task task register
+ */
+static void i2c_ppi_connect(uint8_t channel, volatile uint32_t *event, volatile uint32_t *task)
+{
+	uint8_t sd_enabled = 0;
+	sd_softdevice_is_enabled(&sd_enabled);
+	if (sd_enabled)
+	{
+		sd_ppi_channel_assign(channel, event, task);
+		sd_ppi_channel_enable_set(1UL << channel);
+	}
+	else
+	{
+		NRF_PPI->CH[channel].EEP = (uint32_t)event;
+		NRF_PPI->CH[channel].TEP = (uint32_t)task;
+		NRF_PPI->CHENSET = 1UL << channel;
+	}
+}
+
+/**
+ * @brief Configure a bus pin as open drain input with pull-up
+ *
+ * @param pin Arduino pin number
+ * @return uint32_t nRF pin number
+ */
+static uint32_t i2c_pin(uint32_t pin)
+{
+	uint32_t nrf_pin = g_ADigitalPinMap[pin];
+	uint32_t port_pin = nrf_pin;
+	NRF_GPIO_Type *port = nrf_gpio_pin_port_decode(&port_pin);
+	port->PIN_CNF[port_pin] = (GPIO_PIN_CNF_DIR_Input << GPIO_PIN_CNF_DIR_Pos) |
+							  (GPIO_PIN_CNF_INPUT_Connect << GPIO_PIN_CNF_INPUT_Pos) |
+							  (GPIO_PIN_CNF_PULL_Pullup << GPIO_PIN_CNF_PULL_Pos) |
+							  (GPIO_PIN_CNF_DRIVE_S0D1 << GPIO_PIN_CNF_DRIVE_Pos) |
+							  (GPIO_PIN_CNF_SENSE_Disabled << GPIO_PIN_CNF_SENSE_Pos);
+	return nrf_pin;
+}
+
+/**
+ * @brief Start a transaction on the TWIM
+ *        The shorts chain write, repeated start, read and STOP without the CPU
+ *
+ * @param xfer transaction to start
+ */
+static void i2c_start(i2c_xfer_s *xfer)
+{
+	i2c_current = xfer;
+	uint8_t *rx_buf = xfer->rx_buf;
+	uint8_t rx_len = xfer->rx_len;
+	if ((xfer->tx_len == 0) && (rx_len == 0))
+	{
+		// TWIM can not send only the address, a 1 byte read checks the ACK as well
+		rx_buf = &i2c_scratch;
+		rx_len = 1;
+	}
+
+	I2C_TWIM->EVENTS_STOPPED = 0;
+	I2C_TWIM->EVENTS_ERROR = 0;
+	I2C_TWIM->ERRORSRC = I2C_TWIM->ERRORSRC;
+	I2C_TWIM->ADDRESS = xfer->addr;
+	I2C_TWIM->TXD.PTR = (uint32_t)xfer->tx;
+	I2C_TWIM->TXD.MAXCNT = xfer->tx_len;
+	I2C_TWIM->RXD.PTR = (uint32_t)rx_buf;
+	I2C_TWIM->RXD.MAXCNT = rx_len;
+	if (xfer->tx_len == 0)
+	{
+		I2C_TWIM->SHORTS = TWIM_SHORTS_LASTRX_STOP_Msk;
+		I2C_TWIM->TASKS_RESUME = 1;
+		I2C_TWIM->TASKS_STARTRX = 1;
+	}
+	else
+	{
+		I2C_TWIM->SHORTS = rx_len == 0 ? TWIM_SHORTS_LASTTX_STOP_Msk : (TWIM_SHORTS_LASTTX_STARTRX_Msk | TWIM_SHORTS_LASTRX_STOP_Msk);
+		I2C_TWIM->TASKS_RESUME = 1;
+		I2C_TWIM->TASKS_STARTTX = 1;
+	}
+}
+
+/**
+ * @brief Start the next queued transaction if the bus is idle
+ *        Called with the completion interrupt disabled or from it
+ *
+ */
+static void i2c_next(void)
+{
+	i2c_xfer_s *xfer;
+	if ((i2c_current == NULL) && i2c_queue.pop(xfer))
+	{
+		i2c_start(xfer);
+	}
+}
+
+/**
+ * @brief Completion interrupt, the TWIM STOPPED event arrives here through PPI
+ *
+ */
+extern "C" void SWI3_EGU3_IRQHandler(void)
+{
+	I2C_EGU->EVENTS_TRIGGERED[0] = 0;
+	i2c_xfer_s *xfer = i2c_current;
+	if (xfer == NULL)
+	{
+		return;
+	}
+	i2c_result_e result = I2C_OK;
+	uint32_t error = I2C_TWIM->ERRORSRC;
+	if (I2C_TWIM->EVENTS_ERROR || (error != 0))
+	{
+		result = (error & (TWIM_ERRORSRC_ANACK_Msk | TWIM_ERRORSRC_DNACK_Msk)) ? I2C_ERR_NACK : I2C_ERR_BUS;
+	}
+	I2C_TWIM->EVENTS_ERROR = 0;
+	I2C_TWIM->ERRORSRC = error;
+	I2C_TWIM->SHORTS = 0;
+
+	i2c_current = NULL;
+	i2c_complete(xfer, result);
+	i2c_next();
+	portYIELD_FROM_ISR(g_higher_priority_task_woken);
+}
+
+/** Semaphore of the blocking transfers */
+static SemaphoreHandle_t i2c_done_sem = NULL;
+
+/**
+ * @brief Stop the TWIM after the deadline of a blocking transaction
+ *        The running and all queued transactions finish with I2C_ERR_TIMEOUT
+ *
+ * @param xfer transaction that passed its deadline
+ * @return true if it was aborted
+ * @return false if it finished before the completion interrupt was disabled
+ */
+static bool i2c_abort(i2c_xfer_s *xfer)
+{
+	NVIC_DisableIRQ(I2C_EGU_IRQn);
+	if (xfer->result != I2C_PENDING)
+	{
+		// Finished after the deadline, the semaphore was given
+		xSemaphoreTake(i2c_done_sem, 0);
+		NVIC_EnableIRQ(I2C_EGU_IRQn);
+		return false;
+	}
+	I2C_TWIM->SHORTS = 0;
+	I2C_TWIM->TASKS_STOP = 1;
+	// STOP can not finish while a device holds SCL low
+	for (uint8_t wait = 0; (wait < 100) && !I2C_TWIM->EVENTS_STOPPED; wait++)
+	{
+		delayMicroseconds(1);
+	}
+	I2C_TWIM->ENABLE = TWIM_ENABLE_ENABLE_Disabled << TWIM_ENABLE_ENABLE_Pos;
+
+	i2c_xfer_s *aborted = i2c_current;
+	i2c_current = NULL;
+	if (aborted != NULL)
+	{
+		i2c_complete(aborted, I2C_ERR_TIMEOUT);
+	}
+	while (i2c_queue.pop(aborted))
+	{
+		i2c_complete(aborted, I2C_ERR_TIMEOUT);
+	}
+	// The completion callback gave the semaphore
+	xSemaphoreTake(i2c_done_sem, 0);
+	I2C_EGU->EVENTS_TRIGGERED[0] = 0;
+	NVIC_ClearPendingIRQ(I2C_EGU_IRQn);
+	NVIC_EnableIRQ(I2C_EGU_IRQn);
+	return true;
+}
+
+/**
+ * @brief Completion callback of the blocking transfers
+ *
+ * @param xfer finished transaction
+ */
+static void i2c_wake_task(i2c_xfer_s *xfer)
+{
+	xSemaphoreGiveFromISR(i2c_done_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Initialize TWIM0 on the WisBlock I2C pins
+ *
+ * @param frequency bus clock, 100000 or 400000
+ * @return true if initialized
+ */
+bool i2c_init(uint32_t frequency)
+{
+	if (i2c_done_sem == NULL)
+	{
+		i2c_done_sem = xSemaphoreCreateBinary();
+	}
+	i2c_frequency = frequency;
+	I2C_TWIM->ENABLE = TWIM_ENABLE_ENABLE_Disabled << TWIM_ENABLE_ENABLE_Pos;
+	I2C_TWIM->PSEL.SCL = i2c_pin(PIN_WIRE_SCL);
+	I2C_TWIM->PSEL.SDA = i2c_pin(PIN_WIRE_SDA);
+	I2C_TWIM->FREQUENCY = frequency >= 400000 ? TWIM_FREQUENCY_FREQUENCY_K400 : TWIM_FREQUENCY_FREQUENCY_K100;
+	// No TWIM interrupts, completion goes through PPI and EGU
+	I2C_TWIM->INTENCLR = 0xFFFFFFFF;
+	I2C_TWIM->SHORTS = 0;
+	I2C_TWIM->ENABLE = TWIM_ENABLE_ENABLE_Enabled << TWIM_ENABLE_ENABLE_Pos;
+
+	i2c_ppi_connect(I2C_PPI_DONE, &I2C_TWIM->EVENTS_STOPPED, &I2C_EGU->TASKS_TRIGGER[0]);
+	i2c_ppi_connect(I2C_PPI_ERROR, &I2C_TWIM->EVENTS_ERROR, &I2C_TWIM->TASKS_STOP);
+
+	I2C_EGU->EVENTS_TRIGGERED[0] = 0;
+	I2C_EGU->INTENSET = EGU_INTENSET_TRIGGERED0_Msk;
+	NVIC_ClearPendingIRQ(I2C_EGU_IRQn);
+	NVIC_SetPriority(I2C_EGU_IRQn, I2C_IRQ_PRIO);
+	NVIC_EnableIRQ(I2C_EGU_IRQn);
+	return i2c_done_sem != NULL;
+}
+
+/**
+ * @brief Queue a transaction, the callback is called from the interrupt
+ *
+ * @param xfer transaction, must stay valid until it is finished
+ * @return true if queued
+ * @return false if the queue is full or the transaction is invalid
+ */
+bool i2c_submit(i2c_xfer_s *xfer)
+{
+	if ((xfer->tx_len > I2C_TX_MAX) || ((xfer->rx_len != 0) && (xfer->rx_buf == NULL)))
+	{
+		xfer->result = I2C_ERR_QUEUE;
+		return false;
+	}
+	xfer->result = I2C_PENDING;
+	if (!i2c_queue.push(xfer))
+	{
+		xfer->result = I2C_ERR_QUEUE;
+		return false;
+	}
+	NVIC_DisableIRQ(I2C_EGU_IRQn);
+	i2c_next();
+	NVIC_EnableIRQ(I2C_EGU_IRQn);
+	return true;
+}
+
+/**
+ * @brief Blocking transaction, the task sleeps until the transfer is finished
+ *
+ * @param addr device address
+ * @param tx data to write, can be NULL if tx_len is 0
+ * @param tx_len number of bytes to write
+ * @param rx buffer for the read data, can be NULL if rx_len is 0
+ * @param rx_len number of bytes to read
+ * @return i2c_result_e result of the transaction
+ */
+i2c_result_e i2c_transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len)
+{
+	if (tx_len > I2C_TX_MAX)
+	{
+		return I2C_ERR_QUEUE;
+	}
+	i2c_xfer_s xfer = {};
+	xfer.addr = addr;
+	memcpy(xfer.tx, tx, tx_len);
+	xfer.tx_len = tx_len;
+	xfer.rx_buf = rx;
+	xfer.rx_len = rx_len;
+	xfer.callback = i2c_wake_task;
+	if (i2c_stuck && !i2c_bus_clear())
+	{
+		return I2C_ERR_BUS;
+	}
+	if (!i2c_submit(&xfer))
+	{
+		return I2C_ERR_QUEUE;
+	}
+	if ((xSemaphoreTake(i2c_done_sem, pdMS_TO_TICKS(I2C_TIMEOUT_MS)) != pdTRUE) && i2c_abort(&xfer))
+	{
+		MYLOG("I2C", "Timeout 0x%02X", addr);
+		i2c_bus_clear();
+	}
+	return (i2c_result_e)xfer.result;
+}
+
+/**
+ * @brief Bus clear after a timeout and re-initialization of the TWIM
+ *
+ * @return true if the bus lines are released
+ */
+bool i2c_bus_clear(void)
+{
+	// GPIO controls the pins only while the TWIM is disabled
+	I2C_TWIM->ENABLE = TWIM_ENABLE_ENABLE_Disabled << TWIM_ENABLE_ENABLE_Pos;
+	i2c_stuck = !i2c_clear_lines();
+	i2c_init(i2c_frequency);
+	MYLOG("I2C", "Bus clear, lines %s", i2c_stuck ? "stuck" : "released");
+	return !i2c_stuck;
+}
+
+#else
+/**
+ * @brief Initialize the Wire class
+ *
+ * @param frequency bus clock
+ * @return true
+ */
+bool i2c_init(uint32_t frequency)
+{
+	i2c_frequency = frequency;
+	Wire.begin();
+	Wire.setClock(frequency);
+#if defined ESP32
+	Wire.setTimeOut(I2C_TIMEOUT_MS);
+#endif
+	return true;
+}
+
+/**
+ * @brief Run a transaction with the Wire class, finished on return
+ *
+ * @param xfer transaction
+ * @return true if the transaction was run
+ * @return false if the transaction is invalid
+ */
+bool i2c_submit(i2c_xfer_s *xfer)
+{
+	if ((xfer->tx_len > I2C_TX_MAX) || ((xfer->rx_len != 0) && (xfer->rx_buf == NULL)))
+	{
+		xfer->result = I2C_ERR_QUEUE;
+		return false;
+	}
+	if ((xfer->tx_len != 0) || (xfer->rx_len == 0))
+	{
+		Wire.beginTransmission(xfer->addr);
+		Wire.write(xfer->tx, xfer->tx_len);
+		// 2 = address NACK, 3 = data NACK, 5 = timeout (ESP32)
+		uint8_t status = Wire.endTransmission(xfer->rx_len == 0);
+		if (status != 0)
+		{
+			i2c_complete(xfer, (status == 2) || (status == 3) ? I2C_ERR_NACK : status == 5 ? I2C_ERR_TIMEOUT : I2C_ERR_BUS);
+			return true;
+		}
+	}
+	if (xfer->rx_len != 0)
+	{
+		if (Wire.requestFrom(xfer->addr, xfer->rx_len) != xfer->rx_len)
+		{
+			i2c_complete(xfer, I2C_ERR_NACK);
+			return true;
+		}
+		for (uint8_t idx = 0; idx < xfer->rx_len; idx++)
+		{
+			xfer->rx_buf[idx] = Wire.read();
+		}
+	}
+	i2c_complete(xfer, I2C_OK);
+	return true;
+}
+
+/**
+ * @brief Blocking transaction
+ *
+ * @param addr device address
+ * @param tx data to write, can be NULL if tx_len is 0
+ * @param tx_len number of bytes to write
+ * @param rx buffer for the read data, can be NULL if rx_len is 0
+ * @param rx_len number of bytes to read
+ * @return i2c_result_e result of the transaction
+ */
+i2c_result_e i2c_transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len)
+{
+	if (tx_len > I2C_TX_MAX)
+	{
+		return I2C_ERR_QUEUE;
+	}
+	i2c_xfer_s xfer = {};
+	xfer.addr = addr;
+	memcpy(xfer.tx, tx, tx_len);
+	xfer.tx_len = tx_len;
+	xfer.rx_buf = rx;
+	xfer.rx_len = rx_len;
+	if (i2c_stuck && !i2c_bus_clear())
+	{
+		return I2C_ERR_BUS;
+	}
+	i2c_submit(&xfer);
+	if (i2c_lost((i2c_result_e)xfer.result))
+	{
+		MYLOG("I2C", "Bus error 0x%02X", addr);
+		i2c_bus_clear();
+	}
+	return (i2c_result_e)xfer.result;
+}
+
+/**
+ * @brief Bus clear after a timeout or bus error and re-initialization of the Wire class
+ *
+ * @return true if the bus lines are released
+ */
+bool i2c_bus_clear(void)
+{
+	Wire.end();
+	i2c_stuck = !i2c_clear_lines();
+	i2c_init(i2c_frequency);
+	MYLOG("I2C", "Bus clear, lines %s", i2c_stuck ? "stuck" : "released");
+	return !i2c_stuck;
+}
+#endif
+
+/**
+ * @brief Check if a device acknowledges its address
+ *
+ * @param addr device address
+ * @return true if the device answered
+ */
+bool i2c_probe(uint8_t addr)
+{
+	return i2c_transfer(addr, NULL, 0, NULL, 0) == I2C_OK;
+}
+
+/**
+ * @brief Wait for a sensor conversion, the task sleeps
+ *
+ * @param ms time in milliseconds
+ */
+void i2c_delay_ms(uint32_t ms)
+{
+	delay(ms);
+}
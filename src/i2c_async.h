@@ -0,0 +1,110 @@
+/**
+ * @file i2c_async.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Queued I2C transactions with completion callbacks
+ *        On the RAK4631 the transfers run on the TWIM peripheral with EasyDMA,
+ *        the CPU sleeps until the transfer is finished.
+ *        Blocking transactions have a deadline, after a timeout the bus is cleared.
+ *        Plain C++, a host mock of the transport is in tools/i2c_mock.cpp
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Number of transactions that can be queued */
+#define I2C_QUEUE_SIZE 8
+/** Largest write part of a transaction, register address + data */
+#define I2C_TX_MAX 8
+/** Deadline of a blocking transaction, a full queue at 100 kHz needs ~8 ms */
+#define I2C_TIMEOUT_MS 20
+
+/** Result of a transaction */
+enum i2c_result_e
+{
+	I2C_OK = 0,		  // Transaction finished
+	I2C_PENDING,	  // Transaction queued or running
+	I2C_ERR_NACK,	  // Address or data not acknowledged
+	I2C_ERR_BUS,	  // Bus error or overrun
+	I2C_ERR_QUEUE,	  // Queue full or invalid transaction
+	I2C_ERR_TIMEOUT,  // Deadline passed, the bus was cleared
+};
+
+struct i2c_xfer_s;
+/** Completion callback, called from the interrupt on the RAK4631 */
+typedef void (*i2c_callback_t)(i2c_xfer_s *xfer);
+
+/**
+ * @brief One I2C transaction, write then read with a repeated start
+ *        Write only if rx_len is 0, read only if tx_len is 0.
+ *        The structure must stay valid until the transaction is finished
+ */
+struct i2c_xfer_s
+{
+	uint8_t addr;				// 7 bit device address
+	uint8_t tx[I2C_TX_MAX];		// Data to write, copied here so EasyDMA can read it from RAM
+	uint8_t tx_len;				// Number of bytes to write
+	uint8_t *rx_buf;			// Buffer for read data, must be in RAM
+	uint8_t rx_len;				// Number of bytes to read
+	i2c_callback_t callback;	// Called when finished, can be NULL
+	void *context;				// Free for the callback
+	uint16_t event;				// App event posted when finished, 0 for none
+	volatile uint8_t result;	// i2c_result_e
+};
+
+bool i2c_init(uint32_t frequency);
+bool i2c_submit(i2c_xfer_s *xfer);
+i2c_result_e i2c_transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len);
+bool i2c_probe(uint8_t addr);
+void i2c_delay_ms(uint32_t ms);
+bool i2c_bus_clear(void);
+
+/**
+ * @brief Check if a device may have lost its configuration
+ *        After a timeout or bus error the device was stopped in the middle of a
+ *        transaction or had a power glitch, the driver writes its configuration again
+ *
+ * @param result result of a transaction
+ * @return true if the device should be re-initialized
+ */
+inline bool i2c_lost(i2c_result_e result)
+{
+	return (result == I2C_ERR_TIMEOUT) || (result == I2C_ERR_BUS);
+}
+
+/**
+ * @brief Write one register
+ *
+ * @param addr device address
+ * @param reg register address
+ * @param value register value
+ * @return true if the register was written
+ */
+inline bool i2c_write_reg8(uint8_t addr, uint8_t reg, uint8_t value)
+{
+	uint8_t tx[2] = {reg, value};
+	return i2c_transfer(addr, tx, 2, NULL, 0) == I2C_OK;
+}
+
+/**
+ * @brief Read consecutive registers
+ *
+ * @param addr device address
+ * @param reg first register address
+ * @param data returns the register values
+ * @param len number of registers
+ * @return true if the registers were read
+ */
+inline bool i2c_read_regs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len)
+{
+	return i2c_transfer(addr, &reg, 1, data, len) == I2C_OK;
+}
+
+#endif
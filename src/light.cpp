@@ -9,10 +9,7 @@
  *
  */
 #include "app.h"
-#include <ClosedCube_OPT3001.h>
-
-ClosedCube_OPT3001 opt3001;
-#define OPT3001_ADDRESS 0x44
+#include "opt3001.h"
 
 /**
  * @brief Initialize the Light sensor
@@ -22,22 +19,10 @@ ClosedCube_OPT3001 opt3001;
  */
 bool init_light(void)
 {
-	if (opt3001.begin(OPT3001_ADDRESS) != NO_ERROR)
+	// Automatic full-scale, 100 ms conversion time, continuous conversions
+	if (!opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH))
 	{
-		MYLOG("LIGHT", "Could not initialize SHTC3");
-		return false;
-	}
-	OPT3001_Config newConfig;
-
-	newConfig.RangeNumber = B1100;
-	newConfig.ConvertionTime = B0;
-	newConfig.Latch = B1;
-	newConfig.ModeOfConversionOperation = B11;
-
-	OPT3001_ErrorCode errorConfig = opt3001.writeConfig(newConfig);
-	if (errorConfig != NO_ERROR)
-	{
-		MYLOG("LIGHT", "Could not configure OPT3001");
+		MYLOG("LIGHT", "Could not initialize OPT3001");
 		return false;
 	}
 	return true;
@@ -50,16 +35,60 @@ bool init_light(void)
 void read_light()
 {
 	MYLOG("LIGHT", "Reading OPT3001");
-	OPT3001 result = opt3001.readResult();
-	if (result.error == NO_ERROR)
+	float lux;
+	if (opt3001_read(&lux))
 	{
-		MYLOG("LIGHT", "L: %.2f", result.lux);
+		MYLOG("LIGHT", "L: %.2f", lux);
 
-		g_solution_data.addLuminosity(LPP_CHANNEL_LIGHT, (uint32_t)(result.lux));
+		g_solution_data.addLuminosity(LPP_CHANNEL_LIGHT, (uint32_t)(lux));
+		g_sensor_values.light_valid = true;
 	}
 	else
 	{
+		// No fake 0 lux, acquire_frame() reports the missing reading
 		MYLOG("LIGHT", "Error reading OPT3001");
-		g_solution_data.addLuminosity(LPP_CHANNEL_LIGHT, 0);
+		g_sensor_values.light_valid = false;
+	}
+}
+
+/**
+ * @brief Switch the OPT3001 to 100 ms conversion time for burst capture
+ *        PROFILE_PRECISION uses 800 ms, the burst needs one conversion per light sample
+ *
+ */
+void start_light_burst(void)
+{
+	if (!get_profile()->opt3001_800ms)
+	{
+		return;
+	}
+	opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH);
+	// Wait for the first 100 ms conversion, the result register still has the last 800 ms conversion
+	delay(110);
+}
+
+/**
+ * @brief Read one light sample during burst capture
+ *        OPT3001 is in continuous mode with 100 ms conversion time
+ *
+ * @param value returns light in lux
+ * @return true if reading was successful
+ * @return false if reading failed
+ */
+bool read_light_sample(float *value)
+{
+	return opt3001_read(value);
+}
+
+/**
+ * @brief Restore the conversion time of the profile after burst capture
+ *
+ */
+void stop_light_burst(void)
+{
+	if (!get_profile()->opt3001_800ms)
+	{
+		return;
 	}
+	opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH | OPT3001_CFG_800MS);
 }
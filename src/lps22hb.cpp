@@ -0,0 +1,143 @@
+/**
+ * @file lps22hb.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief LPS22HB pressure sensor (RAK1902) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lps22hb.h"
+#include "i2c_async.h"
+
+/** Registers */
+#define LPS22HB_WHO_AM_I 0x0F
+#define LPS22HB_CTRL_REG1 0x10
+#define LPS22HB_CTRL_REG2 0x11
+#define LPS22HB_RES_CONF 0x1A
+#define LPS22HB_PRESS_OUT_XL 0x28
+
+/** Register values */
+#define LPS22HB_ID 0xB1
+#define LPS22HB_CTRL1_BDU 0x02
+#define LPS22HB_CTRL2_IF_ADD_INC 0x10
+#define LPS22HB_CTRL2_SWRESET 0x04
+#define LPS22HB_RES_LC_EN 0x01
+
+/** Configuration written by the driver, written again after a lost transaction */
+static uint8_t lps22hb_rate = LPS22HB_RATE_ONE_SHOT;
+static uint8_t lps22hb_res_conf = 0;
+
+/**
+ * @brief Check the ID and reset the sensor
+ *
+ * @return true if an LPS22HB was found
+ */
+static bool lps22hb_reset(void)
+{
+	uint8_t id;
+	if (!i2c_read_regs(LPS22HB_ADDRESS, LPS22HB_WHO_AM_I, &id, 1) || (id != LPS22HB_ID))
+	{
+		return false;
+	}
+	if (!i2c_write_reg8(LPS22HB_ADDRESS, LPS22HB_CTRL_REG2, LPS22HB_CTRL2_IF_ADD_INC | LPS22HB_CTRL2_SWRESET))
+	{
+		return false;
+	}
+	// Software reset takes a few us
+	i2c_delay_ms(1);
+	return true;
+}
+
+/**
+ * @brief Write a register, the sensor is re-initialized if the bus was lost
+ *
+ * @param reg register address
+ * @param value register value
+ * @return true if the register was written
+ */
+static bool lps22hb_write(uint8_t reg, uint8_t value)
+{
+	uint8_t tx[2] = {reg, value};
+	i2c_result_e result = i2c_transfer(LPS22HB_ADDRESS, tx, 2, NULL, 0);
+	if (i2c_lost(result))
+	{
+		lps22hb_restore();
+	}
+	return result == I2C_OK;
+}
+
+/**
+ * @brief Reset the sensor and set one shot mode
+ *
+ * @return true if an LPS22HB was found
+ */
+bool lps22hb_init(void)
+{
+	lps22hb_rate = LPS22HB_RATE_ONE_SHOT;
+	lps22hb_res_conf = 0;
+	return lps22hb_reset() && lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT);
+}
+
+/**
+ * @brief Reset the sensor and write the last data rate and mode again
+ *
+ * @return true if the LPS22HB was configured
+ */
+bool lps22hb_restore(void)
+{
+	return lps22hb_reset() &&
+		   i2c_write_reg8(LPS22HB_ADDRESS, LPS22HB_RES_CONF, lps22hb_res_conf) &&
+		   i2c_write_reg8(LPS22HB_ADDRESS, LPS22HB_CTRL_REG1, (uint8_t)((lps22hb_rate & 0x07) << 4) | LPS22HB_CTRL1_BDU);
+}
+
+/**
+ * @brief Set the output data rate, block data update is always on
+ *
+ * @param rate LPS22HB_RATE_xxx
+ * @return true if the register was written
+ */
+bool lps22hb_set_rate(uint8_t rate)
+{
+	lps22hb_rate = rate;
+	return lps22hb_write(LPS22HB_CTRL_REG1, (uint8_t)((rate & 0x07) << 4) | LPS22HB_CTRL1_BDU);
+}
+
+/**
+ * @brief Select low-current or low-noise mode
+ *        The mode is only changed in power down, the sensor is left in one shot mode
+ *
+ * @param low_current true for low-current mode, false for low-noise mode
+ * @return true if the registers were written
+ */
+bool lps22hb_set_low_current(bool low_current)
+{
+	lps22hb_res_conf = low_current ? LPS22HB_RES_LC_EN : 0;
+	return lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT) && lps22hb_write(LPS22HB_RES_CONF, lps22hb_res_conf);
+}
+
+/**
+ * @brief Read the last pressure conversion
+ *        The sensor is re-initialized if the bus was lost, the reading is invalid
+ *
+ * @param pressure returns the pressure in hPa
+ * @return true if the registers were read
+ */
+bool lps22hb_read(float *pressure)
+{
+	uint8_t reg = LPS22HB_PRESS_OUT_XL;
+	uint8_t raw[3];
+	i2c_result_e result = i2c_transfer(LPS22HB_ADDRESS, &reg, 1, raw, 3);
+	if (result != I2C_OK)
+	{
+		if (i2c_lost(result))
+		{
+			lps22hb_restore();
+		}
+		return false;
+	}
+	int32_t press = (int32_t)(((uint32_t)raw[2] << 24) | ((uint32_t)raw[1] << 16) | ((uint32_t)raw[0] << 8)) >> 8;
+	*pressure = press / 4096.0f;
+	return true;
+}
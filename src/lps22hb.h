@@ -0,0 +1,34 @@
+/**
+ * @file lps22hb.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief LPS22HB pressure sensor (RAK1902) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef LPS22HB_H
+#define LPS22HB_H
+
+#include <stdint.h>
+
+/** I2C address of the LPS22HB, SA0 high */
+#define LPS22HB_ADDRESS 0x5C
+
+/** Output data rates, CTRL_REG1 ODR bits */
+#define LPS22HB_RATE_ONE_SHOT 0
+#define LPS22HB_RATE_1_HZ 1
+#define LPS22HB_RATE_10_HZ 2
+#define LPS22HB_RATE_25_HZ 3
+#define LPS22HB_RATE_50_HZ 4
+#define LPS22HB_RATE_75_HZ 5
+
+bool lps22hb_init(void);
+bool lps22hb_restore(void);
+bool lps22hb_set_rate(uint8_t rate);
+bool lps22hb_set_low_current(bool low_current);
+bool lps22hb_read(float *pressure);
+
+#endif
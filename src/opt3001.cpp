@@ -0,0 +1,79 @@
+/**
+ * @file opt3001.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief OPT3001 ambient light sensor (RAK1903) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "opt3001.h"
+#include "i2c_async.h"
+
+/** Registers */
+#define OPT3001_RESULT 0x00
+#define OPT3001_CONFIG 0x01
+#define OPT3001_MANUFACTURER_ID 0x7E
+
+/** Texas Instruments manufacturer ID "TI" */
+#define OPT3001_MANUFACTURER 0x5449
+
+/** Configuration of the last opt3001_init(), written again after a lost transaction */
+static uint16_t opt3001_config = OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH;
+
+/**
+ * @brief Check the manufacturer ID and write the configuration
+ *
+ * @param config configuration register, OPT3001_CFG_xxx
+ * @return true if an OPT3001 was found and configured
+ */
+bool opt3001_init(uint16_t config)
+{
+	opt3001_config = config;
+	return opt3001_restore();
+}
+
+/**
+ * @brief Write the configuration of the last opt3001_init() again
+ *        After a power glitch the sensor is in shutdown mode
+ *
+ * @return true if the OPT3001 was configured
+ */
+bool opt3001_restore(void)
+{
+	uint8_t id[2];
+	if (!i2c_read_regs(OPT3001_ADDRESS, OPT3001_MANUFACTURER_ID, id, 2) || (((id[0] << 8) | id[1]) != OPT3001_MANUFACTURER))
+	{
+		return false;
+	}
+	uint8_t tx[3] = {OPT3001_CONFIG, (uint8_t)(opt3001_config >> 8), (uint8_t)opt3001_config};
+	return i2c_transfer(OPT3001_ADDRESS, tx, 3, NULL, 0) == I2C_OK;
+}
+
+/**
+ * @brief Read the last conversion
+ *        The sensor is re-initialized if the bus was lost, the reading is invalid
+ *
+ * @param lux returns the illuminance in lux
+ * @return true if the register was read
+ */
+bool opt3001_read(float *lux)
+{
+	uint8_t reg = OPT3001_RESULT;
+	uint8_t raw[2];
+	i2c_result_e result = i2c_transfer(OPT3001_ADDRESS, &reg, 1, raw, 2);
+	if (result != I2C_OK)
+	{
+		if (i2c_lost(result))
+		{
+			opt3001_restore();
+		}
+		return false;
+	}
+	// 4 bit exponent, 12 bit mantissa, LSB = 0.01 lux * 2^exponent
+	uint16_t mantissa = ((raw[0] & 0x0F) << 8) | raw[1];
+	uint8_t exponent = raw[0] >> 4;
+	*lux = 0.01f * (float)(1UL << exponent) * mantissa;
+	return true;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file opt3001.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief OPT3001 ambient light sensor (RAK1903) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef OPT3001_H
+#define OPT3001_H
+
+#include <stdint.h>
+
+/** I2C address of the OPT3001, ADDR pin to GND */
+#define OPT3001_ADDRESS 0x44
+
+/** Configuration: automatic full-scale, continuous conversions, latched */
+#define OPT3001_CFG_AUTO_RANGE 0xC000
+#define OPT3001_CFG_CONT 0x0600
+#define OPT3001_CFG_LATCH 0x0010
+/** Conversion time 800 ms, 100 ms if not set */
+#define OPT3001_CFG_800MS 0x0800
+
+bool opt3001_init(uint16_t config);
+bool opt3001_restore(void);
+bool opt3001_read(float *lux);
+
+#endif
@@ -0,0 +1,310 @@
+/**
+ * @file ota_delta.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Firmware update with delta images received over LoRaWAN downlinks
+ *        The new image is built in the inactive bank and only activated
+ *        after the SHA-256 of the written image was verified.
+ *        The images are not signed, the only checks are the LoRaWAN MIC of the
+ *        downlinks and the CRC32 of the old and SHA-256 of the new image in the delta
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "delta_patch.h"
+
+#if defined NRF52_SERIES
+#include "flash/flash_nrf5x.h"
+
+/** Application start, behind the SoftDevice S140 */
+#define OTA_BANK_0 0x26000
+/** Inactive bank, upper half of the space between application and InternalFS */
+#define OTA_BANK_1 0x89000
+/** Size of one bank */
+#define OTA_BANK_SIZE 0x63000
+/** Settings page of the bootloader */
+#define OTA_BL_SETTINGS 0xFF000
+/** Size of bootloader_settings_t, the rest of the page is not used */
+#define OTA_BL_SETTINGS_WORDS 8
+/** Word offset of the bank 0 CRC (lower 16 bits) in the bootloader settings */
+#define OTA_BL_BANK_0_CRC 1
+/** Word offset of the bank 0 image size in the bootloader settings */
+#define OTA_BL_BANK_0_SIZE 3
+
+/** Linker symbols for the end of the running image */
+extern uint32_t __etext;
+extern uint32_t __data_start__;
+extern uint32_t __data_end__;
+
+static bool ota_read_old(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	memcpy(buffer, (void *)(OTA_BANK_0 + offset), len);
+	return true;
+}
+
+static bool ota_write_new(uint32_t offset, const uint8_t *buffer, uint32_t len)
+{
+	if (flash_nrf5x_write(OTA_BANK_1 + offset, buffer, len) != (int)len)
+	{
+		return false;
+	}
+	flash_nrf5x_flush();
+	return true;
+}
+
+static bool ota_read_new(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	memcpy(buffer, (void *)(OTA_BANK_1 + offset), len);
+	return true;
+}
+
+static const delta_io_s ota_io = {ota_read_old, ota_write_new, ota_read_new, OTA_BANK_SIZE};
+
+/**
+ * @brief Check that the running image does not reach into the inactive bank
+ *
+ * @return true if the inactive bank is free
+ */
+static bool ota_start(void)
+{
+	uint32_t image_end = (uint32_t)&__etext + ((uint32_t)&__data_end__ - (uint32_t)&__data_start__);
+	return image_end <= OTA_BANK_1;
+}
+
+/**
+ * @brief CRC16 of an image, same as crc16_compute() of the bootloader
+ *
+ * @param data image start
+ * @param size image size
+ * @return uint16_t CRC16 (CCITT, start value 0xFFFF)
+ */
+static uint16_t ota_crc16(const uint8_t *data, uint32_t size)
+{
+	uint16_t crc = 0xFFFF;
+	for (uint32_t idx = 0; idx < size; idx++)
+	{
+		crc = (uint8_t)(crc >> 8) | (crc << 8);
+		crc ^= data[idx];
+		crc ^= (uint8_t)(crc & 0xFF) >> 4;
+		crc ^= (crc << 8) << 4;
+		crc ^= ((crc & 0xFF) << 4) << 1;
+	}
+	return crc;
+}
+
+/**
+ * @brief Copy bank 1 into bank 0 and restart
+ *        Runs from RAM with the SoftDevice and all interrupts disabled,
+ *        the flash of the running application is overwritten.
+ *        The bootloader settings are written last with the CRC and size of the
+ *        new image, after a power loss during the copy the CRC does not match
+ *        and the bootloader stays in DFU mode instead of starting a broken image
+ *
+ * @param size size of the new image
+ * @param crc CRC16 of the new image
+ */
+static void __attribute__((noinline, long_call, section(".data"))) ota_copy_bank(uint32_t size, uint16_t crc)
+{
+	for (uint32_t page = 0; page < size; page += DELTA_PAGE_SIZE)
+	{
+		NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Een;
+		NRF_NVMC->ERASEPAGE = OTA_BANK_0 + page;
+		while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+		{
+		}
+		NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen;
+		for (uint32_t idx = 0; idx < DELTA_PAGE_SIZE; idx += 4)
+		{
+			*(volatile uint32_t *)(OTA_BANK_0 + page + idx) = *(volatile uint32_t *)(OTA_BANK_1 + page + idx);
+			while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+			{
+			}
+		}
+	}
+
+	// Keep the bootloader settings, replace CRC and size of bank 0
+	volatile uint32_t *bl_settings = (volatile uint32_t *)OTA_BL_SETTINGS;
+	uint32_t settings[OTA_BL_SETTINGS_WORDS];
+	for (uint32_t idx = 0; idx < OTA_BL_SETTINGS_WORDS; idx++)
+	{
+		settings[idx] = bl_settings[idx];
+	}
+	settings[OTA_BL_BANK_0_CRC] = (settings[OTA_BL_BANK_0_CRC] & 0xFFFF0000) | crc;
+	settings[OTA_BL_BANK_0_SIZE] = size;
+	NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Een;
+	NRF_NVMC->ERASEPAGE = OTA_BL_SETTINGS;
+	while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+	{
+	}
+	NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen;
+	for (uint32_t idx = 0; idx < OTA_BL_SETTINGS_WORDS; idx++)
+	{
+		bl_settings[idx] = settings[idx];
+		while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+		{
+		}
+	}
+	NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren;
+
+	SCB->AIRCR = (0x5FA << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk;
+	while (true)
+	{
+	}
+}
+
+/**
+ * @brief Activate the new image
+ *
+ * @param size size of the new image
+ */
+static void ota_switch(uint32_t size)
+{
+	// The bootloader checks this CRC at every start
+	uint16_t crc = ota_crc16((const uint8_t *)OTA_BANK_1, size);
+	sd_softdevice_disable();
+	__disable_irq();
+	ota_copy_bank(size, crc);
+}
+
+#elif defined ESP32
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+/** Running and inactive app partition */
+static const esp_partition_t *ota_running = NULL;
+static const esp_partition_t *ota_next = NULL;
+/** Handle of the running update */
+static esp_ota_handle_t ota_handle = 0;
+
+static bool ota_read_old(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	return esp_partition_read(ota_running, offset, buffer, len) == ESP_OK;
+}
+
+static bool ota_write_new(uint32_t offset, const uint8_t *buffer, uint32_t len)
+{
+	return esp_ota_write(ota_handle, buffer, len) == ESP_OK;
+}
+
+static bool ota_read_new(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	return esp_partition_read(ota_next, offset, buffer, len) == ESP_OK;
+}
+
+static delta_io_s ota_io = {ota_read_old, ota_write_new, ota_read_new, 0};
+
+/**
+ * @brief Prepare the inactive OTA partition
+ *
+ * @return true if the partition is ready
+ */
+static bool ota_start(void)
+{
+	if (ota_handle != 0)
+	{
+		esp_ota_abort(ota_handle);
+		ota_handle = 0;
+	}
+	ota_running = esp_ota_get_running_partition();
+	ota_next = esp_ota_get_next_update_partition(NULL);
+	if ((ota_running == NULL) || (ota_next == NULL))
+	{
+		return false;
+	}
+	ota_io.max_size = ota_next->size;
+	return esp_ota_begin(ota_next, OTA_SIZE_UNKNOWN, &ota_handle) == ESP_OK;
+}
+
+/**
+ * @brief Activate the new image
+ *
+ * @param size size of the new image
+ */
+static void ota_switch(uint32_t size)
+{
+	if ((esp_ota_end(ota_handle) == ESP_OK) && (esp_ota_set_boot_partition(ota_next) == ESP_OK))
+	{
+		esp_restart();
+	}
+	ota_handle = 0;
+	MYLOG("OTA", "Boot partition not changed");
+}
+
+#else
+// RAK11300, no second bank in the 2 MB flash layout of the Arduino-mbed core
+static const delta_io_s ota_io = {NULL, NULL, NULL, 0};
+
+static bool ota_start(void)
+{
+	return false;
+}
+
+static void ota_switch(uint32_t size)
+{
+}
+#endif
+
+/** Patch state, the largest part is the page buffer */
+static delta_patch_s ota_patch;
+/** Next expected fragment */
+static uint16_t ota_seq = 0;
+/** Flag if an update is running */
+static bool ota_active = false;
+
+/**
+ * @brief Handle a delta fragment received on OTA_DELTA_FPORT
+ *        Fragment format: sequence number (uint16 LE) followed by delta data.
+ *        Sequence number 0 starts a new update, a missing fragment aborts it
+ *
+ * @param data received data
+ * @param len length of the received data
+ */
+void ota_delta_rx(uint8_t *data, uint16_t len)
+{
+	if (len < 3)
+	{
+		return;
+	}
+	uint16_t seq = data[0] | (data[1] << 8);
+	if (seq == 0)
+	{
+		ota_active = ota_start();
+		if (!ota_active)
+		{
+			AT_PRINTF("+EVT:DELTA_NOT_SUPPORTED");
+			return;
+		}
+		delta_patch_begin(&ota_patch, &ota_io);
+		ota_seq = 0;
+		MYLOG("OTA", "Delta update started");
+	}
+	if (!ota_active)
+	{
+		return;
+	}
+	if (seq != ota_seq)
+	{
+		ota_active = false;
+		AT_PRINTF("+EVT:DELTA_FAILED:SEQ:%d", ota_seq);
+		return;
+	}
+	ota_seq++;
+
+	delta_result_e result = delta_patch_write(&ota_patch, &data[2], len - 2);
+	if (result == DELTA_MORE)
+	{
+		return;
+	}
+	ota_active = false;
+	if (result != DELTA_DONE)
+	{
+		AT_PRINTF("+EVT:DELTA_FAILED:%s", delta_result_str(result));
+		return;
+	}
+	AT_PRINTF("+EVT:DELTA_DONE");
+	// Give the AT output time to leave the UART
+	delay(500);
+	ota_switch(ota_patch.header.new_size);
+}
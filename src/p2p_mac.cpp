@@ -0,0 +1,217 @@
+/**
+ * @file p2p_mac.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Listen-before-talk with channel activity detection for LoRa P2P
+ *        A frame is only sent if the SX126x CAD finds the channel free, otherwise
+ *        it is repeated after a randomized binary exponential backoff.
+ *        Optional ACKs with a sequence number per sensor node (p2p_mac.h),
+ *        no ACKs are requested or sent while the channel load is high
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "p2p_mac.h"
+
+/** CAD length in symbols and detection thresholds, as used by common SX126x drivers */
+#define P2P_CAD_SYMBOLS LORA_CAD_04_SYMBOL
+#define P2P_CAD_DET_MIN 10
+#define P2P_CAD_DET_PEAK_OFFSET 13
+
+/** Sequence number of the last frame */
+static uint8_t p2p_seq = 0;
+/** The running frame carries a sequence number */
+static bool p2p_seq_added = false;
+/** Failed attempts of the running frame */
+static uint8_t p2p_attempts = 0;
+/** The running frame waits for its ACK */
+static bool p2p_wait_ack = false;
+/** Last sequence numbers of the sensor nodes (collector) */
+static p2p_peer_s p2p_peers[P2P_PEERS];
+static uint32_t p2p_rx_counter = 0;
+/** Airtime of the frames received from other nodes */
+static p2p_load_s p2p_load = {0, 0};
+
+/**
+ * @brief Device ID of this node, the last 4 bytes of the DevEUI like WisCayenne::addDevID()
+ *
+ * @return uint32_t device ID
+ */
+static uint32_t p2p_own_id(void)
+{
+	uint8_t *eui = &g_lorawan_settings.node_device_eui[4];
+	return ((uint32_t)eui[0] << 24) | ((uint32_t)eui[1] << 16) | ((uint32_t)eui[2] << 8) | eui[3];
+}
+
+/**
+ * @brief Channel activity detection
+ *        The CAD interrupts are not routed to DIO1, so the radio driver of the
+ *        WisBlock API does not see them. The radio is polled until the CAD is done
+ *
+ * @return true if no LoRa signal was detected
+ */
+static bool p2p_channel_free(void)
+{
+	uint16_t bw_khz = g_lorawan_settings.p2p_bandwidth == 2 ? 500 : g_lorawan_settings.p2p_bandwidth == 1 ? 250 : 125;
+	// 4 symbols plus processing, twice as timeout
+	uint32_t timeout_ms = 2 * 5 * (1UL << g_lorawan_settings.p2p_sf) / bw_khz + 2;
+
+	Radio.Standby();
+	SX126xSetCadParams(P2P_CAD_SYMBOLS, g_lorawan_settings.p2p_sf + P2P_CAD_DET_PEAK_OFFSET, P2P_CAD_DET_MIN, LORA_CAD_ONLY, 0);
+	SX126xSetDioIrqParams(IRQ_CAD_DONE | IRQ_CAD_ACTIVITY_DETECTED, IRQ_RADIO_NONE, IRQ_RADIO_NONE, IRQ_RADIO_NONE);
+	SX126xClearIrqStatus(IRQ_RADIO_ALL);
+	SX126xSetCad();
+
+	uint16_t irq = 0;
+	uint32_t start = millis();
+	while (((irq & IRQ_CAD_DONE) == 0) && ((millis() - start) < timeout_ms))
+	{
+		delay(1);
+		irq = SX126xGetIrqStatus();
+	}
+	SX126xClearIrqStatus(IRQ_RADIO_ALL);
+	// Without a CAD result the channel is treated as busy
+	return ((irq & IRQ_CAD_DONE) != 0) && ((irq & IRQ_CAD_ACTIVITY_DETECTED) == 0);
+}
+
+/**
+ * @brief Prepare a new frame, adds the sequence number if ACKs are requested
+ *        Called for every new frame before send_frame()
+ *
+ * @param frame encoded frame
+ */
+void p2p_stamp(acq_frame_s *frame)
+{
+	p2p_attempts = 0;
+	p2p_wait_ack = false;
+	p2p_seq_added = false;
+	if (g_lorawan_settings.lorawan_enable || (g_app_settings.p2p_ack != P2P_ACK_REQUEST) ||
+		(frame->len + PAYLOAD_SIZE_P2P_SEQ > PAYLOAD_MAX_SIZE))
+	{
+		return;
+	}
+	if (p2p_load_high(&p2p_load, millis(), P2P_ACK_LOAD_MAX))
+	{
+		MYLOG("P2P", "Channel load high, frame sent without ACK request");
+		return;
+	}
+	p2p_seq++;
+	frame->data[frame->len++] = LPP_CHANNEL_P2P_SEQ;
+	frame->data[frame->len++] = LPP_DIGITAL_INPUT;
+	frame->data[frame->len++] = p2p_seq;
+	p2p_seq_added = true;
+}
+
+/**
+ * @brief Send a frame if the channel is free
+ *
+ * @param frame encoded frame
+ * @param toa_ms time-on-air of the frame, slot length of the backoff
+ * @return uint32_t 0 if the frame was sent, the backoff in ms if the channel is busy,
+ *                  UINT32_MAX if the frame was dropped
+ */
+uint32_t p2p_send(acq_frame_s *frame, uint32_t toa_ms)
+{
+	if (p2p_attempts >= P2P_MAX_ATTEMPTS)
+	{
+		MYLOG("P2P", "Frame dropped after %d attempts", p2p_attempts);
+		return UINT32_MAX;
+	}
+	bool channel_free = p2p_channel_free();
+	if (channel_free && p2p_seq_added)
+	{
+		// ACKs are sent without CAD, the channel must be free longer than the ACK turnaround
+		delay(P2P_LBT_GAP_MS);
+		channel_free = p2p_channel_free();
+	}
+	if (!channel_free)
+	{
+		p2p_attempts++;
+		// Back to receive, send_p2p_packet() was not called
+		Radio.Rx(0);
+		if (p2p_attempts >= P2P_MAX_ATTEMPTS)
+		{
+			MYLOG("P2P", "Channel busy, frame dropped");
+			return UINT32_MAX;
+		}
+		uint32_t backoff = p2p_backoff_ms(toa_ms, p2p_attempts, (uint32_t)random(0x7FFFFFFF));
+		MYLOG("P2P", "Channel busy, retry %d in %ld ms", p2p_attempts, backoff);
+		return backoff;
+	}
+	p2p_wait_ack = false;
+	if (!send_p2p_packet(frame->data, frame->len))
+	{
+		return UINT32_MAX;
+	}
+	return 0;
+}
+
+/**
+ * @brief TX of a frame finished
+ *
+ * @param toa_ms time-on-air of the frame
+ * @return uint32_t time in ms until the frame is repeated if the ACK does not arrive,
+ *                  0 if no ACK is expected
+ */
+uint32_t p2p_tx_finished(uint32_t toa_ms)
+{
+	if (!p2p_seq_added)
+	{
+		return 0;
+	}
+	// Counted as failed until the ACK arrives
+	p2p_attempts++;
+	p2p_wait_ack = true;
+	uint32_t ack_window = P2P_ACK_TURNAROUND_MS + airtime_frame_ms(P2P_ACK_SIZE) * 2;
+	return ack_window + p2p_backoff_ms(toa_ms, p2p_attempts, (uint32_t)random(0x7FFFFFFF));
+}
+
+/**
+ * @brief Handle a received P2P frame
+ *        Sensor nodes look for the ACK of their frame, the collector acknowledges
+ *        frames with a sequence number and detects repetitions.
+ *        The ACKs are sent without CAD, the collector skips them while the channel load is high
+ *
+ * @param data received frame
+ * @param len frame length
+ * @return p2p_rx_e type of the frame
+ */
+p2p_rx_e p2p_rx(uint8_t *data, uint16_t len)
+{
+	uint32_t id;
+	uint8_t seq;
+	p2p_load_add(&p2p_load, millis(), airtime_frame_ms(len > 255 ? 255 : (uint8_t)len));
+	if (p2p_ack_parse(data, len, &id, &seq))
+	{
+		if (p2p_wait_ack && (id == p2p_own_id()) && (seq == p2p_seq))
+		{
+			MYLOG("P2P", "ACK %d", seq);
+			p2p_wait_ack = false;
+			return P2P_RX_ACK;
+		}
+		// ACK for another node
+		return P2P_RX_IGNORE;
+	}
+	if ((g_app_settings.p2p_ack != P2P_ACK_SEND) || (len > 255) || !p2p_frame_seq(data, (uint8_t)len, &id, &seq))
+	{
+		return P2P_RX_DATA;
+	}
+	if (p2p_load_high(&p2p_load, millis(), P2P_ACK_LOAD_SKIP))
+	{
+		MYLOG("P2P", "Channel load high, ACK %d skipped", seq);
+	}
+	else
+	{
+		uint8_t ack[P2P_ACK_SIZE];
+		p2p_ack_build(ack, id, seq);
+		send_p2p_packet(ack, P2P_ACK_SIZE);
+	}
+	if (p2p_rx_counter == 0)
+	{
+		p2p_peers_reset(p2p_peers);
+	}
+	p2p_rx_counter++;
+	return p2p_peer_check(p2p_peers, id, seq, p2p_rx_counter) ? P2P_RX_DATA : P2P_RX_IGNORE;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file p2p_mac.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Listen-before-talk backoff and acknowledgements for LoRa P2P
+ *        Shared by the device (p2p_mac.cpp) and the simulation (simulator/p2p_sim.cpp)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef P2P_MAC_H
+#define P2P_MAC_H
+
+#include <stdint.h>
+
+/** Transmit attempts of a frame, a busy channel and a missing ACK count both */
+#define P2P_MAX_ATTEMPTS 6
+/** Largest backoff window is 2^P2P_BACKOFF_EXP_MAX slots */
+#define P2P_BACKOFF_EXP_MAX 5
+/** Longest time from the end of a frame until the collector starts the ACK */
+#define P2P_ACK_TURNAROUND_MS 20
+/** Second CAD after a free channel, longer than the ACK turnaround so that an ACK in the gap is found */
+#define P2P_LBT_GAP_MS (P2P_ACK_TURNAROUND_MS + 5)
+/** Peers the collector tracks for the duplicate detection */
+#define P2P_PEERS 32
+/** Window of the channel load estimate */
+#define P2P_LOAD_WINDOW_MS 60000
+/** Channel load in % above which the sensor nodes request no ACKs, the ACKs are sent without CAD */
+#define P2P_ACK_LOAD_MAX 20
+/** Channel load in % above which the collector skips the ACKs, nodes with hidden neighbours see a lower load */
+#define P2P_ACK_LOAD_SKIP 30
+
+/** ACK frame: marker, device ID (4 bytes, big endian), sequence number */
+#define P2P_ACK_SIZE 7
+/** Marker of an ACK, 0xFF 0xAC is not a valid Cayenne LPP entry */
+#define P2P_ACK_MARK_1 0xFF
+#define P2P_ACK_MARK_2 0xAC
+
+/** Cayenne LPP channel of the sequence number (digital input), must match src/app.h */
+#define P2P_LPP_CH_SEQ 29
+/** Cayenne LPP channel and type of the device ID, WisCayenne::addDevID() */
+#define P2P_LPP_CH_DEVID 0
+#define P2P_LPP_DEVID 0xFF
+
+/** ACK mode of a node */
+enum p2p_ack_mode_e
+{
+	P2P_ACK_OFF = 0, // Frames are sent once if the channel is free
+	P2P_ACK_REQUEST, // Sensor node, frames carry a sequence number and are repeated until acknowledged
+	P2P_ACK_SEND,	 // Collector, acknowledges frames with a sequence number
+	P2P_ACK_NUM
+};
+
+/** Type of a received frame */
+enum p2p_rx_e
+{
+	P2P_RX_DATA = 0, // New data frame
+	P2P_RX_IGNORE,	 // Repeated data frame or ACK for another node
+	P2P_RX_ACK,		 // ACK of the own frame
+};
+
+/** Last sequence number received from a peer */
+struct p2p_peer_s
+{
+	uint32_t id;  // Device ID, last 4 bytes of the DevEUI
+	uint32_t age; // Receive counter of the last frame, the oldest entry is replaced
+	uint8_t seq;  // Last sequence number
+	uint8_t used; // Entry is in use
+};
+
+/** Channel load estimate, airtime of the received frames, decays with a time constant of P2P_LOAD_WINDOW_MS */
+struct p2p_load_s
+{
+	uint32_t busy_ms; // Decayed airtime of the received frames
+	uint32_t last_ms; // Time of the last update
+};
+
+/**
+ * @brief Randomized binary exponential backoff
+ *        The window doubles with each failed attempt, from 2 slots up to 2^P2P_BACKOFF_EXP_MAX slots
+ *
+ * @param slot_ms slot length, time-on-air of the frame
+ * @param attempt failed attempts of the frame, 1 after the first failure
+ * @param random random number
+ * @return uint32_t wait time in ms, at least one slot
+ */
+static inline uint32_t p2p_backoff_ms(uint32_t slot_ms, uint8_t attempt, uint32_t random)
+{
+	uint8_t exponent = attempt < P2P_BACKOFF_EXP_MAX ? attempt : P2P_BACKOFF_EXP_MAX;
+	return slot_ms * (1 + random % (1UL << exponent));
+}
+
+/**
+ * @brief Size of the value of a Cayenne LPP type, types of this firmware only
+ *
+ * @param type LPP type
+ * @return uint8_t value size, 0 for an unknown type
+ */
+static inline uint8_t p2p_lpp_size(uint8_t type)
+{
+	switch (type)
+	{
+	case 0x00: // Digital input
+	case 0x68: // Relative humidity
+		return 1;
+	case 0x02: // Analog input
+	case 0x65: // Luminosity
+	case 0x67: // Temperature
+	case 0x73: // Barometric pressure
+	case 0x74: // Voltage
+		return 2;
+	case 0x79: // Altitude
+		return 2;
+	case 0x85: // Unix time
+	case 0xFF: // Device ID
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Decay the channel load estimate to the current time
+ *
+ * @param load load estimate
+ * @param now_ms current time in ms
+ */
+static inline void p2p_load_decay(p2p_load_s *load, uint32_t now_ms)
+{
+	uint32_t elapsed = now_ms - load->last_ms;
+	load->busy_ms = elapsed >= P2P_LOAD_WINDOW_MS ? 0 : (uint32_t)((uint64_t)load->busy_ms * (P2P_LOAD_WINDOW_MS - elapsed) / P2P_LOAD_WINDOW_MS);
+	load->last_ms = now_ms;
+}
+
+/**
+ * @brief Add a received frame to the channel load estimate
+ *
+ * @param load load estimate
+ * @param now_ms current time in ms
+ * @param airtime_ms time-on-air of the frame
+ */
+static inline void p2p_load_add(p2p_load_s *load, uint32_t now_ms, uint32_t airtime_ms)
+{
+	p2p_load_decay(load, now_ms);
+	load->busy_ms += airtime_ms;
+}
+
+/**
+ * @brief Check if the channel load is too high for ACKs
+ *        At high load the ACKs and the repeated frames take more airtime than
+ *        they recover, the frames are sent once with listen-before-talk only
+ *
+ * @param load load estimate
+ * @param now_ms current time in ms
+ * @param max_pct load limit in %, P2P_ACK_LOAD_MAX or P2P_ACK_LOAD_SKIP
+ * @return true if the channel load is above the limit
+ */
+static inline bool p2p_load_high(p2p_load_s *load, uint32_t now_ms, uint8_t max_pct)
+{
+	p2p_load_decay(load, now_ms);
+	return (uint64_t)load->busy_ms * 100 > (uint64_t)P2P_LOAD_WINDOW_MS * max_pct;
+}
+
+/**
+ * @brief Get the device ID and the sequence number of a data frame
+ *
+ * @param data Cayenne LPP payload
+ * @param len payload length
+ * @param id returns the device ID
+ * @param seq returns the sequence number
+ * @return true if the frame requests an ACK (device ID and sequence number found)
+ */
+static inline bool p2p_frame_seq(const uint8_t *data, uint8_t len, uint32_t *id, uint8_t *seq)
+{
+	bool has_id = false;
+	bool has_seq = false;
+	uint8_t pos = 0;
+	while (pos + 2 <= len)
+	{
+		uint8_t size = p2p_lpp_size(data[pos + 1]);
+		if ((size == 0) || (pos + 2 + size > len))
+		{
+			return false;
+		}
+		const uint8_t *value = &data[pos + 2];
+		if ((data[pos] == P2P_LPP_CH_DEVID) && (data[pos + 1] == P2P_LPP_DEVID))
+		{
+			*id = ((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) | ((uint32_t)value[2] << 8) | value[3];
+			has_id = true;
+		}
+		if ((data[pos] == P2P_LPP_CH_SEQ) && (data[pos + 1] == 0x00))
+		{
+			*seq = value[0];
+			has_seq = true;
+		}
+		pos += 2 + size;
+	}
+	return has_id && has_seq;
+}
+
+/**
+ * @brief Build an ACK
+ *
+ * @param buffer returns the ACK, P2P_ACK_SIZE bytes
+ * @param id device ID of the acknowledged frame
+ * @param seq sequence number of the acknowledged frame
+ * @return uint8_t ACK size
+ */
+static inline uint8_t p2p_ack_build(uint8_t *buffer, uint32_t id, uint8_t seq)
+{
+	buffer[0] = P2P_ACK_MARK_1;
+	buffer[1] = P2P_ACK_MARK_2;
+	buffer[2] = (uint8_t)(id >> 24);
+	buffer[3] = (uint8_t)(id >> 16);
+	buffer[4] = (uint8_t)(id >> 8);
+	buffer[5] = (uint8_t)id;
+	buffer[6] = seq;
+	return P2P_ACK_SIZE;
+}
+
+/**
+ * @brief Check if a received frame is an ACK
+ *
+ * @param data received frame
+ * @param len frame length
+ * @param id returns the device ID
+ * @param seq returns the sequence number
+ * @return true if the frame is an ACK
+ */
+static inline bool p2p_ack_parse(const uint8_t *data, uint16_t len, uint32_t *id, uint8_t *seq)
+{
+	if ((len != P2P_ACK_SIZE) || (data[0] != P2P_ACK_MARK_1) || (data[1] != P2P_ACK_MARK_2))
+	{
+		return false;
+	}
+	*id = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
+	*seq = data[6];
+	return true;
+}
+
+/**
+ * @brief Reset the peer table of the collector
+ *
+ * @param peers P2P_PEERS entries
+ */
+static inline void p2p_peers_reset(p2p_peer_s *peers)
+{
+	for (uint8_t idx = 0; idx < P2P_PEERS; idx++)
+	{
+		peers[idx].used = 0;
+	}
+}
+
+/**
+ * @brief Check the sequence number of a received frame against the last one of the peer
+ *        A repeated frame (ACK lost) is acknowledged again but not reported twice.
+ *        Unknown peers replace the peer that was not heard for the longest time
+ *
+ * @param peers P2P_PEERS entries
+ * @param id device ID
+ * @param seq sequence number
+ * @param counter receive counter, increments with each frame
+ * @return true if the frame is new
+ * @return false if it is a repetition
+ */
+static inline bool p2p_peer_check(p2p_peer_s *peers, uint32_t id, uint8_t seq, uint32_t counter)
+{
+	uint8_t oldest = 0;
+	for (uint8_t idx = 0; idx < P2P_PEERS; idx++)
+	{
+		if (peers[idx].used && (peers[idx].id == id))
+		{
+			bool repeated = peers[idx].seq == seq;
+			peers[idx].seq = seq;
+			peers[idx].age = counter;
+			return !repeated;
+		}
+		if (!peers[idx].used || (peers[oldest].used && (counter - peers[idx].age > counter - peers[oldest].age)))
+		{
+			oldest = idx;
+		}
+	}
+	peers[oldest].id = id;
+	peers[oldest].seq = seq;
+	peers[oldest].age = counter;
+	peers[oldest].used = 1;
+	return true;
+}
+
+#endif
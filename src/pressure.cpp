@@ -9,42 +9,93 @@
  * 
  */
 #include "app.h"
-#include <Adafruit_LPS2X.h>
-#include <Adafruit_Sensor.h>
+#include "lps22hb.h"
 
-Adafruit_LPS22 lps22hb;
+/** Conversion period at 75 Hz in ms */
+#define PRESS_SAMPLE_MS 14
 
 bool init_press(void)
 {
-	if (!lps22hb.begin_I2C(0x5c))
+	if (!lps22hb_init())
 	{
-		MYLOG("PRESS", "Could not initialize SHTC3");
+		MYLOG("PRESS", "Could not initialize LPS22HB");
 		return false;
 	}
-
-	lps22hb.setDataRate(LPS22_RATE_ONE_SHOT); // LPS22_RATE_ONE_SHOT
 	return true;
 }
 
 void read_press(void)
 {
-	sensors_event_t temp_event;
-	sensors_event_t pressure_event;
-	lps22hb.setDataRate(LPS22_RATE_75_HZ); // LPS22_RATE_ONE_SHOT
+	float pressure = 0;
+	float sample;
+	uint8_t samples = get_profile()->lps22hb_samples;
+	lps22hb_set_rate(LPS22HB_RATE_75_HZ);
 	MYLOG("PRESS", "Reading LPS22HB");
-	lps22hb.getEvent(&pressure_event, &temp_event);
-	delay(1000);
+	// Skip the first conversion after the mode change
+	delay(PRESS_SAMPLE_MS * 2);
 
-	lps22hb.getEvent(&pressure_event, &temp_event);
+	// Average the conversions of the measurement profile
+	for (uint8_t idx = 0; idx < samples; idx++)
+	{
+		if (!lps22hb_read(&sample))
+		{
+			MYLOG("PRESS", "Reading LPS22HB failed");
+			g_sensor_values.press_valid = false;
+			lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT);
+			return;
+		}
+		pressure += sample;
+		if (idx < samples - 1)
+		{
+			delay(PRESS_SAMPLE_MS);
+		}
+	}
+	pressure = pressure / samples;
 
-	uint16_t press_int = (uint16_t)(pressure_event.pressure * 10);
+	uint16_t press_int = (uint16_t)(pressure * 10);
 
 	MYLOG("PRESS", "P: %.2f", (float)press_int / 10.0);
 
 	// g_weather_data.press_1 = (uint8_t)(press_int >> 8);
 	// g_weather_data.press_2 = (uint8_t)(press_int);
 
-	g_solution_data.addBarometricPressure(LPP_CHANNEL_PRESS_2, pressure_event.pressure);
+	g_solution_data.addBarometricPressure(LPP_CHANNEL_PRESS_2, pressure);
+
+	g_sensor_values.press_x10 = press_int;
+	g_sensor_values.press_valid = true;
+	add_press_history(press_int);
+
+	lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT);
+}
 
-	lps22hb.setDataRate(LPS22_RATE_ONE_SHOT); // LPS22_RATE_ONE_SHOT
+/**
+ * @brief Switch the LPS22HB to 75 Hz continuous mode for burst capture
+ *
+ */
+void start_press_burst(void)
+{
+	lps22hb_set_rate(LPS22HB_RATE_75_HZ);
+	// Skip the first conversion after the mode change
+	delay(20);
+}
+
+/**
+ * @brief Read one pressure sample during burst capture
+ *
+ * @param value returns pressure in hPa
+ * @return true if reading was successful
+ * @return false if reading failed
+ */
+bool read_press_sample(float *value)
+{
+	return lps22hb_read(value);
+}
+
+/**
+ * @brief Switch the LPS22HB back to one shot mode after burst capture
+ *
+ */
+void stop_press_burst(void)
+{
+	lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT);
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+/**
+ * @file profile.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Measurement precision profiles
+ *        One profile sets the measurement modes of all sensors and the settle time
+ *        after the sensors are powered
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "lps22hb.h"
+#include "opt3001.h"
+
+/** Sensor settings per profile */
+static const sensor_profile_s profiles[PROFILE_NUM] = {
+	// SHTC3 LP, OPT3001 800 ms, LPS22HB low-current, LPS22HB samples, settle time
+	{true, false, true, 1, 100},	 // PROFILE_ULP
+	{false, false, false, 4, 500},	 // PROFILE_BALANCED
+	{false, true, false, 16, 1000}, // PROFILE_PRECISION
+};
+
+/** Profile the sensors are configured for, PROFILE_NUM if not yet configured */
+static uint8_t applied_profile = PROFILE_NUM;
+
+/**
+ * @brief Settings of the selected profile
+ *
+ * @return const sensor_profile_s* sensor settings
+ */
+const sensor_profile_s *get_profile(void)
+{
+	return &profiles[g_acq_settings.profile < PROFILE_NUM ? g_acq_settings.profile : PROFILE_BALANCED];
+}
+
+/**
+ * @brief Select a profile, the caller saves the settings
+ *        The sensors are reconfigured at the start of the next acquisition,
+ *        on the RAK3112 the acquisition owns the sensors on the second core
+ *
+ * @param profile PROFILE_ULP, PROFILE_BALANCED or PROFILE_PRECISION
+ * @return true if the profile is valid
+ */
+bool set_profile(uint8_t profile)
+{
+	if (profile >= PROFILE_NUM)
+	{
+		return false;
+	}
+	g_app_settings.profile = profile;
+	MYLOG("PROF", "Profile %d selected", profile);
+	return true;
+}
+
+/**
+ * @brief Configure the sensors if the profile was changed
+ *        Called from the acquisition with the sensors powered
+ *
+ */
+void apply_profile(void)
+{
+	uint8_t profile = g_acq_settings.profile < PROFILE_NUM ? g_acq_settings.profile : PROFILE_BALANCED;
+	if (profile == applied_profile)
+	{
+		return;
+	}
+	const sensor_profile_s *settings = &profiles[profile];
+	bool result = true;
+	if (has_rak1902)
+	{
+		result &= lps22hb_set_low_current(settings->lps22hb_low_current);
+	}
+	if (has_rak1903)
+	{
+		result &= opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH |
+							   (settings->opt3001_800ms ? OPT3001_CFG_800MS : 0));
+	}
+	// Retried with the next acquisition if a sensor did not answer
+	applied_profile = result ? profile : PROFILE_NUM;
+	MYLOG("PROF", "Sensors set to profile %d %s", profile, result ? "" : "failed");
+}
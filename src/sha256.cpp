@@ -0,0 +1,143 @@
+/**
+ * @file sha256.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Small SHA-256 implementation (FIPS 180-4), optimized for size
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "sha256.h"
+#include <string.h>
+
+/** Round constants */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief Process one 64 byte block
+ *
+ * @param ctx running hash
+ * @param block data block
+ */
+static void sha256_block(sha256_s *ctx, const uint8_t *block)
+{
+	uint32_t w[16];
+	uint32_t s[8];
+	memcpy(s, ctx->state, sizeof(s));
+
+	for (uint8_t idx = 0; idx < 64; idx++)
+	{
+		uint32_t wi;
+		if (idx < 16)
+		{
+			wi = ((uint32_t)block[idx * 4] << 24) | ((uint32_t)block[idx * 4 + 1] << 16) |
+				 ((uint32_t)block[idx * 4 + 2] << 8) | (uint32_t)block[idx * 4 + 3];
+		}
+		else
+		{
+			// Message schedule in a 16 word ring
+			uint32_t w15 = w[(idx - 15) & 15];
+			uint32_t w2 = w[(idx - 2) & 15];
+			uint32_t s0 = ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3);
+			uint32_t s1 = ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10);
+			wi = w[idx & 15] + s0 + w[(idx - 7) & 15] + s1;
+		}
+		w[idx & 15] = wi;
+
+		uint32_t t1 = s[7] + (ROTR(s[4], 6) ^ ROTR(s[4], 11) ^ ROTR(s[4], 25)) +
+					  ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[idx] + wi;
+		uint32_t t2 = (ROTR(s[0], 2) ^ ROTR(s[0], 13) ^ ROTR(s[0], 22)) +
+					  ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+		memmove(&s[1], &s[0], 7 * sizeof(uint32_t));
+		s[4] += t1;
+		s[0] = t1 + t2;
+	}
+
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		ctx->state[idx] += s[idx];
+	}
+}
+
+/**
+ * @brief Start a new hash
+ *
+ * @param ctx running hash
+ */
+void sha256_init(sha256_s *ctx)
+{
+	static const uint32_t init_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+										   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+	memcpy(ctx->state, init_state, sizeof(init_state));
+	ctx->length = 0;
+	ctx->block_len = 0;
+}
+
+/**
+ * @brief Add data to the hash
+ *
+ * @param ctx running hash
+ * @param data data to add
+ * @param len length of the data
+ */
+void sha256_update(sha256_s *ctx, const uint8_t *data, size_t len)
+{
+	ctx->length += len;
+	while (len > 0)
+	{
+		size_t chunk = 64 - ctx->block_len;
+		chunk = chunk < len ? chunk : len;
+		memcpy(&ctx->block[ctx->block_len], data, chunk);
+		ctx->block_len += chunk;
+		data += chunk;
+		len -= chunk;
+		if (ctx->block_len == 64)
+		{
+			sha256_block(ctx, ctx->block);
+			ctx->block_len = 0;
+		}
+	}
+}
+
+/**
+ * @brief Finish the hash
+ *
+ * @param ctx running hash, must be initialized again before reuse
+ * @param hash returns the 32 byte hash
+ */
+void sha256_final(sha256_s *ctx, uint8_t hash[SHA256_SIZE])
+{
+	uint64_t bits = ctx->length * 8;
+	ctx->block[ctx->block_len++] = 0x80;
+	if (ctx->block_len > 56)
+	{
+		memset(&ctx->block[ctx->block_len], 0, 64 - ctx->block_len);
+		sha256_block(ctx, ctx->block);
+		ctx->block_len = 0;
+	}
+	memset(&ctx->block[ctx->block_len], 0, 56 - ctx->block_len);
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		ctx->block[56 + idx] = (uint8_t)(bits >> (56 - idx * 8));
+	}
+	sha256_block(ctx, ctx->block);
+
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		hash[idx * 4] = (uint8_t)(ctx->state[idx] >> 24);
+		hash[idx * 4 + 1] = (uint8_t)(ctx->state[idx] >> 16);
+		hash[idx * 4 + 2] = (uint8_t)(ctx->state[idx] >> 8);
+		hash[idx * 4 + 3] = (uint8_t)ctx->state[idx];
+	}
+}
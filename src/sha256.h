@@ -0,0 +1,35 @@
+/**
+ * @file sha256.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Small SHA-256 implementation, used to verify firmware images
+ *        No Arduino dependencies, compiles as well on a Linux host
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Size of the hash in bytes */
+#define SHA256_SIZE 32
+
+/** Running hash */
+struct sha256_s
+{
+	uint32_t state[8];
+	uint64_t length;
+	uint8_t block[64];
+	uint8_t block_len;
+};
+
+void sha256_init(sha256_s *ctx);
+void sha256_update(sha256_s *ctx, const uint8_t *data, size_t len);
+void sha256_final(sha256_s *ctx, uint8_t hash[SHA256_SIZE]);
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file shtc3.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief SHTC3 temperature and humidity sensor (RAK1901) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "shtc3.h"
+#include "i2c_async.h"
+
+/** Commands */
+#define SHTC3_CMD_WAKEUP 0x3517
+#define SHTC3_CMD_SLEEP 0xB098
+#define SHTC3_CMD_ID 0xEFC8
+/** Normal mode, no clock stretching, temperature first */
+#define SHTC3_CMD_MEASURE 0x7866
+/** Low power mode, no clock stretching, temperature first */
+#define SHTC3_CMD_MEASURE_LP 0x609C
+/** Maximum measurement duration in ms */
+#define SHTC3_MEASURE_MS 13
+#define SHTC3_MEASURE_LP_MS 1
+
+/** Product code bits of the ID register */
+#define SHTC3_ID_MASK 0x083F
+#define SHTC3_ID 0x0807
+
+/**
+ * @brief Send a 16 bit command
+ *
+ * @param cmd command
+ * @return i2c_result_e I2C_OK if the sensor acknowledged the command
+ */
+static i2c_result_e shtc3_send(uint16_t cmd)
+{
+	uint8_t tx[2] = {(uint8_t)(cmd >> 8), (uint8_t)cmd};
+	return i2c_transfer(SHTC3_ADDRESS, tx, 2, NULL, 0);
+}
+
+/**
+ * @brief Send a 16 bit command
+ *
+ * @param cmd command
+ * @return true if the sensor acknowledged the command
+ */
+static bool shtc3_command(uint16_t cmd)
+{
+	return shtc3_send(cmd) == I2C_OK;
+}
+
+/**
+ * @brief CRC-8 of a data word, polynomial 0x31, init 0xFF
+ *
+ * @param data 2 data bytes
+ * @return uint8_t CRC
+ */
+static uint8_t shtc3_crc(const uint8_t *data)
+{
+	uint8_t crc = 0xFF;
+	for (uint8_t idx = 0; idx < 2; idx++)
+	{
+		crc ^= data[idx];
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = crc & 0x80 ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/**
+ * @brief Read 1 or 2 data words and check their CRC
+ *
+ * @param words returns the data words
+ * @param num number of words
+ * @param result returns the result of the transaction
+ * @return true if the words were read and the CRC matches
+ */
+static bool shtc3_read_words(uint16_t *words, uint8_t num, i2c_result_e *result)
+{
+	uint8_t rx[6];
+	*result = i2c_transfer(SHTC3_ADDRESS, NULL, 0, rx, num * 3);
+	if (*result != I2C_OK)
+	{
+		return false;
+	}
+	for (uint8_t idx = 0; idx < num; idx++)
+	{
+		if (shtc3_crc(&rx[idx * 3]) != rx[idx * 3 + 2])
+		{
+			return false;
+		}
+		words[idx] = (rx[idx * 3] << 8) | rx[idx * 3 + 1];
+	}
+	return true;
+}
+
+/**
+ * @brief Wake up the sensor, check its ID and put it to sleep
+ *
+ * @return true if an SHTC3 was found
+ */
+bool shtc3_init(void)
+{
+	uint16_t id;
+	i2c_result_e result;
+	if (!shtc3_command(SHTC3_CMD_WAKEUP))
+	{
+		return false;
+	}
+	// Wake up time 240 us
+	i2c_delay_ms(1);
+	if (!shtc3_command(SHTC3_CMD_ID) || !shtc3_read_words(&id, 1, &result) || ((id & SHTC3_ID_MASK) != SHTC3_ID))
+	{
+		return false;
+	}
+	return shtc3_sleep();
+}
+
+/**
+ * @brief Measure temperature and humidity, the sensor sleeps afterwards
+ *        Low power mode needs ~20 % of the energy, with higher noise.
+ *        The sensor has no configuration, after a lost bus it is woken up,
+ *        checked and put to sleep again like in shtc3_init()
+ *
+ * @param low_power true for a low power mode measurement
+ * @param temp returns the temperature in degC
+ * @param humid returns the relative humidity in %
+ * @return true if the measurement was successful
+ */
+bool shtc3_read(bool low_power, float *temp, float *humid)
+{
+	uint16_t raw[2];
+	bool valid = false;
+	i2c_result_e result = shtc3_send(SHTC3_CMD_WAKEUP);
+	if (result == I2C_OK)
+	{
+		i2c_delay_ms(1);
+		result = shtc3_send(low_power ? SHTC3_CMD_MEASURE_LP : SHTC3_CMD_MEASURE);
+	}
+	if (result == I2C_OK)
+	{
+		i2c_delay_ms(low_power ? SHTC3_MEASURE_LP_MS : SHTC3_MEASURE_MS);
+		valid = shtc3_read_words(raw, 2, &result);
+		shtc3_sleep();
+	}
+	if (i2c_lost(result))
+	{
+		shtc3_init();
+	}
+	if (!valid)
+	{
+		return false;
+	}
+	*temp = -45.0f + 175.0f * raw[0] / 65536.0f;
+	*humid = 100.0f * raw[1] / 65536.0f;
+	return true;
+}
+
+/**
+ * @brief Put the sensor into sleep mode
+ *
+ * @return true if the sensor acknowledged
+ */
+bool shtc3_sleep(void)
+{
+	return shtc3_command(SHTC3_CMD_SLEEP);
+}
@@ -0,0 +1,24 @@
+/**
+ * @file shtc3.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief SHTC3 temperature and humidity sensor (RAK1901) on the I2C transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SHTC3_H
+#define SHTC3_H
+
+#include <stdint.h>
+
+/** I2C address of the SHTC3 */
+#define SHTC3_ADDRESS 0x70
+
+bool shtc3_init(void);
+bool shtc3_read(bool low_power, float *temp, float *humid);
+bool shtc3_sleep(void);
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file slot.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Transmit slot scheduling, spreads the uplinks of many nodes over the send interval
+ *        The slot phase is derived from the DevEUI, so nodes that boot together
+ *        after a power cut do not send at the same time. After a failed confirmed
+ *        uplink the node moves to a random phase
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Phase of this device within the send interval, hash of the DevEUI */
+static uint32_t slot_hash = 0;
+/** Random phase offset, changed after failed uplinks */
+static uint32_t slot_offset = 0;
+
+/** Shortest lead time of a slot, until the acquisition time is measured */
+#define SLOT_LEAD_MIN_MS 1000
+/** Time from the slot to the end of the uplink, acquisition and time-on-air */
+static uint32_t slot_lead_ms = SLOT_LEAD_MIN_MS;
+
+/** Uptime in ms, extended to 64 bit to survive the millis() overflow */
+static uint64_t slot_uptime = 0;
+static uint32_t slot_last_millis = 0;
+
+/**
+ * @brief Initialize the slot scheduler from the DevEUI
+ *        FNV-1a hash of the 8 DevEUI bytes
+ *
+ */
+void init_slot(void)
+{
+	slot_hash = 2166136261UL;
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		slot_hash ^= g_lorawan_settings.node_device_eui[idx];
+		slot_hash *= 16777619UL;
+	}
+	randomSeed(slot_hash);
+	MYLOG("SLOT", "Slot hash %08lX", slot_hash);
+}
+
+/**
+ * @brief Get the uptime in ms as 64 bit value
+ *        Must be called at least once every 49 days, done by every send cycle
+ *
+ * @return uint64_t uptime in ms
+ */
+uint64_t get_uptime(void)
+{
+	uint32_t now = millis();
+	slot_uptime += (uint32_t)(now - slot_last_millis);
+	slot_last_millis = now;
+	return slot_uptime;
+}
+
+/**
+ * @brief Move to a random phase of the send interval
+ *        Called after a failed confirmed uplink. A node that collided with another
+ *        node or its ACK would collide again in the same slot every interval
+ *
+ */
+void slot_move(void)
+{
+	slot_offset = (uint32_t)random(0x7FFFFFFF);
+	MYLOG("SLOT", "Slot moved");
+}
+
+/**
+ * @brief Set the lead time of a slot from the measured acquisition time and the time-on-air
+ *
+ * @param lead_ms time from the send timer event to the end of the uplink
+ */
+void slot_set_lead(uint32_t lead_ms)
+{
+	slot_lead_ms = lead_ms > SLOT_LEAD_MIN_MS ? lead_ms : SLOT_LEAD_MIN_MS;
+}
+
+/**
+ * @brief Restart the send timer so that it fires in the next slot of this device
+ *        Slots are at uptime = n * interval + phase. There is no random jitter,
+ *        a fixed phase keeps nodes that do not collide apart from each other.
+ *        Replaces api_timer_restart(), call it as well after every STATUS event
+ *        to re-align the timer after interval changes
+ *
+ * @param interval send interval in ms, 0 = timer disabled
+ */
+void slot_timer_restart(uint32_t interval)
+{
+	if (interval == 0)
+	{
+		return;
+	}
+
+	uint64_t now = get_uptime();
+	uint32_t phase = (slot_hash + slot_offset) % interval;
+	uint64_t next_slot = ((now + interval - phase) / interval) * interval + phase;
+	// The frame of the slot that just fired is still measured or on the air,
+	// or the timer fired just before its slot. Otherwise the next slot is used, even if it is close
+	if ((next_slot - now) < slot_lead_ms)
+	{
+		next_slot += interval;
+	}
+
+	uint32_t delay_time = (uint32_t)(next_slot - now);
+	MYLOG("SLOT", "Next slot in %ld ms", delay_time);
+	api_timer_restart(delay_time);
+}
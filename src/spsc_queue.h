@@ -0,0 +1,89 @@
+/**
+ * @file spsc_queue.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Lock-free single-producer/single-consumer queue
+ *        Used between the acquisition core and the radio core.
+ *        Plain C++11, works as well with std::thread on a Linux host
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Ring buffer with one writer and one reader
+ *        Only atomic loads and stores are used, no read-modify-write,
+ *        so it works as well on cores without exclusive access instructions
+ *
+ * @tparam T element type, copied in and out
+ * @tparam N number of slots, power of 2, one slot stays empty
+ */
+template <typename T, size_t N>
+class spsc_queue
+{
+	static_assert((N >= 2) && ((N & (N - 1)) == 0), "Queue size must be a power of 2");
+
+public:
+	spsc_queue() : head(0), tail(0) {}
+
+	/**
+	 * @brief Add an element, only called by the producer
+	 *
+	 * @param item element to add
+	 * @return true if the element was added
+	 * @return false if the queue is full
+	 */
+	bool push(const T &item)
+	{
+		size_t write = head.load(std::memory_order_relaxed);
+		size_t next = (write + 1) & (N - 1);
+		if (next == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		buffer[write] = item;
+		head.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Take the oldest element, only called by the consumer
+	 *
+	 * @param item returns the element
+	 * @return true if an element was available
+	 * @return false if the queue is empty
+	 */
+	bool pop(T &item)
+	{
+		size_t read = tail.load(std::memory_order_relaxed);
+		if (read == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = buffer[read];
+		tail.store((read + 1) & (N - 1), std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Check if the queue is empty, valid for the consumer
+	 */
+	bool empty(void) const
+	{
+		return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+	}
+
+private:
+	T buffer[N];
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+};
+
+#endif
@@ -9,40 +9,62 @@
  * 
  */
 #include "app.h"
-#include "SparkFun_SHTC3.h"
-
-SHTC3 shtc3;
+#include "shtc3.h"
 
 bool init_th(void)
 {
-	if (shtc3.begin() != SHTC3_Status_Nominal)
+	if (!shtc3_init())
 	{
 		MYLOG("T_H", "Could not initialize SHTC3");
 		return false;
 	}
-	shtc3.sleep();
 	return true;
 }
 
 void read_th(void)
 {
 	MYLOG("T_H", "Reading SHTC3");
-	shtc3.sleep();
-	delay(500);
-	shtc3.update();
+	float temp;
+	float humid;
 
-	if (shtc3.lastStatus == SHTC3_Status_Nominal)
+	if (shtc3_read(get_profile()->shtc3_low_power, &temp, &humid))
 	{
-		int16_t temp_int = (int16_t)(shtc3.toDegC() * 10.0);
-		uint16_t humid_int = (uint16_t)(shtc3.toPercent() * 2);
+		int16_t temp_int = (int16_t)(temp * 10.0);
+		uint16_t humid_int = (uint16_t)(humid * 2);
 
 		MYLOG("T_H", "T: %.2f H: %.2f", (float)temp_int / 10.0, (float)humid_int / 2.0);
 
-		g_solution_data.addRelativeHumidity(LPP_CHANNEL_HUMID, shtc3.toPercent());
-		g_solution_data.addTemperature(LPP_CHANNEL_TEMP, shtc3.toDegC());
+		g_solution_data.addRelativeHumidity(LPP_CHANNEL_HUMID, humid);
+		g_solution_data.addTemperature(LPP_CHANNEL_TEMP, temp);
+
+		g_sensor_values.temp_x10 = temp_int;
+		g_sensor_values.humid_x2 = humid_int;
+		g_sensor_values.th_valid = true;
 	}
 	else
 	{
 		MYLOG("T_H", "Reading SHTC3 failed");
+		g_sensor_values.th_valid = false;
 	}
 }
+
+/**
+ * @brief Read one temperature and humidity sample for the BLE stream
+ *
+ * @param temp_x10 returns temperature in 1/10 degC
+ * @param humid_x2 returns relative humidity in 1/2 %
+ * @return true if reading was successful
+ * @return false if reading failed
+ */
+bool read_th_sample(int16_t *temp_x10, uint8_t *humid_x2)
+{
+	float temp;
+	float humid;
+	if (!shtc3_read(get_profile()->shtc3_low_power, &temp, &humid))
+	{
+		return false;
+	}
+	*temp_x10 = (int16_t)(temp * 10.0);
+	*humid_x2 = (uint8_t)(humid * 2);
+	return true;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file timesync.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Network time sync and compact timestamps of the measurements
+ *        The time is requested with the LoRaWAN DeviceTimeReq MAC command, a
+ *        downlink on TIME_FPORT or the AT command are the fallbacks.
+ *        The drift of the local clock is measured between the syncs (timesync.h)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "timesync.h"
+
+/** Set to 0 if the LoRaWAN stack does not support MLME_DEVICE_TIME, the downlink on TIME_FPORT is used then */
+#ifndef TIME_SYNC_DEVICE_TIME
+#define TIME_SYNC_DEVICE_TIME 1
+#endif
+
+/** Smaller changes of the stack time against the local clock are read jitter, not a DeviceTimeAns */
+#define TS_ANSWER_MIN_MS 2
+
+/** Local clock to wall-clock mapping */
+static timesync_s ts_state;
+/** DeviceTimeReq was sent with the running uplink */
+static bool ts_request_pending = false;
+/** Stack time minus local time when DeviceTimeReq was sent, DeviceTimeAns moves the stack time */
+static int64_t ts_request_offset = 0;
+/** Last DeviceTimeReq was not answered, the timestamps request the time downlink */
+static bool ts_answer_missing = TIME_SYNC_DEVICE_TIME == 0;
+/** Uplinks with a time request, the time downlink answers one of them by its sequence number */
+static ts_uplink_s ts_uplinks[TS_UPLINK_HISTORY];
+/** Sequence number of the next time request */
+static uint8_t ts_req_seq = 0;
+/** Time request of the last stamped frame, the frame that is sent next */
+static uint8_t ts_stamp_seq = 0;
+static bool ts_stamp_request = false;
+
+/**
+ * @brief Add a network time sync
+ *
+ * @param local_ms local time (get_uptime()) the network time was valid
+ * @param unix_ms network time as Unix time in ms
+ * @param source name of the time source for the log
+ */
+static void timesync_add(uint64_t local_ms, int64_t unix_ms, const char *source)
+{
+	int64_t before = ts_unix_ms(&ts_state, local_ms);
+	ts_sync(&ts_state, local_ms, unix_ms);
+	MYLOG("TIME", "%s, corrected by %ld ms, drift %ld ppb", source,
+		  before != 0 ? (int32_t)(unix_ms - before) : 0L, ts_state.drift_ppb);
+	AT_PRINTF("+EVT:TIME:%lu", (uint32_t)(unix_ms / 1000));
+}
+
+#if TIME_SYNC_DEVICE_TIME
+/**
+ * @brief Read the time of the LoRaWAN stack, which DeviceTimeAns sets
+ *
+ * @param local_ms returns the local time (get_uptime()) of the reading
+ * @return int64_t stack time in ms, a Unix time once DeviceTimeAns arrived
+ */
+static int64_t ts_stack_ms(uint64_t *local_ms)
+{
+	SysTime_t sys_time = SysTimeGet();
+	*local_ms = get_uptime();
+	return (int64_t)sys_time.Seconds * 1000 + sys_time.SubSeconds;
+}
+#endif
+
+/**
+ * @brief Request the network time with the next uplink if a sync is due
+ *        Called before a LoRaWAN uplink is enqueued
+ *
+ */
+void timesync_request(void)
+{
+#if TIME_SYNC_DEVICE_TIME
+	if (ts_request_pending || !ts_sync_due(&ts_state, get_uptime()))
+	{
+		return;
+	}
+	// The stack sets its time when DeviceTimeAns arrives, the stack time is left alone,
+	// the answer is detected by the change of the stack time against the local clock
+	uint64_t local_ms;
+	ts_request_offset = ts_stack_ms(&local_ms) - (int64_t)local_ms;
+	MlmeReq_t mlme_req;
+	mlme_req.Type = MLME_DEVICE_TIME;
+	ts_request_pending = LoRaMacMlmeRequest(&mlme_req) == LORAMAC_STATUS_OK;
+	MYLOG("TIME", "DeviceTimeReq %s", ts_request_pending ? "added" : "failed");
+#endif
+}
+
+/**
+ * @brief Remember the end of the uplink if it carries a time request
+ *        The time downlink arrives in the RX window of a later uplink
+ *
+ * @param toa_ms time-on-air of the enqueued uplink
+ */
+void timesync_uplink(uint32_t toa_ms)
+{
+	if (!ts_stamp_request)
+	{
+		return;
+	}
+	ts_uplink_add(ts_uplinks, ts_stamp_seq, get_uptime() + toa_ms);
+}
+
+/**
+ * @brief Check for a DeviceTimeAns after the TX cycle finished
+ *        The lmh callbacks do not report the MLME confirm. An answer moved the stack time
+ *        against the local clock, an answer that corrects the stack time by less than
+ *        TS_ANSWER_MIN_MS is taken as missing and the time downlink is requested
+ *
+ */
+void timesync_tx_finished(void)
+{
+#if TIME_SYNC_DEVICE_TIME
+	if (!ts_request_pending)
+	{
+		return;
+	}
+	ts_request_pending = false;
+	uint64_t local_ms;
+	int64_t stack_ms = ts_stack_ms(&local_ms);
+	int64_t change = stack_ms - (int64_t)local_ms - ts_request_offset;
+	ts_answer_missing = (stack_ms < (int64_t)TS_UNIX_MIN * 1000) ||
+						((change < TS_ANSWER_MIN_MS) && (change > -TS_ANSWER_MIN_MS));
+	if (ts_answer_missing)
+	{
+		MYLOG("TIME", "No DeviceTimeAns");
+		return;
+	}
+	timesync_add(local_ms, stack_ms, "DeviceTimeAns");
+#endif
+}
+
+/**
+ * @brief Network time from a downlink on TIME_FPORT
+ *        1 byte sequence number of the time request (LPP_CHANNEL_TIME_REQ),
+ *        4 bytes Unix time in seconds (big endian) at the reception of that uplink,
+ *        optional followed by 1 byte fraction in 1/256 s
+ *
+ * @param data downlink payload
+ * @param len payload length
+ */
+void timesync_rx(uint8_t *data, uint16_t len)
+{
+	if ((len != 5) && (len != 6))
+	{
+		MYLOG("TIME", "Invalid time downlink");
+		return;
+	}
+	uint64_t uplink_end;
+	if (!ts_uplink_find(ts_uplinks, data[0], &uplink_end))
+	{
+		MYLOG("TIME", "Time downlink for unknown request %d", data[0]);
+		return;
+	}
+	uint32_t unix_s = ((uint32_t)data[1] << 24) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 8) | data[4];
+	if (unix_s < TS_UNIX_MIN)
+	{
+		MYLOG("TIME", "Invalid time %lu", unix_s);
+		return;
+	}
+	uint32_t fraction_ms = len == 6 ? (data[5] * 1000UL) / 256 : 0;
+	timesync_add(uplink_end, (int64_t)unix_s * 1000 + fraction_ms, "Time downlink");
+	// Older requests are answered by the same sync
+	ts_uplinks_reset(ts_uplinks);
+}
+
+/**
+ * @brief Set the time manually (AT command)
+ *        Not accurate enough for the drift measurement, only the time is set
+ *
+ * @param unix_s Unix time in seconds
+ * @return true if the time is valid
+ */
+bool timesync_set(uint32_t unix_s)
+{
+	if (unix_s < TS_UNIX_MIN)
+	{
+		return false;
+	}
+	ts_set(&ts_state, get_uptime(), (int64_t)unix_s * 1000);
+	MYLOG("TIME", "Time set to %lu", unix_s);
+	return true;
+}
+
+/**
+ * @brief Get the current time
+ *
+ * @param unix_s returns the Unix time in seconds, 0 if not synced
+ * @param drift_ppb returns the measured drift of the local clock
+ * @return true if the time is known
+ */
+bool timesync_get(uint32_t *unix_s, int32_t *drift_ppb)
+{
+	*unix_s = (uint32_t)(ts_unix_ms(&ts_state, get_uptime()) / 1000);
+	*drift_ppb = ts_state.drift_ppb;
+	return ts_state.state != TS_NONE;
+}
+
+/**
+ * @brief Add the measurement time to the frame
+ *        Unix time in seconds as Cayenne LPP Unix time entry (4 bytes, big endian),
+ *        frames measured before the first sync have no timestamp.
+ *        If a sync is due and the network does not answer DeviceTimeReq, a sequence number
+ *        is added on LPP_CHANNEL_TIME_REQ to request the time downlink
+ *
+ * @param frame encoded frame, time_ms is the millis() of the measurement
+ */
+void timesync_stamp(acq_frame_s *frame)
+{
+	uint64_t now = get_uptime();
+	ts_stamp_request = false;
+	if ((ts_state.state != TS_NONE) && (frame->len + PAYLOAD_SIZE_TIME <= PAYLOAD_MAX_SIZE))
+	{
+		uint64_t local_ms = now - (uint32_t)(millis() - frame->time_ms);
+		uint32_t unix_s = (uint32_t)(ts_unix_ms(&ts_state, local_ms) / 1000);
+		frame->data[frame->len++] = LPP_CHANNEL_TIME;
+		frame->data[frame->len++] = LPP_UNIXTIME;
+		frame->data[frame->len++] = (uint8_t)(unix_s >> 24);
+		frame->data[frame->len++] = (uint8_t)(unix_s >> 16);
+		frame->data[frame->len++] = (uint8_t)(unix_s >> 8);
+		frame->data[frame->len++] = (uint8_t)unix_s;
+	}
+	if (!ts_answer_missing || !ts_sync_due(&ts_state, now) || (frame->len + PAYLOAD_SIZE_TIME_REQ > PAYLOAD_MAX_SIZE))
+	{
+		return;
+	}
+	ts_stamp_seq = ts_req_seq++;
+	ts_stamp_request = true;
+	frame->data[frame->len++] = LPP_CHANNEL_TIME_REQ;
+	frame->data[frame->len++] = LPP_DIGITAL_INPUT;
+	frame->data[frame->len++] = ts_stamp_seq;
+}
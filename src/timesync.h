@@ -0,0 +1,232 @@
+/**
+ * @file timesync.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Wall-clock time from network time syncs with drift compensation of the local clock
+ *        Shared by the device (timesync.cpp) and the simulation (tools/timesync_sim.cpp)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <stdint.h>
+
+/** Shortest time between two syncs used for a drift estimate (1 hour) */
+#define TS_DRIFT_MIN_MS (60 * 60 * 1000LL)
+/** Time constant of the drift estimate after the first day (3 days) */
+#define TS_DRIFT_MEMORY_MS (3 * 24 * 60 * 60 * 1000LL)
+/** Larger drift is treated as a time step of the network, 500 ppm */
+#define TS_DRIFT_MAX_PPB 500000
+/** Sync interval once the drift is known, baseline of the filtered drift estimate (24 hours) */
+#define TS_SYNC_INTERVAL_MS (24 * 60 * 60 * 1000LL)
+/** Timestamps before 2020-01-01 are not valid Unix times */
+#define TS_UNIX_MIN 1577836800UL
+/** Uplinks with a time request that are remembered, a Class A downlink arrives after a later uplink */
+#define TS_UPLINK_HISTORY 8
+
+/** Sync state */
+enum ts_state_e
+{
+	TS_NONE = 0, // No sync yet
+	TS_SYNCED,	 // Time known, drift not yet
+	TS_DRIFT,	 // Time and drift known
+};
+
+/** Local clock to wall-clock mapping */
+struct timesync_s
+{
+	uint64_t base_local; // Local time of the last sync in ms
+	int64_t base_unix;	 // Unix time of the last sync in ms
+	uint64_t ref_local;	 // Local time of the reference sync for the drift in ms
+	int64_t ref_unix;	 // Unix time of the reference sync for the drift in ms
+	int32_t drift_ppb;	 // Local clock is slow by drift_ppb (negative = fast)
+	uint8_t state;		 // ts_state_e
+	uint8_t ref_valid;	 // Reference sync is a network time
+};
+
+/** Uplink with a time request, reference of the time downlink */
+struct ts_uplink_s
+{
+	uint64_t end_local; // Local time of the end of the uplink in ms
+	uint8_t seq;		// Sequence number of the time request
+	uint8_t used;		// Entry is valid
+};
+
+/**
+ * @brief Reset the sync state
+ *
+ * @param ts sync state
+ */
+static inline void ts_reset(timesync_s *ts)
+{
+	ts->base_local = 0;
+	ts->base_unix = 0;
+	ts->ref_local = 0;
+	ts->ref_unix = 0;
+	ts->drift_ppb = 0;
+	ts->state = TS_NONE;
+	ts->ref_valid = 0;
+}
+
+/**
+ * @brief Add a sync, the network time unix_ms was valid at local time local_ms
+ *        The drift is measured against the reference sync. Until the baseline reaches
+ *        TS_SYNC_INTERVAL_MS each sample replaces the drift, the longer baseline is more
+ *        accurate. Then the samples are filtered with a time constant of TS_DRIFT_MEMORY_MS
+ *        and the reference moves to the new sync
+ *
+ * @param ts sync state
+ * @param local_ms local time in ms
+ * @param unix_ms Unix time in ms
+ */
+static inline void ts_sync(timesync_s *ts, uint64_t local_ms, int64_t unix_ms)
+{
+	if (!ts->ref_valid)
+	{
+		ts->ref_local = local_ms;
+		ts->ref_unix = unix_ms;
+		ts->ref_valid = 1;
+		ts->state = ts->state == TS_NONE ? (uint8_t)TS_SYNCED : ts->state;
+	}
+	else
+	{
+		int64_t local_elapsed = (int64_t)(local_ms - ts->ref_local);
+		if (local_elapsed >= TS_DRIFT_MIN_MS)
+		{
+			int64_t unix_elapsed = unix_ms - ts->ref_unix;
+			int64_t sample = (unix_elapsed - local_elapsed) * 1000000000LL / local_elapsed;
+			bool valid = (sample <= TS_DRIFT_MAX_PPB) && (sample >= -TS_DRIFT_MAX_PPB);
+			if (valid && ((ts->state != TS_DRIFT) || (local_elapsed < TS_SYNC_INTERVAL_MS)))
+			{
+				ts->drift_ppb = (int32_t)sample;
+				ts->state = TS_DRIFT;
+			}
+			else if (valid)
+			{
+				// Longer baselines give more accurate samples, weight them higher
+				ts->drift_ppb += (int32_t)((sample - ts->drift_ppb) * local_elapsed / (local_elapsed + TS_DRIFT_MEMORY_MS));
+			}
+			// A time step of the network restarts the drift measurement, the last drift is kept
+			if (!valid || (local_elapsed >= TS_SYNC_INTERVAL_MS))
+			{
+				ts->ref_local = local_ms;
+				ts->ref_unix = unix_ms;
+			}
+		}
+	}
+	ts->base_local = local_ms;
+	ts->base_unix = unix_ms;
+}
+
+/**
+ * @brief Set the time from an inaccurate source (user input)
+ *        Used until the next network sync, the drift measurement is not changed
+ *
+ * @param ts sync state
+ * @param local_ms local time in ms
+ * @param unix_ms Unix time in ms
+ */
+static inline void ts_set(timesync_s *ts, uint64_t local_ms, int64_t unix_ms)
+{
+	ts->base_local = local_ms;
+	ts->base_unix = unix_ms;
+	ts->state = ts->state == TS_NONE ? (uint8_t)TS_SYNCED : ts->state;
+}
+
+/**
+ * @brief Wall-clock time of a local time
+ *
+ * @param ts sync state
+ * @param local_ms local time in ms, may be before the last sync
+ * @return int64_t Unix time in ms, 0 if not synced
+ */
+static inline int64_t ts_unix_ms(const timesync_s *ts, uint64_t local_ms)
+{
+	if (ts->state == TS_NONE)
+	{
+		return 0;
+	}
+	int64_t elapsed = (int64_t)(local_ms - ts->base_local);
+	return ts->base_unix + elapsed + elapsed * ts->drift_ppb / 1000000000LL;
+}
+
+/**
+ * @brief Check if the next uplink should request the network time
+ *        Until a network time was received the time is requested with every uplink.
+ *        Then the interval doubles from TS_DRIFT_MIN_MS to TS_SYNC_INTERVAL_MS,
+ *        each sync gives a drift sample with twice the baseline
+ *
+ * @param ts sync state
+ * @param local_ms local time in ms
+ * @return true if a sync is due
+ */
+static inline bool ts_sync_due(const timesync_s *ts, uint64_t local_ms)
+{
+	if (!ts->ref_valid)
+	{
+		return true;
+	}
+	int64_t interval = (int64_t)(ts->base_local - ts->ref_local);
+	if ((ts->state == TS_DRIFT) && (interval == 0))
+	{
+		// Reference moved with the last sync
+		interval = TS_SYNC_INTERVAL_MS;
+	}
+	interval = interval < TS_DRIFT_MIN_MS ? TS_DRIFT_MIN_MS : interval > TS_SYNC_INTERVAL_MS ? TS_SYNC_INTERVAL_MS : interval;
+	return (int64_t)(local_ms - ts->base_local) >= interval;
+}
+
+/**
+ * @brief Reset the uplink history
+ *
+ * @param history TS_UPLINK_HISTORY entries
+ */
+static inline void ts_uplinks_reset(ts_uplink_s *history)
+{
+	for (uint8_t idx = 0; idx < TS_UPLINK_HISTORY; idx++)
+	{
+		history[idx].used = 0;
+	}
+}
+
+/**
+ * @brief Remember the end of an uplink with a time request
+ *        A repeated uplink with the same sequence number replaces the entry,
+ *        the backend answers with the reception time of the last one it received
+ *
+ * @param history TS_UPLINK_HISTORY entries
+ * @param seq sequence number of the time request
+ * @param end_local local time of the end of the uplink in ms
+ */
+static inline void ts_uplink_add(ts_uplink_s *history, uint8_t seq, uint64_t end_local)
+{
+	ts_uplink_s *entry = &history[seq % TS_UPLINK_HISTORY];
+	entry->end_local = end_local;
+	entry->seq = seq;
+	entry->used = 1;
+}
+
+/**
+ * @brief Find the uplink a time downlink answers
+ *
+ * @param history TS_UPLINK_HISTORY entries
+ * @param seq sequence number echoed in the downlink
+ * @param end_local returns the local time of the end of the uplink in ms
+ * @return true if the uplink is in the history
+ */
+static inline bool ts_uplink_find(const ts_uplink_s *history, uint8_t seq, uint64_t *end_local)
+{
+	const ts_uplink_s *entry = &history[seq % TS_UPLINK_HISTORY];
+	if (!entry->used || (entry->seq != seq))
+	{
+		return false;
+	}
+	*end_local = entry->end_local;
+	return true;
+}
+
+#endif
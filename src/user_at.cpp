@@ -0,0 +1,437 @@
+/**
+ * @file user_at.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Handle user defined AT commands and application settings
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#if defined NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** File to save application settings */
+File settings_file(InternalFS);
+#elif defined ESP32
+#include <Preferences.h>
+
+/** NVS storage for application settings */
+Preferences settings_prefs;
+#endif
+
+/** Filename to save application settings */
+static const char settings_name[] = "APPSET";
+
+/** Marker for valid settings in flash */
+#define APP_SETTINGS_MARK 0xA5
+/** Marker of the settings saved before the layout field was added */
+#define APP_SETTINGS_MARK_V0 0xAA
+/** Layout of app_settings_s, incremented when a field is added */
+#define APP_SETTINGS_LAYOUT 1
+/** Largest saved settings that are read */
+#define APP_SETTINGS_MAX_SIZE 64
+
+/** Settings saved before the layout field was added, profile was added into the padding byte */
+struct app_settings_v0_s
+{
+	uint8_t valid_mark;
+	bool derived_enable;
+	uint16_t qnh_x10;
+	bool burst_enable;
+	uint8_t profile;
+	bool forecast_enable;
+	uint8_t p2p_ack;
+};
+
+/** Take a field of the saved settings if the saved layout has it, otherwise the default stays */
+#define LOAD_SETTING(field, since)                                                                      \
+	if ((saved.layout >= (since)) && (read_len >= offsetof(app_settings_s, field) + sizeof(saved.field))) \
+	{                                                                                                  \
+		g_app_settings.field = saved.field;                                                            \
+	}
+
+/** Application settings, defaults are used if nothing was saved */
+app_settings_s g_app_settings;
+
+/**
+ * @brief Reset application settings to the default values
+ *
+ */
+static void default_app_settings(void)
+{
+	g_app_settings.valid_mark = APP_SETTINGS_MARK;
+	g_app_settings.layout = APP_SETTINGS_LAYOUT;
+	g_app_settings.derived_enable = false;
+	g_app_settings.qnh_x10 = 10132;
+	g_app_settings.burst_enable = false;
+	g_app_settings.profile = PROFILE_BALANCED;
+	g_app_settings.forecast_enable = false;
+	g_app_settings.p2p_ack = P2P_ACK_OFF;
+}
+
+/**
+ * @brief Take the fields of settings saved before the layout field was added
+ *        The 6 byte version had no profile, its padding byte was read as profile
+ *
+ * @param data saved settings
+ * @param read_len size of the saved settings
+ */
+static void load_app_settings_v0(const uint8_t *data, uint32_t read_len)
+{
+	app_settings_v0_s saved;
+	memcpy((void *)&saved, data, sizeof(app_settings_v0_s));
+	g_app_settings.derived_enable = saved.derived_enable;
+	g_app_settings.qnh_x10 = saved.qnh_x10;
+	g_app_settings.burst_enable = saved.burst_enable;
+	if (read_len >= sizeof(app_settings_v0_s))
+	{
+		g_app_settings.profile = saved.profile;
+		g_app_settings.forecast_enable = saved.forecast_enable;
+		g_app_settings.p2p_ack = saved.p2p_ack;
+	}
+}
+
+/**
+ * @brief Read application settings from flash
+ *        Fields that are missing in the saved layout or out of range get their default values
+ *
+ */
+void read_app_settings(void)
+{
+	default_app_settings();
+	// Zero filled, a shorter saved layout leaves the new fields empty
+	uint8_t data[APP_SETTINGS_MAX_SIZE] = {0};
+	uint32_t read_len = 0;
+#if defined NRF52_SERIES
+	InternalFS.begin();
+	if (InternalFS.exists(settings_name))
+	{
+		settings_file.open(settings_name, FILE_O_READ);
+		read_len = settings_file.read((void *)data, sizeof(data));
+		settings_file.close();
+	}
+#elif defined ESP32
+	settings_prefs.begin(settings_name, true);
+	read_len = settings_prefs.getBytes(settings_name, (void *)data, sizeof(data));
+	settings_prefs.end();
+#endif
+	if ((read_len >= 6) && (data[0] == APP_SETTINGS_MARK_V0))
+	{
+		load_app_settings_v0(data, read_len);
+	}
+	else if ((read_len >= 2) && (data[0] == APP_SETTINGS_MARK))
+	{
+		app_settings_s saved;
+		memcpy((void *)&saved, data, sizeof(app_settings_s));
+		LOAD_SETTING(derived_enable, 1);
+		LOAD_SETTING(qnh_x10, 1);
+		LOAD_SETTING(burst_enable, 1);
+		LOAD_SETTING(profile, 1);
+		LOAD_SETTING(forecast_enable, 1);
+		LOAD_SETTING(p2p_ack, 1);
+	}
+	else
+	{
+		MYLOG("USR_AT", "No valid application settings, using defaults");
+		save_app_settings();
+		return;
+	}
+
+	if ((g_app_settings.qnh_x10 < 8700) || (g_app_settings.qnh_x10 > 10850))
+	{
+		g_app_settings.qnh_x10 = 10132;
+	}
+	if (g_app_settings.profile >= PROFILE_NUM)
+	{
+		g_app_settings.profile = PROFILE_BALANCED;
+	}
+	if (g_app_settings.p2p_ack >= P2P_ACK_NUM)
+	{
+		g_app_settings.p2p_ack = P2P_ACK_OFF;
+	}
+	if ((data[0] != APP_SETTINGS_MARK) || (data[1] != APP_SETTINGS_LAYOUT))
+	{
+		MYLOG("USR_AT", "Application settings converted to layout %d", APP_SETTINGS_LAYOUT);
+		save_app_settings();
+		return;
+	}
+	MYLOG("USR_AT", "Application settings loaded");
+}
+
+/**
+ * @brief Save application settings to flash
+ *
+ * @return true if settings could be saved
+ * @return false if file could not be written
+ */
+bool save_app_settings(void)
+{
+#if defined NRF52_SERIES
+	InternalFS.remove(settings_name);
+	if (!settings_file.open(settings_name, FILE_O_WRITE))
+	{
+		MYLOG("USR_AT", "Could not save application settings");
+		return false;
+	}
+	settings_file.write((uint8_t *)&g_app_settings, sizeof(app_settings_s));
+	settings_file.close();
+	return true;
+#elif defined ESP32
+	settings_prefs.begin(settings_name, false);
+	size_t write_len = settings_prefs.putBytes(settings_name, (void *)&g_app_settings, sizeof(app_settings_s));
+	settings_prefs.end();
+	if (write_len != sizeof(app_settings_s))
+	{
+		MYLOG("USR_AT", "Could not save application settings");
+		return false;
+	}
+	return true;
+#else
+	// RAK11300, no file system for application settings, defaults are used after reset
+	MYLOG("USR_AT", "Application settings are not saved on this core");
+	return false;
+#endif
+}
+
+/**
+ * @brief Save the application settings after a change by AT command
+ *        The changed value stays active until the next reset if it could not be saved
+ *
+ * @return int AT_SUCCESS if saved, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_save_settings(void)
+{
+	return save_app_settings() ? AT_SUCCESS : AT_ERRNO_EXEC_FAIL;
+}
+
+/**
+ * @brief Enable/disable derived values
+ *
+ * @param str 0 = disable, 1 = enable
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_derived(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_app_settings.derived_enable = (str[0] == '1');
+	return at_save_settings();
+}
+
+/**
+ * @brief Query status of derived values
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_derived(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.derived_enable ? 1 : 0);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set sea level pressure (QNH) used for the altitude calculation
+ *
+ * @param str QNH in 1/10 hPa, 8700 to 10850
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_qnh(char *str)
+{
+	char *end;
+	long qnh = strtol(str, &end, 10);
+	if ((*end != 0) || (qnh < 8700) || (qnh > 10850))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_app_settings.qnh_x10 = (uint16_t)qnh;
+	return at_save_settings();
+}
+
+/**
+ * @brief Query sea level pressure (QNH)
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_qnh(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.qnh_x10);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Enable/disable burst capture
+ *
+ * @param str 0 = disable, 1 = enable
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_burst(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_app_settings.burst_enable = (str[0] == '1');
+	return at_save_settings();
+}
+
+/**
+ * @brief Query status of burst capture
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_burst(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.burst_enable ? 1 : 0);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Select the measurement precision profile
+ *
+ * @param str 0 = ultra-low-power, 1 = balanced, 2 = high-precision
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_profile(char *str)
+{
+	if ((str[0] < '0') || (str[0] >= '0' + PROFILE_NUM) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	set_profile(str[0] - '0');
+	return at_save_settings();
+}
+
+/**
+ * @brief Query the measurement precision profile
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_profile(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.profile);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Enable/disable the forecast based uplink suppression
+ *
+ * @param str 0 = disable, 1 = enable
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_forecast(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_app_settings.forecast_enable = (str[0] == '1');
+	// The backend restarts its forecasters with the next frame
+	forecast_resync();
+	return at_save_settings();
+}
+
+/**
+ * @brief Query status of the forecast based uplink suppression
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_forecast(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.forecast_enable ? 1 : 0);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Select the LoRa P2P ACK mode
+ *
+ * @param str 0 = off, 1 = sensor node requests ACKs, 2 = collector sends ACKs
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value, AT_ERRNO_EXEC_FAIL if not saved
+ */
+static int at_set_p2p_ack(char *str)
+{
+	if ((str[0] < '0') || (str[0] >= '0' + P2P_ACK_NUM) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_app_settings.p2p_ack = str[0] - '0';
+	return at_save_settings();
+}
+
+/**
+ * @brief Query the LoRa P2P ACK mode
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_p2p_ack(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_app_settings.p2p_ack);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the time manually, used until the next network time sync
+ *
+ * @param str Unix time in seconds
+ * @return int AT_SUCCESS if ok, AT_ERRNO_PARA_VAL if invalid value
+ */
+static int at_set_time(char *str)
+{
+	char *end;
+	unsigned long unix_s = strtoul(str, &end, 10);
+	if ((*end != 0) || !timesync_set((uint32_t)unix_s))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Query the time and the measured drift of the local clock
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_time(void)
+{
+	uint32_t unix_s;
+	int32_t drift_ppb;
+	timesync_get(&unix_s, &drift_ppb);
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%lu:%ld", (unsigned long)unix_s, (long)drift_ppb);
+	return AT_SUCCESS;
+}
+
+/** List of user AT commands */
+atcmd_t g_user_at_cmd_list_app[] = {
+	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  | Permissions |*/
+	{"+DERIV", "Get/Set derived values 0 = off, 1 = on", at_query_derived, at_set_derived, at_query_derived, "RW"},
+	{"+QNH", "Get/Set sea level pressure in 1/10 hPa", at_query_qnh, at_set_qnh, at_query_qnh, "RW"},
+	{"+BURST", "Get/Set burst capture 0 = off, 1 = on", at_query_burst, at_set_burst, at_query_burst, "RW"},
+	{"+PROFILE", "Get/Set profile 0 = ultra-low-power, 1 = balanced, 2 = high-precision", at_query_profile, at_set_profile, at_query_profile, "RW"},
+	{"+FCAST", "Get/Set forecast uplink suppression 0 = off, 1 = on", at_query_forecast, at_set_forecast, at_query_forecast, "RW"},
+	{"+P2PACK", "Get/Set P2P ACK mode 0 = off, 1 = request, 2 = send", at_query_p2p_ack, at_set_p2p_ack, at_query_p2p_ack, "RW"},
+	{"+TIME", "Get/Set Unix time in seconds, get returns time:drift in ppb", at_query_time, at_set_time, at_query_time, "RW"},
+};
+
+/** Pointer to the user AT command list */
+atcmd_t *g_user_at_cmd_list;
+
+/** Number of user AT commands */
+uint8_t g_user_at_cmd_num = 0;
+
+/**
+ * @brief Initialize the user AT command list and load the application settings
+ *
+ */
+void init_user_at(void)
+{
+	read_app_settings();
+
+	g_user_at_cmd_list = g_user_at_cmd_list_app;
+	g_user_at_cmd_num = sizeof(g_user_at_cmd_list_app) / sizeof(atcmd_t);
+}
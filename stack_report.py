@@ -0,0 +1,110 @@
+import os
+import re
+import subprocess
+
+Import("env")
+
+# Functions that are called by the WisBlock API
+handlers = ["setup_app", "init_app", "app_event_handler", "ble_data_handler", "lora_data_handler"]
+
+# Create static RAM and worst case stack report of the application
+def stack_report(source, target, env):
+    build_dir = env.subst("$BUILD_DIR")
+    src_dir = os.path.join(build_dir, "src")
+    elf_file = target[0].get_abspath()
+    objdump = env.subst("$OBJCOPY").replace("objcopy", "objdump")
+    size_tool = env.subst("$SIZETOOL")
+
+    print("#########################################################")
+    print("Static RAM per application module")
+    print("#########################################################")
+    for obj in sorted(find_files(src_dir, ".o")):
+        output = subprocess.check_output([size_tool, obj]).decode("utf-8").split("\n")
+        fields = output[1].split()
+        print("%-24s data %6s bss %6s" % (os.path.basename(obj), fields[1], fields[2]))
+
+    frames = read_stack_usage(build_dir)
+    calls = read_call_graph(objdump, elf_file)
+
+    print("#########################################################")
+    print("Worst case stack per handler")
+    print("#########################################################")
+    for handler in handlers:
+        unknown = set()
+        depth = max_stack(handler, frames, calls, [], unknown)
+        print("%-24s %6d bytes" % (handler, depth))
+        if unknown:
+            print("    without stack info: " + ", ".join(sorted(unknown)))
+    print("#########################################################")
+
+
+# Add callback after .elf file was created
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", stack_report)
+
+
+def find_files(path, extension):
+    result = []
+    for root, dirs, files in os.walk(path):
+        for name in files:
+            if name.endswith(extension):
+                result.append(os.path.join(root, name))
+    return result
+
+
+def function_name(decl):
+    # "void app_event_handler()" or "foo::bar(int)" => "app_event_handler" or "foo::bar"
+    decl = decl.split("(")[0]
+    return decl.split(" ")[-1]
+
+
+def read_stack_usage(path):
+    # Read the .su files created by -fstack-usage
+    frames = {}
+    for su_file in find_files(path, ".su"):
+        with open(su_file) as f:
+            for line in f:
+                fields = line.strip().split("\t")
+                if len(fields) < 3:
+                    continue
+                name = function_name(fields[0].split(":", 3)[-1])
+                frames[name] = max(frames.get(name, 0), int(fields[1]))
+    return frames
+
+
+def read_call_graph(objdump, elf_file):
+    # Build the call graph from the direct calls in the disassembly
+    calls = {}
+    current = None
+    func_start = re.compile(r"^[0-9a-f]+ <(.+)>:$")
+    func_call = re.compile(r"\s(?:bl|blx|b\.w|b)\s+[0-9a-f]+ <([^+>]+)>")
+    output = subprocess.check_output([objdump, "-dC", elf_file]).decode("utf-8", "ignore")
+    for line in output.split("\n"):
+        match = func_start.match(line)
+        if match:
+            current = function_name(match.group(1))
+            calls.setdefault(current, set())
+            continue
+        match = func_call.search(line)
+        if match and current:
+            callee = function_name(match.group(1))
+            if callee != current:
+                calls[current].add(callee)
+    return calls
+
+
+def max_stack(name, frames, calls, path, unknown, memo=None):
+    if memo is None:
+        memo = {}
+    if name in memo:
+        return memo[name]
+    if name in path:
+        unknown.add(name + " (recursion)")
+        return 0
+    if name not in frames:
+        unknown.add(name)
+        return 0
+    deepest = 0
+    for callee in calls.get(name, []):
+        deepest = max(deepest, max_stack(callee, frames, calls, path + [name], unknown, memo))
+    memo[name] = frames[name] + deepest
+    return memo[name]
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Decode the binary BLE live stream of the WisBlock Kit 1
+#
+# Input is one notification per line as hex string, e.g. copied from the
+# nRF Connect log. Reads from the file given as argument or from stdin.
+#
+# Usage: python3 ble_stream_decode.py [notifications.txt]
+
+import struct
+import sys
+
+# seq, time_ms, valid, temp_x10, humid_x2, press_x10, lux_x100, batt_mv
+FRAME_FORMAT = "<HHBhBHIH"
+FRAME_SIZE = struct.calcsize(FRAME_FORMAT)
+
+VALID_TH = 0x01
+VALID_PRESS = 0x02
+VALID_LIGHT = 0x04
+
+
+def decode_notification(data):
+    frames = []
+    if len(data) % FRAME_SIZE != 0:
+        raise ValueError("Notification length %d is not a multiple of %d" % (len(data), FRAME_SIZE))
+    for offset in range(0, len(data), FRAME_SIZE):
+        seq, time_ms, valid, temp, humid, press, lux, batt = struct.unpack_from(FRAME_FORMAT, data, offset)
+        frames.append({
+            "seq": seq,
+            "time_ms": time_ms,
+            "temp": temp / 10.0 if valid & VALID_TH else None,
+            "humid": humid / 2.0 if valid & VALID_TH else None,
+            "press": press / 10.0 if valid & VALID_PRESS else None,
+            "lux": lux / 100.0 if valid & VALID_LIGHT else None,
+            "batt": batt / 1000.0,
+        })
+    return frames
+
+
+def main():
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    total_frames = 0
+    total_bytes = 0
+    notifications = 0
+    lost = 0
+    last_seq = None
+    elapsed_ms = 0
+    last_time = None
+
+    for line in source:
+        line = line.strip().replace(" ", "").replace("-", "")
+        if not line:
+            continue
+        data = bytes.fromhex(line)
+        notifications += 1
+        total_bytes += len(data)
+        for frame in decode_notification(data):
+            if last_seq is not None:
+                lost += (frame["seq"] - last_seq - 1) & 0xFFFF
+            if last_time is not None:
+                elapsed_ms += (frame["time_ms"] - last_time) & 0xFFFF
+            last_seq = frame["seq"]
+            last_time = frame["time_ms"]
+            total_frames += 1
+            print("%5d T %s H %s P %s L %s B %.3f" % (frame["seq"], frame["temp"], frame["humid"],
+                                                       frame["press"], frame["lux"], frame["batt"]))
+
+    print("#########################################################")
+    print("Notifications %d, frames %d, lost frames %d" % (notifications, total_frames, lost))
+    if elapsed_ms > 0:
+        print("Frame rate %.2f/s, throughput %.1f bytes/s" % ((total_frames - 1) * 1000.0 / elapsed_ms,
+                                                             total_bytes * 1000.0 / elapsed_ms))
+    print("#########################################################")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+/**
+ * @file burst_bench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Check and benchmark of the burst capture kernels src/burst_dsp.h
+ *        Runs the statistics and the band energy of the scalar build (RP2040, ESP32)
+ *        on synthetic pressure and light bursts, compares them with a double precision
+ *        two-pass and DFT reference and reports the time per call
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o burst_bench tools/burst_bench.cpp
+ * Usage: burst_bench [iterations]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include "burst_dsp.h"
+
+/** Same buffer sizes as burst.cpp */
+#define PRESS_SAMPLES 256
+#define LIGHT_SAMPLES 32
+/** LPS22HB pressure resolution in hPa */
+#define PRESS_LSB (1.0 / 4096.0)
+
+/** Allowed errors, the payload resolution of the deviations is 0.01 Pa */
+#define PRESS_TOL 2e-4
+#define STD_TOL_REL 1e-3
+#define BAND_TOL 0.05
+#define LIGHT_TOL_REL 1e-5
+
+/** Reference statistics */
+struct ref_stats_s
+{
+	double min;
+	double max;
+	double mean;
+	double std_dev;
+};
+
+/**
+ * @brief Double precision two-pass statistics
+ */
+static void ref_statistics(const float *samples, uint16_t num, ref_stats_s *stats)
+{
+	stats->min = samples[0];
+	stats->max = samples[0];
+	double sum = 0;
+	for (uint16_t idx = 0; idx < num; idx++)
+	{
+		stats->min = fmin(stats->min, samples[idx]);
+		stats->max = fmax(stats->max, samples[idx]);
+		sum += samples[idx];
+	}
+	stats->mean = sum / num;
+	double sum_sq = 0;
+	for (uint16_t idx = 0; idx < num; idx++)
+	{
+		sum_sq += (samples[idx] - stats->mean) * (samples[idx] - stats->mean);
+	}
+	stats->std_dev = sqrt(sum_sq / (num - 1));
+}
+
+/**
+ * @brief Double precision DFT band energy, same bands as burst_spectrum()
+ */
+static void ref_spectrum(const float *samples, uint16_t num, double mean, double *bands)
+{
+	uint16_t half = num / 2;
+	double power[PRESS_SAMPLES / 2];
+	for (uint16_t bin = 1; bin < half; bin++)
+	{
+		double re = 0;
+		double im = 0;
+		for (uint16_t idx = 0; idx < num; idx++)
+		{
+			double angle = 2.0 * M_PI * bin * idx / num;
+			re += (samples[idx] - mean) * cos(angle);
+			im -= (samples[idx] - mean) * sin(angle);
+		}
+		power[bin] = re * re + im * im;
+	}
+	uint16_t band_start[BURST_BANDS + 1] = {1, (uint16_t)(half / 8), (uint16_t)(half / 4), (uint16_t)(half / 2), half};
+	double total = 0;
+	for (uint8_t band = 0; band < BURST_BANDS; band++)
+	{
+		bands[band] = 0;
+		for (uint16_t bin = band_start[band]; bin < band_start[band + 1]; bin++)
+		{
+			bands[band] += power[bin];
+		}
+		total += bands[band];
+	}
+	for (uint8_t band = 0; band < BURST_BANDS; band++)
+	{
+		bands[band] = total > 0 ? bands[band] * 100.0 / total : 0;
+	}
+}
+
+/**
+ * @brief Pressure kernels as called by read_burst(), on deviations from the first sample
+ */
+static void kernel_press(const float *input, burst_stats_s *stats, float *bands)
+{
+	static float samples[PRESS_SAMPLES];
+	static float spectrum[PRESS_SAMPLES];
+	float press_ref = input[0];
+	for (uint16_t idx = 0; idx < PRESS_SAMPLES; idx++)
+	{
+		samples[idx] = input[idx] - press_ref;
+	}
+	burst_statistics(samples, PRESS_SAMPLES, stats);
+	burst_spectrum(samples, spectrum, PRESS_SAMPLES, stats->mean, bands);
+	stats->min += press_ref;
+	stats->max += press_ref;
+	stats->mean += press_ref;
+}
+
+/** Sink of the timing loops */
+static volatile float sink;
+
+/**
+ * @brief Time per call in us
+ */
+template <typename F>
+static double time_us(F func, int iterations)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int iter = 0; iter < iterations; iter++)
+	{
+		func();
+	}
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / iterations;
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	iterations = iterations > 0 ? iterations : 1;
+	std::mt19937 rng(7);
+	std::normal_distribution<double> noise(0.0, 0.0075);
+	bool ok = true;
+
+	// 75 Hz pressure bursts, Nyquist 37.5 Hz
+	const char *press_names[] = {"quiet", "door pulse", "wind 0.5/3/7/15 Hz", "step", "low pressure"};
+	double press_max_err = 0;
+	double std_max_err = 0;
+	double band_max_err = 0;
+	float press[5][PRESS_SAMPLES];
+	for (int sig = 0; sig < 5; sig++)
+	{
+		for (int idx = 0; idx < PRESS_SAMPLES; idx++)
+		{
+			double t = idx / 75.0;
+			double value = sig == 4 ? 263.4 : 1013.25;
+			value += noise(rng);
+			value += sig == 1 && idx >= 100 && idx < 110 ? 0.35 : 0;
+			value += sig == 2 ? 0.02 * sin(2 * M_PI * 0.5 * t) + 0.01 * sin(2 * M_PI * 3 * t) + 0.01 * sin(2 * M_PI * 7 * t) + 0.005 * sin(2 * M_PI * 15 * t) : 0;
+			value += sig == 3 && idx >= 128 ? -0.12 : 0;
+			press[sig][idx] = (float)(round(value / PRESS_LSB) * PRESS_LSB);
+		}
+
+		burst_stats_s stats;
+		float bands[BURST_BANDS];
+		kernel_press(press[sig], &stats, bands);
+		ref_stats_s ref;
+		double ref_bands[BURST_BANDS];
+		ref_statistics(press[sig], PRESS_SAMPLES, &ref);
+		ref_spectrum(press[sig], PRESS_SAMPLES, ref.mean, ref_bands);
+
+		double err = fmax(fmax(fabs(stats.min - ref.min), fabs(stats.max - ref.max)), fabs(stats.mean - ref.mean));
+		double std_err = fabs(stats.std_dev - ref.std_dev) / ref.std_dev;
+		double band_err = 0;
+		for (int band = 0; band < BURST_BANDS; band++)
+		{
+			band_err = fmax(band_err, fabs(bands[band] - ref_bands[band]));
+		}
+		bool match = err <= PRESS_TOL && std_err <= STD_TOL_REL && band_err <= BAND_TOL;
+		printf("P %-20s mean %9.4f std %.4f bands %5.1f %5.1f %5.1f %5.1f %s\n", press_names[sig], stats.mean, stats.std_dev,
+			   bands[0], bands[1], bands[2], bands[3], match ? "ok" : "FAILED");
+		ok &= match;
+		press_max_err = fmax(press_max_err, err);
+		std_max_err = fmax(std_max_err, std_err);
+		band_max_err = fmax(band_max_err, band_err);
+	}
+	printf("Pressure min/max/mean max error %.2e hPa, std max error %.2e, bands max error %.4f %%\n", press_max_err, std_max_err,
+		   band_max_err);
+
+	// Light bursts, one sample per 100 ms conversion
+	float light[LIGHT_SAMPLES];
+	double light_max_err = 0;
+	const double light_level[] = {0.5, 350.0, 21000.0, 83000.0};
+	for (double level : light_level)
+	{
+		for (int idx = 0; idx < LIGHT_SAMPLES; idx++)
+		{
+			light[idx] = (float)(level * (1.0 + 0.05 * sin(2 * M_PI * idx / 10.0)) + noise(rng) * level);
+		}
+		burst_stats_s stats;
+		ref_stats_s ref;
+		float samples[LIGHT_SAMPLES];
+		memcpy(samples, light, sizeof(samples));
+		burst_statistics(samples, LIGHT_SAMPLES, &stats);
+		ref_statistics(light, LIGHT_SAMPLES, &ref);
+		double err = fmax(fabs(stats.mean - ref.mean), fabs(stats.std_dev - ref.std_dev)) / level;
+		err = fmax(err, fmax(fabs(stats.min - ref.min), fabs(stats.max - ref.max)) / level);
+		light_max_err = fmax(light_max_err, err);
+	}
+	printf("Light max relative error %.2e\n", light_max_err);
+	ok &= light_max_err <= LIGHT_TOL_REL;
+
+	// Timing on the host, relative numbers only
+	burst_stats_s stats;
+	float bands[BURST_BANDS];
+	ref_stats_s ref;
+	double ref_bands[BURST_BANDS];
+	double t_stats = time_us([&]() { float samples[PRESS_SAMPLES]; memcpy(samples, press[2], sizeof(samples)); burst_statistics(samples, PRESS_SAMPLES, &stats); sink = stats.std_dev; }, iterations);
+	double t_ref_stats = time_us([&]() { ref_statistics(press[2], PRESS_SAMPLES, &ref); sink = (float)ref.std_dev; }, iterations);
+	double t_press = time_us([&]() { kernel_press(press[2], &stats, bands); sink = bands[0]; }, iterations);
+	double t_ref_press = time_us([&]() { ref_statistics(press[2], PRESS_SAMPLES, &ref); ref_spectrum(press[2], PRESS_SAMPLES, ref.mean, ref_bands); sink = (float)ref_bands[0]; }, iterations / 10 + 1);
+	printf("Statistics %d samples: kernel %.2f us, reference %.2f us\n", PRESS_SAMPLES, t_stats, t_ref_stats);
+	printf("Statistics and bands %d samples: kernel %.2f us, reference DFT %.2f us (%.0fx)\n", PRESS_SAMPLES, t_press, t_ref_press,
+		   t_ref_press / t_press);
+
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,465 @@
+/**
+ * @file decoder_bench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Check and benchmark of the payload decoder decoder/kit1_decoder.h
+ *        Decodes frames as sent by the firmware and randomized frames (valid and
+ *        corrupted) with the SSSE3 and the scalar extraction, checks that both paths
+ *        give identical results and match a plain byte by byte reference decoder,
+ *        and reports the decoded frames per second
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -mssse3 -I decoder -o decoder_bench tools/decoder_bench.cpp
+ * Usage: decoder_bench [random frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "kit1_decoder.h"
+
+using namespace kit1;
+
+/** Frames as sent by the firmware, see acquisition.cpp for the order of the entries */
+static const char *real_frames[] = {
+	// LoRaWAN, first uplink after reset
+	"0174019a026864036700e1087327a6056501f4180001",
+	// LoRaWAN, with battery runtime
+	"0174019a026864036700e1087327a6056501f417020b8f180001",
+	// LoRaWAN, with runtime, forecast steps and timestamp
+	"0174019a026864036700e1087327a6056501f4170209c41800011900031a856b49d2a3",
+	// LoRaWAN, timestamp and time request
+	"0174019a026864036700e1087327a6056501f41800021a856b49d2001b0005",
+	// LoRaWAN, time request before the first sync
+	"0174019a026864036700e1087327a6056501f41800021b0000",
+	// LoRaWAN, RAK1903 not readable
+	"0174019a026864036700e1087327a61c0004170209c4180001",
+	// LoRaWAN, derived values
+	"0174019a026864036700e1087327a6056501f41e6700561f02035f207900642100032202ff88180001",
+	// LoRaWAN, burst summary
+	"0174019a026864036700e1087327a6056501f40b7327a60c02ffe20d0200210e02000c0f0218f810020a2811020474120201f41365012c1465012a1565013016650002180001",
+	// LoRaWAN, battery protection, battery only
+	"0174014a180000",
+	// LoRa P2P, device ID
+	"0174019a026864036700e1087327a6056501f418000100ffa1b2c3d4",
+	// LoRa P2P, device ID and ACK sequence number
+	"0174019a026864036700e1087327a6056501f418000100ffa1b2c3d41d002a",
+};
+
+/** Expected values of one frame */
+struct expect_s
+{
+	bool valid;
+	uint32_t present;
+	int32_t raw[COL_NUM];
+};
+
+/**
+ * @brief Reference decoder, byte by byte with its own size and channel tables
+ */
+static expect_s reference_decode(const uint8_t *data, size_t len)
+{
+	expect_s exp;
+	memset(&exp, 0, sizeof(exp));
+	if ((len == 0) || (len > MAX_FRAME))
+	{
+		return exp;
+	}
+	size_t pos = 0;
+	while (pos < len)
+	{
+		if (pos + 2 > len)
+		{
+			memset(&exp, 0, sizeof(exp));
+			return exp;
+		}
+		uint8_t channel = data[pos];
+		uint8_t type = data[pos + 1];
+		int size;
+		bool is_signed = false;
+		switch (type)
+		{
+		case 0x00: // Digital input
+		case 0x01: // Digital output
+		case 0x66: // Presence
+		case 0x68: // Humidity
+			size = 1;
+			break;
+		case 0x02: // Analog input
+		case 0x03: // Analog output
+		case 0x67: // Temperature
+		case 0x79: // Altitude
+			size = 2;
+			is_signed = true;
+			break;
+		case 0x65: // Luminosity
+		case 0x73: // Pressure
+		case 0x74: // Voltage
+			size = 2;
+			break;
+		case 0x71: // Accelerometer
+		case 0x86: // Gyrometer
+			size = 6;
+			is_signed = true;
+			break;
+		case 0x88: // GPS
+			size = 9;
+			is_signed = true;
+			break;
+		case 0x85: // Unix time
+		case 0xFF: // Device ID
+			size = 4;
+			break;
+		default:
+			memset(&exp, 0, sizeof(exp));
+			return exp;
+		}
+		if (pos + 2 + size > len)
+		{
+			memset(&exp, 0, sizeof(exp));
+			return exp;
+		}
+		int32_t value = 0;
+		for (int byte = 0; byte < (size < 4 ? size : 4); byte++)
+		{
+			value = (int32_t)(((uint32_t)value << 8) | data[pos + 2 + byte]);
+		}
+		if (is_signed && (size == 1))
+		{
+			value = (int8_t)value;
+		}
+		else if (is_signed && (size == 2))
+		{
+			value = (int16_t)value;
+		}
+		else if (is_signed && (size == 3))
+		{
+			value = (value ^ 0x800000) - 0x800000;
+		}
+
+		int col = -1;
+		if ((channel == 1) && (type == 0x74))
+			col = COL_BATT;
+		else if ((channel == 2) && (type == 0x68))
+			col = COL_HUMID;
+		else if ((channel == 3) && (type == 0x67))
+			col = COL_TEMP;
+		else if (((channel == 4) || (channel == 8)) && (type == 0x73))
+			col = COL_PRESS;
+		else if ((channel == 5) && (type == 0x65))
+			col = COL_LIGHT;
+		else if ((channel == 0) && (type == 0xFF))
+			col = COL_DEVID;
+		else if ((channel == 23) && (type == 0x02))
+			col = COL_RUNTIME;
+		else if ((channel == 24) && (type == 0x00))
+			col = COL_PROFILE;
+		else if ((channel == 25) && (type == 0x00))
+			col = COL_FC_STEPS;
+		else if ((channel == 26) && (type == 0x85))
+			col = COL_TIME;
+		else if ((channel == 27) && (type == 0x00))
+			col = COL_TIME_REQ;
+		else if ((channel == 28) && (type == 0x00))
+			col = COL_SENSOR_ERR;
+		else if ((channel == 29) && (type == 0x00))
+			col = COL_P2P_SEQ;
+		else if ((channel == 30) && (type == 0x67))
+			col = COL_DEW_POINT;
+		else if ((channel == 31) && (type == 0x02))
+			col = COL_ABS_HUMID;
+		else if ((channel == 32) && (type == 0x79))
+			col = COL_ALTITUDE;
+		else if ((channel == 33) && (type == 0x00))
+			col = COL_TENDENCY;
+		else if ((channel == 34) && (type == 0x02))
+			col = COL_PRESS_DELTA;
+		if (col >= 0)
+		{
+			exp.raw[col] = value;
+			exp.present |= 1UL << col;
+		}
+		pos += 2 + size;
+	}
+	exp.valid = true;
+	return exp;
+}
+
+/**
+ * @brief Compare the decoded frame with the reference
+ *
+ * @return true if all columns match
+ */
+static bool check_frame(const batch &out, size_t idx, const expect_s &exp)
+{
+	bool ok = (out.valid[idx] == (exp.valid ? 1 : 0)) && (out.present[idx] == exp.present);
+	ok &= out.batt_v[idx] == exp.raw[COL_BATT] * 0.01f;
+	ok &= out.humid[idx] == exp.raw[COL_HUMID] * 0.5f;
+	ok &= out.temp[idx] == exp.raw[COL_TEMP] * 0.1f;
+	ok &= out.press[idx] == exp.raw[COL_PRESS] * 0.1f;
+	ok &= out.lux[idx] == (float)exp.raw[COL_LIGHT];
+	ok &= out.dev_id[idx] == (uint32_t)exp.raw[COL_DEVID];
+	ok &= out.runtime_d[idx] == exp.raw[COL_RUNTIME] * 0.01f;
+	ok &= out.profile[idx] == (uint8_t)exp.raw[COL_PROFILE];
+	ok &= out.fc_steps[idx] == (uint8_t)exp.raw[COL_FC_STEPS];
+	ok &= out.time[idx] == (uint32_t)exp.raw[COL_TIME];
+	ok &= out.time_req[idx] == ((exp.present >> COL_TIME_REQ) & 1);
+	ok &= out.time_seq[idx] == exp.raw[COL_TIME_REQ];
+	ok &= out.sensor_err[idx] == (uint8_t)exp.raw[COL_SENSOR_ERR];
+	ok &= out.p2p_seq[idx] == (uint8_t)exp.raw[COL_P2P_SEQ];
+	ok &= out.dew_point[idx] == exp.raw[COL_DEW_POINT] * 0.1f;
+	ok &= out.abs_humid[idx] == exp.raw[COL_ABS_HUMID] * 0.01f;
+	ok &= out.altitude[idx] == (float)exp.raw[COL_ALTITUDE];
+	ok &= out.tendency[idx] == (uint8_t)exp.raw[COL_TENDENCY];
+	ok &= out.press_delta[idx] == exp.raw[COL_PRESS_DELTA] * 0.01f;
+	return ok;
+}
+
+/**
+ * @brief Compare the results of both decoder paths bit by bit
+ */
+static bool same_batch(const batch &a, const batch &b, size_t count)
+{
+	bool same = memcmp(a.valid.data(), b.valid.data(), count) == 0;
+	same &= memcmp(a.present.data(), b.present.data(), count * sizeof(uint32_t)) == 0;
+	for (size_t col = 0; col <= COL_NUM; col++)
+	{
+		same &= memcmp(a.raw[col].data(), b.raw[col].data(), count * sizeof(int32_t)) == 0;
+	}
+	same &= memcmp(a.batt_v.data(), b.batt_v.data(), count * sizeof(float)) == 0;
+	same &= memcmp(a.temp.data(), b.temp.data(), count * sizeof(float)) == 0;
+	same &= memcmp(a.press.data(), b.press.data(), count * sizeof(float)) == 0;
+	same &= memcmp(a.lux.data(), b.lux.data(), count * sizeof(float)) == 0;
+	return same;
+}
+
+/**
+ * @brief Append one LPP entry
+ */
+static void add_entry(std::vector<uint8_t> &frame, uint8_t channel, uint8_t type, uint32_t value, int size)
+{
+	frame.push_back(channel);
+	frame.push_back(type);
+	for (int byte = size - 1; byte >= 0; byte--)
+	{
+		frame.push_back((uint8_t)(value >> (byte * 8)));
+	}
+}
+
+/**
+ * @brief Random frame in the layout of the firmware, optional corrupted
+ */
+static std::vector<uint8_t> random_frame(std::mt19937 &rng)
+{
+	std::uniform_int_distribution<uint32_t> any(0, UINT32_MAX);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	std::vector<uint8_t> frame;
+
+	add_entry(frame, 1, 0x74, 300 + any(rng) % 130, 2);
+	bool p2p = chance(rng) < 0.2;
+	uint8_t sensor_err = 0;
+	if (chance(rng) < 0.97)
+	{
+		add_entry(frame, 2, 0x68, any(rng) % 201, 1);
+		add_entry(frame, 3, 0x67, (uint16_t)(int16_t)(any(rng) % 1250 - 400), 2);
+	}
+	else
+	{
+		sensor_err |= 1;
+	}
+	chance(rng) < 0.97 ? add_entry(frame, 8, 0x73, 2600 + any(rng) % 10000, 2) : (void)(sensor_err |= 2);
+	chance(rng) < 0.97 ? add_entry(frame, 5, 0x65, any(rng) & 0xFFFF, 2) : (void)(sensor_err |= 4);
+	if (sensor_err != 0)
+	{
+		add_entry(frame, 28, 0x00, sensor_err, 1);
+	}
+	if (chance(rng) < 0.2)
+	{
+		add_entry(frame, 30, 0x67, (uint16_t)(int16_t)(any(rng) % 900 - 400), 2);
+		add_entry(frame, 31, 0x02, any(rng) % 32768, 2);
+		add_entry(frame, 32, 0x79, (uint16_t)(int16_t)(any(rng) % 9000 - 500), 2);
+		add_entry(frame, 33, 0x00, any(rng) % 9, 1);
+		add_entry(frame, 34, 0x02, (uint16_t)(int16_t)(any(rng) % 4000 - 2000), 2);
+	}
+	if (chance(rng) < 0.1)
+	{
+		add_entry(frame, 11, 0x73, 9000 + any(rng) % 2000, 2);
+		for (uint8_t channel = 12; channel <= 18; channel++)
+		{
+			add_entry(frame, channel, 0x02, any(rng) & 0xFFFF, 2);
+		}
+		for (uint8_t channel = 19; channel <= 22; channel++)
+		{
+			add_entry(frame, channel, 0x65, any(rng) & 0xFFFF, 2);
+		}
+	}
+	if (chance(rng) < 0.8)
+	{
+		add_entry(frame, 23, 0x02, any(rng) % 32768, 2);
+	}
+	add_entry(frame, 24, 0x00, any(rng) % 3, 1);
+	if (chance(rng) < 0.3)
+	{
+		add_entry(frame, 25, 0x00, any(rng) % 25, 1);
+	}
+	if (p2p)
+	{
+		add_entry(frame, 0, 0xFF, any(rng), 4);
+		if (chance(rng) < 0.5)
+		{
+			add_entry(frame, 29, 0x00, any(rng) & 0xFF, 1);
+		}
+	}
+	else
+	{
+		if (chance(rng) < 0.5)
+		{
+			add_entry(frame, 26, 0x85, 1700000000 + any(rng) % 400000000, 4);
+		}
+		if (chance(rng) < 0.1)
+		{
+			add_entry(frame, 27, 0x00, any(rng) & 0xFF, 1);
+		}
+	}
+
+	// Corrupted frames
+	double corrupt = chance(rng);
+	if (corrupt < 0.1)
+	{
+		frame[any(rng) % frame.size()] = (uint8_t)any(rng);
+	}
+	else if (corrupt < 0.15)
+	{
+		frame.resize(any(rng) % frame.size());
+	}
+	else if (corrupt < 0.2)
+	{
+		frame.push_back((uint8_t)any(rng));
+	}
+	else if (corrupt < 0.22)
+	{
+		frame.resize(1 + any(rng) % 60);
+		for (uint8_t &byte : frame)
+		{
+			byte = (uint8_t)any(rng);
+		}
+	}
+	return frame;
+}
+
+/**
+ * @brief Decoded frames per second
+ */
+static double frames_per_s(const decoder &dec, const std::vector<frame_view> &views, batch &out)
+{
+	size_t rounds = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed;
+	do
+	{
+		dec.decode(views.data(), views.size(), out);
+		rounds++;
+		elapsed = std::chrono::steady_clock::now() - start;
+	} while (elapsed.count() < 0.5);
+	return rounds * views.size() / elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+	size_t random_num = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+	random_num = random_num > 0 ? random_num : 1;
+	bool ok = true;
+	decoder simd_dec(true);
+	decoder scalar_dec(false);
+
+#if defined(__SSSE3__)
+	printf("SSSE3 extraction compiled in\n");
+#else
+	printf("SSSE3 not enabled, both paths are scalar, build with -mssse3\n");
+#endif
+
+	// Firmware frames
+	size_t real_num = sizeof(real_frames) / sizeof(real_frames[0]);
+	std::vector<std::vector<uint8_t>> real_data(real_num);
+	std::vector<frame_view> real_views(real_num);
+	for (size_t idx = 0; idx < real_num; idx++)
+	{
+		const char *hex = real_frames[idx];
+		for (size_t pos = 0; hex[pos] && hex[pos + 1]; pos += 2)
+		{
+			char byte[3] = {hex[pos], hex[pos + 1], 0};
+			real_data[idx].push_back((uint8_t)strtoul(byte, NULL, 16));
+		}
+		real_views[idx].data = real_data[idx].data();
+		real_views[idx].len = real_data[idx].size();
+	}
+	batch simd_out;
+	batch scalar_out;
+	size_t simd_valid = simd_dec.decode(real_views.data(), real_num, simd_out);
+	size_t scalar_valid = scalar_dec.decode(real_views.data(), real_num, scalar_out);
+	bool real_ok = (simd_valid == real_num) && (scalar_valid == real_num) && same_batch(simd_out, scalar_out, real_num);
+	for (size_t idx = 0; idx < real_num; idx++)
+	{
+		expect_s exp = reference_decode(real_views[idx].data, real_views[idx].len);
+		bool match = check_frame(simd_out, idx, exp) && check_frame(scalar_out, idx, exp);
+		if (!match)
+		{
+			printf("Firmware frame %zu does not match the reference: %s\n", idx, real_frames[idx]);
+		}
+		real_ok &= match;
+	}
+	printf("Firmware frames: %zu decoded, %s\n", real_num, real_ok ? "ok" : "FAILED");
+	ok &= real_ok;
+
+	// Randomized frames
+	std::mt19937 rng(42);
+	std::vector<std::vector<uint8_t>> rand_data(random_num);
+	std::vector<frame_view> rand_views(random_num);
+	for (size_t idx = 0; idx < random_num; idx++)
+	{
+		rand_data[idx] = random_frame(rng);
+		rand_views[idx].data = rand_data[idx].data();
+		rand_views[idx].len = rand_data[idx].size();
+	}
+	simd_valid = simd_dec.decode(rand_views.data(), random_num, simd_out);
+	scalar_valid = scalar_dec.decode(rand_views.data(), random_num, scalar_out);
+	bool rand_ok = (simd_valid == scalar_valid) && same_batch(simd_out, scalar_out, random_num);
+	size_t mismatch = 0;
+	size_t standard = 0;
+	for (size_t idx = 0; idx < random_num; idx++)
+	{
+		expect_s exp = reference_decode(rand_views[idx].data, rand_views[idx].len);
+		if (!check_frame(simd_out, idx, exp) || !check_frame(scalar_out, idx, exp))
+		{
+			mismatch++;
+		}
+		standard += (rand_views[idx].len >= 19) && (rand_views[idx].data[0] == 1) && (rand_views[idx].data[11] == 8) &&
+					(rand_views[idx].data[15] == 5);
+	}
+	rand_ok &= mismatch == 0;
+	printf("Random frames: %zu decoded, %zu valid, %zu with the standard layout, %zu mismatches, %s\n", random_num, simd_valid,
+		   standard, mismatch, rand_ok ? "ok" : "FAILED");
+	ok &= rand_ok;
+
+	// Throughput, standard frames repeated to a batch of 4096
+	std::vector<frame_view> std_views;
+	for (size_t idx = 0; std_views.size() < 4096; idx++)
+	{
+		if (idx % real_num < 4)
+		{
+			std_views.push_back(real_views[idx % real_num]);
+		}
+	}
+	printf("Standard frames: SSSE3 %.2f M frames/s, scalar %.2f M frames/s\n", frames_per_s(simd_dec, std_views, simd_out) / 1e6,
+		   frames_per_s(scalar_dec, std_views, scalar_out) / 1e6);
+	printf("Random frames: SSSE3 %.2f M frames/s, scalar %.2f M frames/s\n", frames_per_s(simd_dec, rand_views, simd_out) / 1e6,
+		   frames_per_s(scalar_dec, rand_views, scalar_out) / 1e6);
+
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
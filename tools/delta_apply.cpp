@@ -0,0 +1,154 @@
+/**
+ * @file delta_apply.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host test of the firmware delta applier src/delta_patch.cpp
+ *        Applies a delta created by create_delta.py to a firmware image
+ *        with the same code as the device, the delta is fed in random chunks
+ *        like it arrives over BLE or LoRaWAN
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o delta_apply tools/delta_apply.cpp src/delta_patch.cpp src/sha256.cpp
+ * Usage: delta_apply old.bin new.delta out.bin [expected.bin]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "delta_patch.h"
+
+/** Running image (old bank) */
+static std::vector<uint8_t> old_bank;
+/** Inactive bank */
+static std::vector<uint8_t> new_bank;
+/** Next expected write offset, the device writes strictly sequential */
+static uint32_t next_write = 0;
+
+static bool read_old(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	// Beyond the image the bank reads like erased flash
+	memset(buffer, 0xFF, len);
+	if (offset < old_bank.size())
+	{
+		uint32_t avail = old_bank.size() - offset;
+		memcpy(buffer, &old_bank[offset], len < avail ? len : avail);
+	}
+	return true;
+}
+
+static bool write_new(uint32_t offset, const uint8_t *buffer, uint32_t len)
+{
+	if ((offset != next_write) || ((uint64_t)offset + len > new_bank.size()))
+	{
+		fprintf(stderr, "Write out of order at %u\n", offset);
+		return false;
+	}
+	memcpy(&new_bank[offset], buffer, len);
+	next_write += len;
+	return true;
+}
+
+static bool read_new(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+	if ((uint64_t)offset + len > new_bank.size())
+	{
+		return false;
+	}
+	memcpy(buffer, &new_bank[offset], len);
+	return true;
+}
+
+static bool read_file(const char *name, std::vector<uint8_t> &data)
+{
+	FILE *file = fopen(name, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", name);
+		return false;
+	}
+	uint8_t buffer[4096];
+	size_t len;
+	while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + len);
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4)
+	{
+		fprintf(stderr, "Usage: delta_apply old.bin new.delta out.bin [expected.bin]\n");
+		return 1;
+	}
+	std::vector<uint8_t> delta;
+	if (!read_file(argv[1], old_bank) || !read_file(argv[2], delta))
+	{
+		return 1;
+	}
+
+	// Inactive bank of the same size as on the device, filled like erased flash
+	const delta_io_s io = {read_old, write_new, read_new, 0x63000};
+	new_bank.assign(io.max_size, 0xFF);
+
+	static delta_patch_s patch;
+	delta_patch_begin(&patch, &io);
+
+	// Feed the delta in chunks of 1 to 242 bytes
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<uint32_t> chunk_dist(1, 242);
+	delta_result_e result = DELTA_MORE;
+	size_t pos = 0;
+	uint32_t chunks = 0;
+	while ((pos < delta.size()) && (result == DELTA_MORE))
+	{
+		uint32_t chunk = chunk_dist(rng);
+		chunk = chunk < (delta.size() - pos) ? chunk : (uint32_t)(delta.size() - pos);
+		result = delta_patch_write(&patch, &delta[pos], chunk);
+		pos += chunk;
+		chunks++;
+	}
+	if ((result == DELTA_DONE) && (pos != delta.size()))
+	{
+		fprintf(stderr, "Data after the end of the new image\n");
+		return 1;
+	}
+	printf("Result %s after %u chunks, delta %zu bytes, new image %u bytes, RAM %zu bytes\n",
+		   delta_result_str(result), chunks, delta.size(), patch.header.new_size, sizeof(delta_patch_s));
+	if (result != DELTA_DONE)
+	{
+		return 1;
+	}
+
+	FILE *file = fopen(argv[3], "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot write %s\n", argv[3]);
+		return 1;
+	}
+	fwrite(new_bank.data(), 1, patch.header.new_size, file);
+	fclose(file);
+
+	if (argc > 4)
+	{
+		std::vector<uint8_t> expected;
+		if (!read_file(argv[4], expected))
+		{
+			return 1;
+		}
+		if ((expected.size() != patch.header.new_size) || (memcmp(expected.data(), new_bank.data(), expected.size()) != 0))
+		{
+			printf("New image differs from %s\n", argv[4]);
+			return 1;
+		}
+		printf("New image matches %s\n", argv[4]);
+	}
+	return 0;
+}
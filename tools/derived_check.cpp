@@ -0,0 +1,124 @@
+/**
+ * @file derived_check.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Check of the fixed-point derived values src/derived.h against a floating-point reference
+ *        Sweeps the SHTC3 range (-40 to 125 degC, 0.5 to 100 %RH) and the LPS22HB range (260 to 1260 hPa)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o derived_check tools/derived_check.cpp
+ * Usage: derived_check
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include "derived.h"
+
+/** Allowed errors of the fixed-point results */
+#define DEW_POINT_TOL 0.2
+#define ABS_HUMID_TOL_REL 0.005
+#define ABS_HUMID_TOL_ABS 0.02
+/** fp_exp2() has an error < 1e-4, 4.4 m of the 44331 m scale, plus rounding */
+#define ALTITUDE_TOL 6.0
+
+/**
+ * @brief Reference absolute humidity in g/m3, same Magnus coefficients as the device
+ */
+static double ref_abs_humid(double temp, double humid)
+{
+	double vapor = humid / 100.0 * 6.112 * exp(17.62 * temp / (243.12 + temp));
+	return 216.7 * vapor / (273.15 + temp);
+}
+
+/**
+ * @brief Reference dew point in degC
+ */
+static double ref_dew_point(double temp, double humid)
+{
+	double gamma = log(humid / 100.0) + 17.62 * temp / (243.12 + temp);
+	return 243.12 * gamma / (17.62 - gamma);
+}
+
+int main(void)
+{
+	bool ok = true;
+
+	// Known points, values of the review of the Q16.16 overflow
+	const struct
+	{
+		int16_t temp_x10;
+		uint16_t humid_x2;
+		double abs_humid;
+	} points[] = {
+		{200, 100, 8.63},
+		{600, 160, 104.0},
+		{600, 200, 130.1},
+	};
+	for (const auto &point : points)
+	{
+		int16_t dew_point_x10 = 0;
+		uint16_t abs_humid_x100 = 0;
+		calc_dew_point(point.temp_x10, point.humid_x2, &dew_point_x10, &abs_humid_x100);
+		bool match = fabs(abs_humid_x100 / 100.0 - point.abs_humid) <= 0.1;
+		printf("%5.1f degC %5.1f %%RH: %7.2f g/m3 (expected %7.2f) %s\n", point.temp_x10 / 10.0, point.humid_x2 / 2.0,
+			   abs_humid_x100 / 100.0, point.abs_humid, match ? "ok" : "FAILED");
+		ok &= match;
+	}
+
+	// Sweep of the sensor range
+	double max_dew_err = 0;
+	double max_ah_err = 0;
+	uint32_t saturated = 0;
+	for (int16_t temp_x10 = -400; temp_x10 <= 1250; temp_x10 += 5)
+	{
+		for (uint16_t humid_x2 = 1; humid_x2 <= 200; humid_x2++)
+		{
+			int16_t dew_point_x10;
+			uint16_t abs_humid_x100;
+			if (!calc_dew_point(temp_x10, humid_x2, &dew_point_x10, &abs_humid_x100))
+			{
+				printf("No result at %d/10 degC %d/2 %%\n", temp_x10, humid_x2);
+				ok = false;
+				continue;
+			}
+			double temp = temp_x10 / 10.0;
+			double humid = humid_x2 / 2.0;
+			double dew_err = fabs(dew_point_x10 / 10.0 - ref_dew_point(temp, humid));
+			double ah_ref = ref_abs_humid(temp, humid);
+			double ah_err;
+			if (ah_ref * 100.0 >= ABS_HUMID_MAX_X100)
+			{
+				// Outside of the payload range, must saturate
+				saturated++;
+				ah_err = abs_humid_x100 == ABS_HUMID_MAX_X100 ? 0 : ah_ref;
+			}
+			else
+			{
+				ah_err = fabs(abs_humid_x100 / 100.0 - ah_ref);
+				ah_err = ah_err <= ABS_HUMID_TOL_ABS ? 0 : ah_err / ah_ref / ABS_HUMID_TOL_REL * ABS_HUMID_TOL_ABS;
+			}
+			max_dew_err = dew_err > max_dew_err ? dew_err : max_dew_err;
+			max_ah_err = ah_err > max_ah_err ? ah_err : max_ah_err;
+		}
+	}
+	printf("Dew point max error %.3f degC\n", max_dew_err);
+	printf("Absolute humidity within %.1f %% or %.2f g/m3: %s, %u saturated points\n", ABS_HUMID_TOL_REL * 100, ABS_HUMID_TOL_ABS,
+		   max_ah_err <= ABS_HUMID_TOL_ABS ? "yes" : "NO", saturated);
+	ok &= max_dew_err <= DEW_POINT_TOL;
+	ok &= max_ah_err <= ABS_HUMID_TOL_ABS;
+
+	double max_alt_err = 0;
+	for (uint16_t press_x10 = 2600; press_x10 <= 12600; press_x10 += 7)
+	{
+		double ref = 44330.8 * (1.0 - pow(press_x10 / 10132.0, 0.190263));
+		double err = fabs(calc_altitude(press_x10, 10132) - ref);
+		max_alt_err = err > max_alt_err ? err : max_alt_err;
+	}
+	printf("Altitude max error %.2f m\n", max_alt_err);
+	ok &= max_alt_err <= ALTITUDE_TOL;
+
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,484 @@
+/**
+ * @file forecast_replay.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Replay benchmark of the forecast based uplink suppression src/forecast.h
+ *        Runs the device decision and the backend reconstruction on a series of
+ *        readings, checks that both calculate bit-identical forecasts and reports
+ *        the saved uplinks against the reconstruction error. A plain deadband with
+ *        the same bounds is run for comparison. Each reading is also encoded with
+ *        the derived values (ATC+DERIV=1), the forecasted values must be the same.
+ *        A loss model drops sent frames and reports how long the backend has no
+ *        valid forecast with confirmed and unconfirmed uplinks. Battery protection
+ *        frames without sensor values are mixed in, device and backend must restart
+ *        their forecasters together
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o forecast_replay tools/forecast_replay.cpp
+ * Usage: forecast_replay [readings.csv]
+ *        CSV lines: temperature degC, humidity %, pressure hPa, light lux
+ *        one line per measurement cycle. Without a file 30 days with a
+ *        10 minute interval are generated
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "forecast.h"
+
+/** One measurement cycle */
+struct reading_s
+{
+	double temp;
+	double humid;
+	double press;
+	double lux;
+};
+
+/** Channel names and scale of the LPP encoding */
+static const char *ch_names[FC_CH_NUM] = {"temperature", "humidity", "pressure", "light"};
+static const double ch_scale[FC_CH_NUM] = {10.0, 2.0, 10.0, 1.0};
+static const char *ch_units[FC_CH_NUM] = {"degC", "%", "hPa", "lux"};
+
+/**
+ * @brief Encode a reading like acquire_frame() with the Cayenne LPP library
+ *        The library truncates the scaled value
+ *
+ * @param reading reading
+ * @param derived add the derived values on channels 30 to 34 like add_derived()
+ * @param frame returns the payload
+ * @return uint8_t payload length
+ */
+static uint8_t encode_frame(const reading_s &reading, bool derived, uint8_t *frame)
+{
+	uint8_t len = 0;
+	uint16_t batt = 395;
+	int16_t temp = (int16_t)(reading.temp * 10);
+	uint16_t press = (uint16_t)(reading.press * 10);
+	uint16_t lux = (uint16_t)reading.lux;
+	const uint8_t entries[] = {1, 0x74, (uint8_t)(batt >> 8), (uint8_t)batt,
+							   2, 0x68, (uint8_t)(reading.humid * 2),
+							   3, 0x67, (uint8_t)(temp >> 8), (uint8_t)temp,
+							   8, 0x73, (uint8_t)(press >> 8), (uint8_t)press,
+							   5, 0x65, (uint8_t)(lux >> 8), (uint8_t)lux};
+	memcpy(frame, entries, sizeof(entries));
+	len = sizeof(entries);
+	if (derived)
+	{
+		// Approximations, only the encoding matters here
+		int16_t dew_point = (int16_t)((reading.temp - (100.0 - reading.humid) / 5.0) * 10);
+		uint16_t abs_humid = (uint16_t)(reading.humid * 0.1 * 100);
+		int16_t altitude = (int16_t)(44330.0 * (1.0 - pow(reading.press / 1013.2, 0.1903)));
+		int16_t delta = (int16_t)((reading.press - 1013.0) * 10);
+		const uint8_t derived_entries[] = {30, 0x67, (uint8_t)(dew_point >> 8), (uint8_t)dew_point,
+										   31, 0x02, (uint8_t)(abs_humid >> 8), (uint8_t)abs_humid,
+										   32, 0x79, (uint8_t)(altitude >> 8), (uint8_t)altitude,
+										   33, 0x00, (uint8_t)(delta > 0 ? 1 : 0),
+										   34, 0x02, (uint8_t)(delta >> 8), (uint8_t)delta};
+		memcpy(&frame[len], derived_entries, sizeof(derived_entries));
+		len += sizeof(derived_entries);
+	}
+	frame[len++] = 24;
+	frame[len++] = 0x00;
+	frame[len++] = 1;
+	return len;
+}
+
+/**
+ * @brief Encode a battery protection frame like acquire_frame() without sensor values
+ *
+ * @param frame returns the payload
+ * @return uint8_t payload length
+ */
+static uint8_t encode_batt_frame(uint8_t *frame)
+{
+	const uint8_t entries[] = {1, 0x74, 0x01, 0x68, 24, 0x00, 1};
+	memcpy(frame, entries, sizeof(entries));
+	return sizeof(entries);
+}
+
+/**
+ * @brief Generate readings with daily cycles, weather fronts and sensor noise
+ *
+ * @param readings returns the readings
+ * @param days number of days
+ * @param interval_min measurement interval in minutes
+ */
+static void generate_readings(std::vector<reading_s> &readings, uint32_t days, uint32_t interval_min)
+{
+	std::mt19937 rng(42);
+	std::normal_distribution<double> noise(0.0, 1.0);
+	double front = 0;
+	double press_drift = 0;
+	double clouds = 0;
+	uint32_t cycles = days * 24 * 60 / interval_min;
+	for (uint32_t idx = 0; idx < cycles; idx++)
+	{
+		double hour = fmod(idx * interval_min / 60.0, 24.0);
+		double day_phase = (hour - 9.0) / 24.0 * 2.0 * M_PI;
+		// Weather fronts every few days move temperature and pressure together
+		front = 0.999 * front + 0.02 * noise(rng);
+		press_drift = 0.998 * press_drift + 0.03 * noise(rng) - 0.01 * front;
+		clouds = 0.95 * clouds + 0.1 * noise(rng);
+
+		reading_s reading;
+		reading.temp = 14.0 + 6.0 * sin(day_phase) + 3.0 * front + 0.05 * noise(rng);
+		reading.humid = 65.0 - 20.0 * sin(day_phase) - 5.0 * front + 0.3 * noise(rng);
+		reading.humid = reading.humid < 5 ? 5 : reading.humid > 100 ? 100 : reading.humid;
+		reading.press = 1013.0 + 8.0 * press_drift + 0.03 * noise(rng);
+		double sun = sin((hour - 6.0) / 12.0 * M_PI);
+		double cloud_factor = 1.0 / (1.0 + exp(-clouds)) * 0.8 + 0.2;
+		reading.lux = sun > 0 ? 30000.0 * sun * cloud_factor : 0.0;
+		readings.push_back(reading);
+	}
+}
+
+/**
+ * @brief Read readings from a CSV file
+ *
+ * @param name file name
+ * @param readings returns the readings
+ * @return true if at least one line was read
+ */
+static bool read_readings(const char *name, std::vector<reading_s> &readings)
+{
+	FILE *file = fopen(name, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", name);
+		return false;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		reading_s reading;
+		if (sscanf(line, "%lf,%lf,%lf,%lf", &reading.temp, &reading.humid, &reading.press, &reading.lux) == 4)
+		{
+			readings.push_back(reading);
+		}
+	}
+	fclose(file);
+	return !readings.empty();
+}
+
+/** Reconstruction error per channel */
+struct error_s
+{
+	double sum_sq[FC_CH_NUM];
+	double max_abs[FC_CH_NUM];
+	uint32_t num;
+
+	void add(const int32_t *truth, const int32_t *reconstructed)
+	{
+		for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+		{
+			double diff = (truth[ch] - reconstructed[ch]) / ch_scale[ch];
+			sum_sq[ch] += diff * diff;
+			max_abs[ch] = fabs(diff) > max_abs[ch] ? fabs(diff) : max_abs[ch];
+		}
+		num++;
+	}
+};
+
+static void print_result(const char *name, uint32_t sent, uint32_t total, const error_s &error)
+{
+	printf("%-10s uplinks %6u of %6u (%5.1f %% saved)\n", name, sent, total, 100.0 * (total - sent) / total);
+	for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+	{
+		printf("           %-12s RMS error %8.3f %-4s max %8.3f %s\n", ch_names[ch], sqrt(error.sum_sq[ch] / (error.num > 0 ? error.num : 1)),
+			   ch_units[ch], error.max_abs[ch], ch_units[ch]);
+	}
+}
+
+/** Result of a forecast replay */
+struct replay_s
+{
+	uint32_t sent;		   // Frames sent by the device
+	uint32_t lost;		   // Sent frames the backend did not receive
+	uint32_t unknown;	   // Cycles the backend has no valid forecast for
+	uint32_t max_unknown;  // Longest run of such cycles
+	uint32_t mismatch;	   // Device and backend calculated different forecasts while in sync
+	uint32_t parse_errors; // Frames with derived values parsed differently
+	error_s error;		   // Reconstruction error of the cycles with a valid forecast
+};
+
+/**
+ * @brief Run the device decision of forecast_check() and the backend on the readings
+ *        The backend sees a lost frame from the gap in the LoRaWAN frame counter and
+ *        has no valid forecast until the next restart of the forecasters
+ *
+ * @param readings readings
+ * @param loss probability that a sent frame is lost
+ * @param confirmed the device knows about lost frames (confirmed uplinks, P2P ACKs)
+ * @param resync_steps suppressed frames after which the next sent unconfirmed frame restarts, 0 = never
+ * @param batt_interval every batt_interval cycles a battery protection frame without sensor values, 0 = never
+ * @param result returns the result
+ */
+static void run_forecast(const std::vector<reading_s> &readings, double loss, bool confirmed, uint32_t resync_steps,
+						 uint32_t batt_interval, replay_s *result)
+{
+	memset(result, 0, sizeof(replay_s));
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> channel(0.0, 1.0);
+
+	// Device and backend state, both start with a restart (step 0)
+	forecast_s device[FC_CH_NUM];
+	forecast_s backend[FC_CH_NUM];
+	// Padding bytes are compared as well
+	memset(device, 0, sizeof(device));
+	memset(backend, 0, sizeof(backend));
+	bool resync = true;
+	uint8_t frame_steps = 0;
+	uint32_t suppressed = 0;
+	// Frames since the last frame the backend received
+	uint32_t backend_gap = 0;
+	// Backend missed a frame and waits for a restart
+	bool backend_lost = true;
+	uint32_t unknown_run = 0;
+	uint32_t cycle = 0;
+
+	for (const reading_s &reading : readings)
+	{
+		uint8_t frame[64];
+		uint8_t len;
+		cycle++;
+		if ((batt_interval != 0) && ((cycle % batt_interval) == 0))
+		{
+			// Battery protection frame, always sent and restarts the forecasters (forecast_check())
+			len = encode_batt_frame(frame);
+			int32_t values[FC_CH_NUM];
+			uint8_t steps;
+			uint8_t present = fc_lpp_values(frame, len, values, &steps);
+			result->parse_errors += present != 0 ? 1 : 0;
+			frame_steps = 0;
+			suppressed = 0;
+			resync = false;
+			fc_receive(device, values, present, 0);
+			frame[len++] = FC_LPP_CH_STEPS;
+			frame[len++] = 0x00;
+			frame[len++] = 0;
+			result->sent++;
+			if (channel(rng) >= loss)
+			{
+				int32_t rx_values[FC_CH_NUM];
+				uint8_t rx_steps;
+				uint8_t rx_present = fc_lpp_values(frame, len, rx_values, &rx_steps);
+				fc_receive(backend, rx_values, rx_present, rx_steps);
+				backend_lost = rx_steps != 0;
+				backend_gap = 0;
+				result->mismatch += memcmp(device, backend, sizeof(device)) != 0 ? 1 : 0;
+			}
+			else
+			{
+				result->lost++;
+				backend_lost = true;
+				resync = confirmed;
+			}
+			// No reading in this cycle
+			continue;
+		}
+		len = encode_frame(reading, false, frame);
+		int32_t values[FC_CH_NUM];
+		uint8_t steps;
+		uint8_t present = fc_lpp_values(frame, len, values, &steps);
+
+		// Same values with the derived values in the frame
+		uint8_t derived_frame[64];
+		uint8_t derived_len = encode_frame(reading, true, derived_frame);
+		int32_t derived_values[FC_CH_NUM];
+		uint8_t derived_present = fc_lpp_values(derived_frame, derived_len, derived_values, &steps);
+		if ((present != 0x0F) || (derived_present != present) || (memcmp(values, derived_values, sizeof(values)) != 0))
+		{
+			result->parse_errors++;
+		}
+
+		// Device, same decision as forecast_check()
+		frame_steps++;
+		bool periodic = !confirmed && (resync_steps != 0) && (suppressed >= resync_steps);
+		bool received = true;
+		if ((fc_must_send(device, values, present, frame_steps) != 0) || resync)
+		{
+			if (resync || periodic)
+			{
+				resync = false;
+				frame_steps = 0;
+				suppressed = 0;
+			}
+			fc_receive(device, values, present, frame_steps);
+			// Steps entry appended like addDigitalInput(FC_LPP_CH_STEPS)
+			frame[len++] = FC_LPP_CH_STEPS;
+			frame[len++] = 0x00;
+			frame[len++] = frame_steps;
+			frame_steps = 0;
+			result->sent++;
+
+			received = channel(rng) >= loss;
+			if (received)
+			{
+				// Backend receives the frame
+				int32_t rx_values[FC_CH_NUM];
+				uint8_t rx_steps;
+				uint8_t rx_present = fc_lpp_values(frame, len, rx_values, &rx_steps);
+				fc_receive(backend, rx_values, rx_present, rx_steps);
+				backend_lost &= rx_steps != 0;
+				backend_gap = 0;
+				if (!backend_lost)
+				{
+					result->mismatch += memcmp(device, backend, sizeof(device)) != 0 ? 1 : 0;
+				}
+			}
+			else
+			{
+				result->lost++;
+				backend_lost = true;
+				// A failed confirmed uplink restarts the forecasters with the next frame
+				resync = confirmed;
+			}
+		}
+		else
+		{
+			// Backend fills the gap with the forecast
+			suppressed++;
+			backend_gap++;
+		}
+
+		if (backend_lost)
+		{
+			result->unknown++;
+			unknown_run++;
+			result->max_unknown = unknown_run > result->max_unknown ? unknown_run : result->max_unknown;
+			continue;
+		}
+		unknown_run = 0;
+		int32_t reconstructed[FC_CH_NUM];
+		for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+		{
+			reconstructed[ch] = received && (backend_gap == 0) ? values[ch] : fc_predict(&backend[ch], backend[ch].steps + backend_gap);
+			if (backend_gap != 0)
+			{
+				result->mismatch += reconstructed[ch] != fc_predict(&device[ch], device[ch].steps + frame_steps) ? 1 : 0;
+			}
+		}
+		result->error.add(values, reconstructed);
+	}
+}
+
+/**
+ * @brief Plain deadband with the same bounds, the backend holds the last value
+ *
+ * @param readings readings
+ * @param error returns the reconstruction error
+ * @return uint32_t sent frames
+ */
+static uint32_t run_deadband(const std::vector<reading_s> &readings, error_s *error)
+{
+	int32_t last[FC_CH_NUM] = {0};
+	bool init = false;
+	uint8_t steps = 0;
+	uint32_t sent = 0;
+	for (const reading_s &reading : readings)
+	{
+		uint8_t frame[64];
+		uint8_t len = encode_frame(reading, false, frame);
+		int32_t values[FC_CH_NUM];
+		uint8_t frame_steps;
+		fc_lpp_values(frame, len, values, &frame_steps);
+
+		steps++;
+		bool send = !init || (steps >= FC_MAX_STEPS);
+		for (uint8_t ch = 0; ch < FC_CH_NUM; ch++)
+		{
+			int32_t bound = fc_kit1_cfg[ch].bound + (int32_t)((int64_t)abs(last[ch]) * fc_kit1_cfg[ch].bound_rel / FC_WEIGHT_ONE);
+			send |= abs(values[ch] - last[ch]) > bound;
+		}
+		if (send)
+		{
+			memcpy(last, values, sizeof(last));
+			init = true;
+			steps = 0;
+			sent++;
+		}
+		error->add(values, last);
+	}
+	return sent;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<reading_s> readings;
+	if (argc > 1)
+	{
+		if (!read_readings(argv[1], readings))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		generate_readings(readings, 30, 10);
+	}
+	uint32_t total = (uint32_t)readings.size();
+	printf("%u measurement cycles\n", total);
+
+	// Unconfirmed uplinks without losses, as the device runs by default
+	replay_s fc;
+	run_forecast(readings, 0.0, false, FC_RESYNC_STEPS, 0, &fc);
+	print_result("Forecast", fc.sent, total, fc.error);
+	error_s db_error = {};
+	uint32_t db_sent = run_deadband(readings, &db_error);
+	print_result("Deadband", db_sent, total, db_error);
+	uint32_t mismatch = fc.mismatch;
+	uint32_t parse_errors = fc.parse_errors;
+
+	// Lost frames, the backend has no forecast until the next restart
+	printf("\nLost frames             loss  uplinks  saved  lost  no forecast  longest  temp RMS\n");
+	const double losses[] = {0.01, 0.05, 0.1};
+	const struct
+	{
+		const char *name;
+		bool confirmed;
+		uint32_t resync_steps;
+	} modes[] = {{"unconfirmed, no resync", false, 0}, {"unconfirmed, resync 1", false, 1}, {"unconfirmed, resync 3", false, 3},
+				 {"unconfirmed, resync 6", false, FC_RESYNC_STEPS}, {"unconfirmed, resync 24", false, 24}, {"confirmed", true, 0}};
+	for (const auto &mode : modes)
+	{
+		for (double loss : losses)
+		{
+			replay_s result;
+			run_forecast(readings, loss, mode.confirmed, mode.resync_steps, 0, &result);
+			printf("%-22s %4.0f %% %8u %5.1f %% %5u %9.1f %% %8u %9.3f\n", mode.name, loss * 100, result.sent,
+				   100.0 * (total - result.sent) / total, result.lost, 100.0 * result.unknown / total, result.max_unknown,
+				   sqrt(result.error.sum_sq[FC_CH_TEMP] / (result.error.num > 0 ? result.error.num : 1)));
+			mismatch += result.mismatch;
+			parse_errors += result.parse_errors;
+		}
+	}
+
+	// Battery protection frames between the sensor frames
+	printf("\nBattery protection      loss  uplinks  saved  lost  no forecast  longest  temp RMS\n");
+	const uint32_t batt_intervals[] = {37, 500};
+	for (uint32_t batt_interval : batt_intervals)
+	{
+		for (bool confirmed : {false, true})
+		{
+			replay_s result;
+			run_forecast(readings, confirmed ? 0.05 : 0.0, confirmed, confirmed ? 0 : FC_RESYNC_STEPS, batt_interval, &result);
+			printf("every %3u, %-11s %4.0f %% %8u %5.1f %% %5u %9.1f %% %8u %9.3f\n", batt_interval, confirmed ? "confirmed" : "unconfirmed",
+				   confirmed ? 5.0 : 0.0, result.sent, 100.0 * (total - result.sent) / total, result.lost, 100.0 * result.unknown / total,
+				   result.max_unknown, sqrt(result.error.sum_sq[FC_CH_TEMP] / (result.error.num > 0 ? result.error.num : 1)));
+			mismatch += result.mismatch;
+			parse_errors += result.parse_errors;
+		}
+	}
+
+	printf("\nDevice/backend mismatches: %u\n", mismatch);
+	printf("Frames with derived values parsed differently: %u\n", parse_errors);
+	bool ok = (mismatch == 0) && (parse_errors == 0);
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
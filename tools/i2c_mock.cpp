@@ -0,0 +1,645 @@
+/**
+ * @file i2c_mock.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host mock of the I2C transport src/i2c_async.h
+ *        Simulates the SHTC3, LPS22HB and OPT3001 of the WisBlock Kit 1 and
+ *        runs the sensor drivers of the device against them. Faults are injected
+ *        with devices that hold SDA low and lose their configuration
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o i2c_mock tools/i2c_mock.cpp src/shtc3.cpp src/lps22hb.cpp src/opt3001.cpp
+ * Usage: i2c_mock
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "i2c_async.h"
+#include "spsc_queue.h"
+#include "shtc3.h"
+#include "lps22hb.h"
+#include "opt3001.h"
+
+/** Simulated time in us */
+static uint64_t mock_time_us = 0;
+/** Time the bus was busy in us */
+static uint64_t mock_bus_us = 0;
+/** Bus clock */
+static uint32_t mock_frequency = 100000;
+/** Bus clear could not release the bus, like i2c_stuck of the device */
+static bool mock_stuck = false;
+/** Number of bus clears */
+static uint32_t mock_bus_clears = 0;
+
+/**
+ * @brief Simulated I2C device
+ *        write() gets the write part of a transaction, read() the read part.
+ *        Returning false is a NACK
+ */
+class mock_device
+{
+public:
+	explicit mock_device(uint8_t address) : addr(address) {}
+	virtual ~mock_device() {}
+	virtual bool write(const uint8_t *data, uint8_t len) = 0;
+	virtual bool read(uint8_t *data, uint8_t len) = 0;
+	/** Power glitch, the device is back in its reset state */
+	virtual void power_on_reset(void) = 0;
+	uint8_t addr;
+	/** Clock pulses until the device releases SDA, 0 = released, 0xFF = never */
+	uint8_t hold_sda = 0;
+	/** Number of initializations by the driver */
+	uint32_t inits = 0;
+};
+
+/** CRC-8 of the SHTC3, polynomial 0x31, init 0xFF */
+static uint8_t mock_crc8(uint16_t word)
+{
+	uint8_t crc = 0xFF;
+	uint8_t data[2] = {(uint8_t)(word >> 8), (uint8_t)word};
+	for (uint8_t idx = 0; idx < 2; idx++)
+	{
+		crc ^= data[idx];
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = crc & 0x80 ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/** SHTC3, NACKs everything but the wake up command while sleeping */
+class mock_shtc3 : public mock_device
+{
+public:
+	mock_shtc3() : mock_device(SHTC3_ADDRESS) {}
+
+	bool write(const uint8_t *data, uint8_t len)
+	{
+		if (len != 2)
+		{
+			return false;
+		}
+		uint16_t cmd = (data[0] << 8) | data[1];
+		if (cmd == 0x3517)
+		{
+			awake = true;
+			return true;
+		}
+		if (!awake)
+		{
+			return false;
+		}
+		switch (cmd)
+		{
+		case 0xB098:
+			awake = false;
+			return true;
+		case 0xEFC8:
+			inits++;
+			words[0] = 0x0887;
+			num_words = 1;
+			ready_us = mock_time_us;
+			return true;
+		case 0x7866:
+		case 0x609C:
+			words[0] = (uint16_t)lround((temp + 45.0) / 175.0 * 65536.0);
+			words[1] = (uint16_t)lround(humid / 100.0 * 65536.0);
+			num_words = 2;
+			ready_us = mock_time_us + (cmd == 0x609C ? 800 : 12100);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool read(uint8_t *data, uint8_t len)
+	{
+		// Without clock stretching the read header is not acknowledged during the measurement
+		if (!awake || (num_words == 0) || (mock_time_us < ready_us))
+		{
+			return false;
+		}
+		for (uint8_t idx = 0; idx < len; idx++)
+		{
+			uint16_t word = words[(idx / 3) % num_words];
+			uint8_t bytes[3] = {(uint8_t)(word >> 8), (uint8_t)word, mock_crc8(word)};
+			data[idx] = bytes[idx % 3];
+		}
+		if (corrupt_crc)
+		{
+			data[2] ^= 0x01;
+		}
+		return true;
+	}
+
+	void power_on_reset(void)
+	{
+		awake = false;
+		num_words = 0;
+	}
+
+	double temp = 21.5;
+	double humid = 48.0;
+	bool corrupt_crc = false;
+
+private:
+	bool awake = false;
+	uint16_t words[2] = {0, 0};
+	uint8_t num_words = 0;
+	uint64_t ready_us = 0;
+};
+
+/** LPS22HB, 8 bit registers with address auto increment */
+class mock_lps22hb : public mock_device
+{
+public:
+	mock_lps22hb() : mock_device(LPS22HB_ADDRESS)
+	{
+		power_on_reset();
+	}
+
+	bool write(const uint8_t *data, uint8_t len)
+	{
+		pointer = data[0];
+		for (uint8_t idx = 1; idx < len; idx++)
+		{
+			regs[(pointer + idx - 1) & 0x7F] = data[idx];
+		}
+		// Software reset clears itself and the configuration
+		if (regs[0x11] & 0x04)
+		{
+			inits++;
+			power_on_reset();
+		}
+		return true;
+	}
+
+	void power_on_reset(void)
+	{
+		memset(regs, 0, sizeof(regs));
+		regs[0x0F] = 0xB1;
+		regs[0x11] = 0x10;
+	}
+
+	bool read(uint8_t *data, uint8_t len)
+	{
+		// Continuous mode updates the output registers
+		if ((regs[0x10] & 0x70) != 0)
+		{
+			int32_t raw = (int32_t)lround(pressure * 4096.0);
+			regs[0x28] = (uint8_t)raw;
+			regs[0x29] = (uint8_t)(raw >> 8);
+			regs[0x2A] = (uint8_t)(raw >> 16);
+		}
+		for (uint8_t idx = 0; idx < len; idx++)
+		{
+			data[idx] = regs[(pointer + idx) & 0x7F];
+		}
+		return true;
+	}
+
+	double pressure = 1013.25;
+	uint8_t regs[0x80];
+
+private:
+	uint8_t pointer = 0;
+};
+
+/** OPT3001, 16 bit registers, MSB first */
+class mock_opt3001 : public mock_device
+{
+public:
+	mock_opt3001() : mock_device(OPT3001_ADDRESS) {}
+
+	bool write(const uint8_t *data, uint8_t len)
+	{
+		pointer = data[0];
+		if ((len == 3) && (pointer == 0x01))
+		{
+			inits++;
+			config = (data[1] << 8) | data[2];
+		}
+		return true;
+	}
+
+	/** Reset state is shutdown mode */
+	void power_on_reset(void)
+	{
+		config = 0xC810;
+	}
+
+	bool read(uint8_t *data, uint8_t len)
+	{
+		uint16_t value = 0;
+		switch (pointer)
+		{
+		case 0x00:
+			value = result();
+			break;
+		case 0x01:
+			value = config;
+			break;
+		case 0x7E:
+			value = 0x5449;
+			break;
+		case 0x7F:
+			value = 0x3001;
+			break;
+		}
+		for (uint8_t idx = 0; idx < len; idx++)
+		{
+			data[idx] = idx & 1 ? (uint8_t)value : (uint8_t)(value >> 8);
+		}
+		return true;
+	}
+
+	double lux = 420.0;
+	uint16_t config = 0xC810;
+
+private:
+	/** Result register with the smallest exponent that fits the mantissa */
+	uint16_t result(void)
+	{
+		if ((config & 0x0600) == 0)
+		{
+			return 0;
+		}
+		uint8_t exponent = 0;
+		while ((exponent < 11) && (lux / (0.01 * (1 << exponent)) > 4095.0))
+		{
+			exponent++;
+		}
+		uint16_t mantissa = (uint16_t)(lux / (0.01 * (1 << exponent)));
+		return (exponent << 12) | mantissa;
+	}
+	uint8_t pointer = 0;
+};
+
+static mock_shtc3 dev_shtc3;
+static mock_lps22hb dev_lps22hb;
+static mock_opt3001 dev_opt3001;
+static mock_device *devices[] = {&dev_shtc3, &dev_lps22hb, &dev_opt3001};
+
+/** Queued transactions, like the TWIM backend */
+static spsc_queue<i2c_xfer_s *, I2C_QUEUE_SIZE> mock_queue;
+
+/**
+ * @brief Check if a device holds SDA low
+ *
+ * @return true if the bus is blocked
+ */
+static bool mock_sda_low(void)
+{
+	for (mock_device *dev : devices)
+	{
+		if (dev->hold_sda != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Transaction that hangs on the blocked bus, like a TWIM that never reaches STOPPED */
+static i2c_xfer_s *mock_current = NULL;
+
+/**
+ * @brief Run one transaction on the simulated bus
+ *
+ * @param xfer transaction
+ */
+static void mock_execute(i2c_xfer_s *xfer)
+{
+	// Start, address, data and repeated start with 9 clocks per byte
+	uint32_t bytes = 1 + xfer->tx_len + ((xfer->rx_len != 0) ? 1 + xfer->rx_len : 0);
+	uint64_t duration = (uint64_t)bytes * 9 * 1000000 / mock_frequency;
+	mock_time_us += duration;
+	mock_bus_us += duration;
+
+	if (mock_sda_low())
+	{
+		// No completion, the transaction passes its deadline
+		mock_current = xfer;
+		return;
+	}
+
+	i2c_result_e result = I2C_ERR_NACK;
+	for (mock_device *dev : devices)
+	{
+		if (dev->addr != xfer->addr)
+		{
+			continue;
+		}
+		bool ack = true;
+		if ((xfer->tx_len != 0) || (xfer->rx_len == 0))
+		{
+			ack = (xfer->tx_len == 0) || dev->write(xfer->tx, xfer->tx_len);
+		}
+		if (ack && (xfer->rx_len != 0))
+		{
+			ack = dev->read(xfer->rx_buf, xfer->rx_len);
+		}
+		result = ack ? I2C_OK : I2C_ERR_NACK;
+	}
+	xfer->result = result;
+	if (xfer->callback != NULL)
+	{
+		xfer->callback(xfer);
+	}
+}
+
+/**
+ * @brief Run all queued transactions, like the completion interrupt does
+ *
+ */
+static void mock_run_bus(void)
+{
+	i2c_xfer_s *xfer;
+	while ((mock_current == NULL) && mock_queue.pop(xfer))
+	{
+		mock_execute(xfer);
+	}
+}
+
+/**
+ * @brief Finish a transaction with a timeout
+ *
+ * @param xfer transaction
+ */
+static void mock_timeout(i2c_xfer_s *xfer)
+{
+	xfer->result = I2C_ERR_TIMEOUT;
+	if (xfer->callback != NULL)
+	{
+		xfer->callback(xfer);
+	}
+}
+
+/**
+ * @brief Stop the hanging transaction, like i2c_abort() of the TWIM backend
+ *        The running and all queued transactions finish with I2C_ERR_TIMEOUT
+ *
+ */
+static void mock_abort(void)
+{
+	i2c_xfer_s *xfer = mock_current;
+	mock_current = NULL;
+	if (xfer != NULL)
+	{
+		mock_timeout(xfer);
+	}
+	while (mock_queue.pop(xfer))
+	{
+		mock_timeout(xfer);
+	}
+}
+
+bool i2c_init(uint32_t frequency)
+{
+	mock_frequency = frequency;
+	return true;
+}
+
+bool i2c_submit(i2c_xfer_s *xfer)
+{
+	if ((xfer->tx_len > I2C_TX_MAX) || ((xfer->rx_len != 0) && (xfer->rx_buf == NULL)))
+	{
+		xfer->result = I2C_ERR_QUEUE;
+		return false;
+	}
+	xfer->result = I2C_PENDING;
+	if (!mock_queue.push(xfer))
+	{
+		xfer->result = I2C_ERR_QUEUE;
+		return false;
+	}
+	return true;
+}
+
+i2c_result_e i2c_transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len)
+{
+	if (tx_len > I2C_TX_MAX)
+	{
+		return I2C_ERR_QUEUE;
+	}
+	i2c_xfer_s xfer = {};
+	xfer.addr = addr;
+	if (tx_len != 0)
+	{
+		memcpy(xfer.tx, tx, tx_len);
+	}
+	xfer.tx_len = tx_len;
+	xfer.rx_buf = rx;
+	xfer.rx_len = rx_len;
+	if (mock_stuck && !i2c_bus_clear())
+	{
+		return I2C_ERR_BUS;
+	}
+	if (!i2c_submit(&xfer))
+	{
+		return I2C_ERR_QUEUE;
+	}
+	mock_run_bus();
+	if (xfer.result == I2C_PENDING)
+	{
+		// The task sleeps until the deadline
+		mock_time_us += I2C_TIMEOUT_MS * 1000;
+		mock_abort();
+		i2c_bus_clear();
+	}
+	return (i2c_result_e)xfer.result;
+}
+
+/**
+ * @brief Bus clear, a device holding SDA shifts out one bit per clock pulse
+ *
+ * @return true if the bus is released
+ */
+bool i2c_bus_clear(void)
+{
+	mock_bus_clears++;
+	for (uint8_t pulse = 0; (pulse < 9) && mock_sda_low(); pulse++)
+	{
+		for (mock_device *dev : devices)
+		{
+			dev->hold_sda -= (dev->hold_sda != 0) && (dev->hold_sda != 0xFF) ? 1 : 0;
+		}
+		mock_time_us += 10;
+	}
+	// STOP and re-initialization of the peripheral
+	mock_time_us += 20;
+	mock_stuck = mock_sda_low();
+	return !mock_stuck;
+}
+
+bool i2c_probe(uint8_t addr)
+{
+	return i2c_transfer(addr, NULL, 0, NULL, 0) == I2C_OK;
+}
+
+void i2c_delay_ms(uint32_t ms)
+{
+	mock_time_us += (uint64_t)ms * 1000;
+}
+
+/** Number of failed checks */
+static int failed = 0;
+
+static void check(bool ok, const char *name)
+{
+	printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+	failed += ok ? 0 : 1;
+}
+
+/** Completion order of the queue test */
+static uint8_t done_order[I2C_QUEUE_SIZE];
+static uint8_t done_count = 0;
+
+static void mock_done(i2c_xfer_s *xfer)
+{
+	done_order[done_count++] = (uint8_t)(uintptr_t)xfer->context;
+}
+
+int main(void)
+{
+	i2c_init(400000);
+
+	uint8_t found = 0;
+	for (uint8_t adr = 1; adr < 127; adr++)
+	{
+		found += i2c_probe(adr) ? 1 : 0;
+	}
+	check(found == 3, "bus scan finds 3 devices");
+
+	check(shtc3_init(), "SHTC3 init");
+	check(lps22hb_init(), "LPS22HB init");
+	check(opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH), "OPT3001 init");
+	check(dev_opt3001.config == 0xC610, "OPT3001 configuration");
+
+	float temp = 0;
+	float humid = 0;
+	uint64_t start_us = mock_time_us;
+	uint64_t start_bus = mock_bus_us;
+	check(shtc3_read(false, &temp, &humid) && (fabs(temp - 21.5) < 0.01) && (fabs(humid - 48.0) < 0.01), "SHTC3 read");
+	printf("     SHTC3 cycle %llu us, bus busy %llu us\n", (unsigned long long)(mock_time_us - start_us),
+		   (unsigned long long)(mock_bus_us - start_bus));
+	start_us = mock_time_us;
+	check(shtc3_read(true, &temp, &humid) && (fabs(temp - 21.5) < 0.01), "SHTC3 low power read");
+	printf("     SHTC3 low power cycle %llu us\n", (unsigned long long)(mock_time_us - start_us));
+
+	dev_shtc3.temp = -12.3;
+	dev_shtc3.humid = 97.0;
+	check(shtc3_read(false, &temp, &humid) && (fabs(temp + 12.3) < 0.01) && (fabs(humid - 97.0) < 0.01), "SHTC3 read below 0 degC");
+
+	dev_shtc3.corrupt_crc = true;
+	check(!shtc3_read(false, &temp, &humid), "SHTC3 CRC error detected");
+	dev_shtc3.corrupt_crc = false;
+
+	float pressure = 0;
+	check(lps22hb_set_rate(LPS22HB_RATE_75_HZ) && ((dev_lps22hb.regs[0x10] & 0x70) == 0x50), "LPS22HB data rate");
+	check(lps22hb_read(&pressure) && (fabs(pressure - 1013.25) < 0.001), "LPS22HB read");
+	lps22hb_set_rate(LPS22HB_RATE_ONE_SHOT);
+
+	check(lps22hb_set_low_current(true) && (dev_lps22hb.regs[0x1A] == 0x01) && ((dev_lps22hb.regs[0x10] & 0x70) == 0), "LPS22HB low-current mode");
+	lps22hb_set_low_current(false);
+
+	float lux = 0;
+	check(opt3001_init(OPT3001_CFG_AUTO_RANGE | OPT3001_CFG_CONT | OPT3001_CFG_LATCH | OPT3001_CFG_800MS) && (dev_opt3001.config == 0xCE10), "OPT3001 800 ms conversion");
+	check(opt3001_read(&lux) && (fabs(lux - 420.0) < 0.2), "OPT3001 read");
+	dev_opt3001.lux = 65000.0;
+	check(opt3001_read(&lux) && (fabs(lux - 65000.0) / 65000.0 < 0.001), "OPT3001 read high range");
+
+	uint8_t rx[2];
+	check(i2c_transfer(0x29, NULL, 0, rx, 2) == I2C_ERR_NACK, "missing device NACK");
+
+	// Queued transactions finish in order, one slot of the ring stays empty
+	i2c_xfer_s xfers[I2C_QUEUE_SIZE];
+	uint8_t results[I2C_QUEUE_SIZE][2];
+	uint8_t queued = 0;
+	for (uint8_t idx = 0; idx < I2C_QUEUE_SIZE; idx++)
+	{
+		memset(&xfers[idx], 0, sizeof(i2c_xfer_s));
+		xfers[idx].addr = OPT3001_ADDRESS;
+		xfers[idx].tx[0] = 0x7E;
+		xfers[idx].tx_len = 1;
+		xfers[idx].rx_buf = results[idx];
+		xfers[idx].rx_len = 2;
+		xfers[idx].callback = mock_done;
+		xfers[idx].context = (void *)(uintptr_t)idx;
+		queued += i2c_submit(&xfers[idx]) ? 1 : 0;
+	}
+	check((queued == I2C_QUEUE_SIZE - 1) && (xfers[I2C_QUEUE_SIZE - 1].result == I2C_ERR_QUEUE), "queue full detected");
+	check(xfers[0].result == I2C_PENDING, "queued transaction pending");
+	mock_run_bus();
+	bool in_order = done_count == queued;
+	for (uint8_t idx = 0; idx < done_count; idx++)
+	{
+		in_order = in_order && (done_order[idx] == idx) && (xfers[idx].result == I2C_OK) && (results[idx][0] == 0x54);
+	}
+	check(in_order, "queued transactions complete in order");
+
+	// Fault injection: the OPT3001 holds SDA after a power glitch in the middle of a read
+	uint32_t shtc3_inits = dev_shtc3.inits;
+	uint32_t lps22hb_inits = dev_lps22hb.inits;
+	uint32_t opt3001_inits = dev_opt3001.inits;
+	uint32_t clears = mock_bus_clears;
+	dev_opt3001.power_on_reset();
+	dev_opt3001.hold_sda = 3;
+	start_us = mock_time_us;
+	check(!opt3001_read(&lux), "OPT3001 read on a blocked bus fails");
+	printf("     OPT3001 timeout and recovery %llu us\n", (unsigned long long)(mock_time_us - start_us));
+	check(mock_time_us - start_us <= (I2C_TIMEOUT_MS + 1) * 1000, "transaction returns within its deadline");
+	check((mock_bus_clears == clears + 1) && (dev_opt3001.hold_sda == 0), "bus clear releases SDA");
+	check((dev_opt3001.inits == opt3001_inits + 1) && (dev_opt3001.config == 0xCE10), "OPT3001 configuration restored");
+	check((dev_shtc3.inits == shtc3_inits) && (dev_lps22hb.inits == lps22hb_inits), "other sensors not re-initialized");
+	dev_opt3001.lux = 420.0;
+	check(opt3001_read(&lux) && (fabs(lux - 420.0) < 0.2), "OPT3001 read after recovery");
+
+	// LPS22HB stops in the middle of a burst, the rate and mode of the burst are restored
+	lps22hb_set_low_current(true);
+	lps22hb_set_rate(LPS22HB_RATE_75_HZ);
+	opt3001_inits = dev_opt3001.inits;
+	dev_lps22hb.power_on_reset();
+	dev_lps22hb.hold_sda = 9;
+	check(!lps22hb_read(&pressure), "LPS22HB read on a blocked bus fails");
+	check(((dev_lps22hb.regs[0x10] & 0x70) == 0x50) && (dev_lps22hb.regs[0x1A] == 0x01), "LPS22HB rate and mode restored");
+	check(dev_opt3001.inits == opt3001_inits, "OPT3001 not re-initialized");
+	check(lps22hb_read(&pressure) && (fabs(pressure - 1013.25) < 0.001), "LPS22HB read after recovery");
+	lps22hb_set_low_current(false);
+
+	// SHTC3 measurement on a blocked bus
+	shtc3_inits = dev_shtc3.inits;
+	dev_shtc3.hold_sda = 1;
+	start_us = mock_time_us;
+	check(!shtc3_read(false, &temp, &humid) && (dev_shtc3.inits == shtc3_inits + 1), "SHTC3 re-initialized after timeout");
+	// One deadline, the re-initialization waits 1 ms for the wake up
+	check(mock_time_us - start_us <= (I2C_TIMEOUT_MS + 2) * 1000, "SHTC3 read returns after one deadline");
+	check(shtc3_read(false, &temp, &humid) && (fabs(temp + 12.3) < 0.01), "SHTC3 read after recovery");
+
+	// Queued transactions on the blocked bus finish with a timeout
+	dev_opt3001.hold_sda = 2;
+	done_count = 0;
+	xfers[0].result = 0;
+	check(i2c_submit(&xfers[0]) && (i2c_transfer(OPT3001_ADDRESS, NULL, 0, rx, 2) == I2C_ERR_TIMEOUT) &&
+			  (xfers[0].result == I2C_ERR_TIMEOUT) && (done_count == 1),
+		  "queued transactions aborted");
+
+	// A device that never releases SDA, the transactions fail without waiting for the deadline
+	dev_lps22hb.hold_sda = 0xFF;
+	start_us = mock_time_us;
+	check(i2c_probe(LPS22HB_ADDRESS) == false, "stuck bus detected");
+	uint64_t stuck_us = mock_time_us;
+	check(!shtc3_read(false, &temp, &humid) && !opt3001_read(&lux) && !lps22hb_read(&pressure), "readings invalid on a stuck bus");
+	printf("     Stuck bus: first transaction %llu us, 3 sensor reads %llu us\n", (unsigned long long)(stuck_us - start_us),
+		   (unsigned long long)(mock_time_us - stuck_us));
+	check(mock_time_us - stuck_us < 20000, "stuck bus fails fast");
+	dev_lps22hb.hold_sda = 0;
+	check(opt3001_read(&lux) && lps22hb_read(&pressure), "bus recovers when the device releases SDA");
+
+	printf("%s\n", failed == 0 ? "All tests passed" : "Tests failed");
+	return failed == 0 ? 0 : 1;
+}
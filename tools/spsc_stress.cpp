@@ -0,0 +1,245 @@
+/**
+ * @file spsc_stress.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Stress test of the lock-free queue src/spsc_queue.h and of the frame
+ *        handoff between the LoRa/BLE core and the acquisition core (acquisition.cpp)
+ *        with two std::threads
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The handoff test mirrors the RAK3112 firmware: the radio thread changes the
+ * settings all the time (AT commands) and requests forecast restarts, each
+ * request carries a settings snapshot. The acquisition thread encodes the
+ * snapshot and the seen restart count into the frame. The radio thread checks
+ * that every frame belongs to its request, carries the complete snapshot of
+ * that request and did not miss a restart that was requested before it.
+ *
+ * Build: g++ -O2 -std=c++11 -pthread -I src -o spsc_stress tools/spsc_stress.cpp
+ *        add -fsanitize=thread to check for data races
+ * Usage: spsc_stress [iterations]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "spsc_queue.h"
+
+/** Same layout as app_settings_s in app.h */
+struct settings_s
+{
+	uint8_t valid_mark;
+	uint8_t layout;
+	bool derived_enable;
+	uint16_t qnh_x10;
+	bool burst_enable;
+	uint8_t profile;
+	bool forecast_enable;
+	uint8_t p2p_ack;
+};
+
+/** Same content as acq_request_s in acquisition.cpp plus the request number */
+struct request_s
+{
+	uint32_t seq;
+	bool read_sensors;
+	bool add_dev_id;
+	bool confirmed;
+	settings_s settings;
+};
+
+/** Same size as acq_frame_s in app.h, data carries the encoded request */
+struct frame_s
+{
+	uint8_t data[242];
+	uint8_t len;
+	uint16_t batt_mv;
+	bool send;
+	uint32_t time_ms;
+};
+
+/** Large element for the plain queue test, torn copies are detected */
+struct block_s
+{
+	uint64_t seq;
+	uint64_t fill[15];
+};
+
+/**
+ * @brief One producer, one consumer, elements must arrive complete and in order
+ */
+static bool queue_test(uint64_t count)
+{
+	spsc_queue<block_s, 4> queue;
+	std::atomic<bool> ok(true);
+	std::thread producer([&]() {
+		block_s block;
+		for (uint64_t seq = 0; seq < count; seq++)
+		{
+			block.seq = seq;
+			for (int idx = 0; idx < 15; idx++)
+			{
+				block.fill[idx] = seq * 31 + idx;
+			}
+			while (!queue.push(block))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+	block_s block;
+	for (uint64_t seq = 0; seq < count; seq++)
+	{
+		while (!queue.pop(block))
+		{
+			std::this_thread::yield();
+		}
+		bool match = block.seq == seq;
+		for (int idx = 0; idx < 15; idx++)
+		{
+			match &= block.fill[idx] == seq * 31 + idx;
+		}
+		if (!match)
+		{
+			ok = false;
+		}
+	}
+	producer.join();
+	return ok && queue.empty();
+}
+
+/** Forecast restart counter, written by the radio thread only (forecast.cpp) */
+static std::atomic<uint32_t> resync_count(1);
+
+/**
+ * @brief Radio thread and acquisition thread as in acquisition.cpp
+ */
+static bool handoff_test(uint32_t count)
+{
+	spsc_queue<request_s, 4> requests;
+	spsc_queue<frame_s, 4> frames;
+	std::atomic<bool> stop(false);
+
+	// Acquisition core, owns its settings copy and the restart state
+	std::thread acquisition([&]() {
+		settings_s acq_settings;
+		uint32_t resync_done = 0;
+		request_s request;
+		frame_s frame;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			if (!requests.pop(request))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			memcpy(&acq_settings, &request.settings, sizeof(settings_s));
+			uint32_t resync = resync_count.load(std::memory_order_acquire);
+			bool restart = resync != resync_done;
+			resync_done = resync;
+			// Encoding takes time, the radio thread changes its settings meanwhile
+			for (volatile int spin = 0; spin < (int)(request.seq % 64); spin++)
+			{
+			}
+			memset(&frame, 0, sizeof(frame));
+			memcpy(&frame.data[0], &request.seq, sizeof(uint32_t));
+			memcpy(&frame.data[4], &acq_settings, sizeof(settings_s));
+			memcpy(&frame.data[4 + sizeof(settings_s)], &resync, sizeof(uint32_t));
+			frame.data[8 + sizeof(settings_s)] = restart;
+			frame.len = 9 + sizeof(settings_s);
+			frame.send = request.read_sensors;
+			while (!frames.push(frame))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	// LoRa/BLE core
+	settings_s settings;
+	memset(&settings, 0, sizeof(settings));
+	request_s sent[4];
+	uint32_t resync_at[4];
+	uint32_t next_seq = 0;
+	uint32_t received = 0;
+	uint32_t restarts = 0;
+	bool ok = true;
+	while (received < count)
+	{
+		// AT commands change the settings at any time
+		settings.qnh_x10 = (uint16_t)(9000 + next_seq % 3000);
+		settings.profile = (uint8_t)(next_seq % 3);
+		settings.derived_enable = (next_seq & 1) != 0;
+		settings.valid_mark = (uint8_t)(settings.qnh_x10 ^ settings.profile);
+		// Up to 3 requests in flight
+		if ((next_seq < count) && (next_seq - received < 3))
+		{
+			if (((next_seq % 7) == 0) && (resync_count.load(std::memory_order_relaxed) == next_seq / 7 + 1))
+			{
+				// forecast_resync(), while the acquisition may be encoding the previous frame
+				resync_count.store(resync_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+			request_s request;
+			request.seq = next_seq;
+			request.read_sensors = true;
+			request.add_dev_id = false;
+		request.confirmed = false;
+			memcpy(&request.settings, &settings, sizeof(settings_s));
+			uint32_t resync_before = resync_count.load(std::memory_order_relaxed);
+			if (requests.push(request))
+			{
+				sent[next_seq & 3] = request;
+				resync_at[next_seq & 3] = resync_before;
+				next_seq++;
+			}
+		}
+		frame_s frame;
+		if (!frames.pop(frame))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		uint32_t seq;
+		uint32_t resync;
+		settings_s frame_settings;
+		memcpy(&seq, &frame.data[0], sizeof(uint32_t));
+		memcpy(&frame_settings, &frame.data[4], sizeof(settings_s));
+		memcpy(&resync, &frame.data[4 + sizeof(settings_s)], sizeof(uint32_t));
+		restarts += frame.data[8 + sizeof(settings_s)];
+		bool match = (seq == received) && (frame.len == 9 + sizeof(settings_s));
+		match &= memcmp(&frame_settings, &sent[seq & 3].settings, sizeof(settings_s)) == 0;
+		// A restart requested before the request must be seen by its frame
+		match &= (int32_t)(resync - resync_at[seq & 3]) >= 0;
+		if (!match && ok)
+		{
+			printf("Frame %u does not match request %u\n", seq, received);
+		}
+		ok &= match;
+		received++;
+	}
+	stop = true;
+	acquisition.join();
+	uint32_t requested = resync_count.load() - 1;
+	printf("Handoff: %u frames, %u forecast restarts requested, %u seen\n", received, requested, restarts);
+	// Each restart is requested before a request, no restart may get lost
+	return ok && (restarts == requested);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000000;
+	count = count > 0 ? count : 1;
+
+	bool queue_ok = queue_test(count * 4ULL);
+	printf("Queue: %llu elements of %zu bytes, %s\n", (unsigned long long)count * 4, sizeof(block_s), queue_ok ? "ok" : "FAILED");
+	bool handoff_ok = handoff_test(count);
+	printf("Handoff: %s\n", handoff_ok ? "ok" : "FAILED");
+
+	bool ok = queue_ok && handoff_ok;
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file timesync_sim.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Simulation of the network time sync src/timesync.h against a network server clock
+ *        A node with a drifting local clock sends a timestamped frame every 10 minutes,
+ *        the timestamps (Unix time in seconds as sent on channel 26) are compared
+ *        with the true measurement time. The time downlink answers a request in the
+ *        RX window of the next received uplink and is matched by the sequence number
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build: g++ -O2 -std=c++11 -I src -o timesync_sim tools/timesync_sim.cpp
+ * Usage: timesync_sim
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "timesync.h"
+
+/** Simulated days */
+#define SIM_DAYS 30
+/** Measurement and send interval */
+#define SIM_INTERVAL_MS (10 * 60 * 1000LL)
+/** Time-on-air of an uplink */
+#define SIM_TOA_MS 100
+/** Network time at the start, 2027-01-15 */
+#define SIM_START_UNIX_MS 1800000000000LL
+
+/** Time source of the node */
+enum sim_source_e
+{
+	SRC_DEVICE_TIME = 0, // DeviceTimeReq/DeviceTimeAns
+	SRC_DOWNLINK,		 // Network server without DeviceTimeReq, backend sends the time downlink
+	SRC_NUM
+};
+
+/** Scenario */
+struct sim_scenario_s
+{
+	const char *name;
+	uint8_t source;
+	bool drift_comp;   // Use the measured drift
+	double drift_ppm;  // Mean drift of the local clock, positive = slow
+	double wander_ppm; // Daily temperature cycle of the drift
+	double loss;	   // Loss rate of uplinks and answers
+};
+
+/** Result of a scenario */
+struct sim_result_s
+{
+	uint32_t frames;	// Frames with timestamp
+	uint32_t unstamped; // Frames without timestamp (before the first sync)
+	uint32_t exact;		// Timestamp equal to the true second
+	uint32_t max_err_s; // Largest timestamp error in seconds
+	uint32_t syncs;		// Received time answers
+	double drift_ppm;	// Drift estimate at the end
+};
+
+static std::mt19937 rng(7);
+
+static double uniform(double min, double max)
+{
+	return std::uniform_real_distribution<double>(min, max)(rng);
+}
+
+/**
+ * @brief Run one scenario
+ *
+ * @param scenario scenario
+ * @return sim_result_s result
+ */
+static sim_result_s run(const sim_scenario_s &scenario)
+{
+	sim_result_s result = {};
+	timesync_s ts;
+	ts_reset(&ts);
+	// Time downlink, uplinks with a time request on the node and the answer queued in the backend
+	ts_uplink_s uplinks[TS_UPLINK_HISTORY];
+	ts_uplinks_reset(uplinks);
+	uint8_t req_seq = 0;
+	bool answer_queued = false;
+	uint8_t answer_seq = 0;
+	int64_t answer_unix_ms = 0;
+
+	// Network time and local time (uptime of the node) in ms
+	int64_t unix_ms = SIM_START_UNIX_MS + (int64_t)uniform(0, 86400000.0);
+	double local_ms = uniform(0, 1000000.0);
+	int64_t end = unix_ms + SIM_DAYS * 24 * 60 * 60 * 1000LL;
+	while (unix_ms < end)
+	{
+		// Measurement and stamp, with the time downlink fallback a sequence number requests the sync
+		uint64_t measure_local = (uint64_t)local_ms;
+		int64_t stamp = ts_unix_ms(&ts, measure_local);
+		bool has_stamp = ts.state != TS_NONE;
+		bool sync_due = ts_sync_due(&ts, measure_local);
+		bool time_req = sync_due && (scenario.source == SRC_DOWNLINK);
+		if (has_stamp)
+		{
+			// Same conversion as timesync_stamp()
+			uint32_t sent = (uint32_t)(stamp / 1000);
+			uint32_t truth = (uint32_t)(unix_ms / 1000);
+			uint32_t error = sent > truth ? sent - truth : truth - sent;
+			result.frames++;
+			result.exact += error == 0 ? 1 : 0;
+			result.max_err_s = error > result.max_err_s ? error : result.max_err_s;
+		}
+		else
+		{
+			result.unstamped++;
+		}
+
+		// Uplink, network time at the end of the uplink, local time of the node at the same moment
+		int64_t uplink_end_unix = unix_ms + SIM_TOA_MS;
+		uint64_t uplink_end_local = (uint64_t)(local_ms + SIM_TOA_MS);
+		bool uplink_ok = uniform(0, 1) >= scenario.loss;
+		bool answer_ok = uniform(0, 1) >= scenario.loss;
+		uint8_t seq = req_seq;
+		if (time_req)
+		{
+			// Same as timesync_stamp() and timesync_uplink()
+			req_seq++;
+			ts_uplink_add(uplinks, seq, uplink_end_local);
+		}
+		if (uplink_ok && answer_ok && (scenario.source == SRC_DEVICE_TIME) && sync_due)
+		{
+			// DeviceTimeAns in 1/256 s, the stack corrects for the time since the uplink
+			int64_t answer = (uplink_end_unix * 256 / 1000) * 1000 / 256;
+			ts_sync(&ts, uplink_end_local + (int64_t)uniform(-5, 5), answer);
+			result.syncs++;
+		}
+		if (uplink_ok && answer_queued)
+		{
+			// The backend gets the uplink after the RX windows, the queued answer of an earlier request is sent now
+			answer_queued = false;
+			uint64_t request_end_local;
+			if (answer_ok && ts_uplink_find(uplinks, answer_seq, &request_end_local))
+			{
+				// Same as timesync_rx()
+				uint32_t unix_s = (uint32_t)(answer_unix_ms / 1000);
+				uint8_t fraction = (uint8_t)((answer_unix_ms % 1000) * 256 / 1000);
+				ts_sync(&ts, request_end_local, (int64_t)unix_s * 1000 + (fraction * 1000) / 256);
+				ts_uplinks_reset(uplinks);
+				result.syncs++;
+			}
+		}
+		if (uplink_ok && time_req)
+		{
+			// Backend answers with the reception time of the uplink, gateway timestamp with 50 ms jitter,
+			// 4 bytes seconds + 1 byte in 1/256 s. A newer request replaces a queued answer
+			answer_queued = true;
+			answer_seq = seq;
+			answer_unix_ms = uplink_end_unix + (int64_t)uniform(-50, 50);
+		}
+		if (!scenario.drift_comp)
+		{
+			ts.drift_ppb = 0;
+		}
+
+		// Next cycle, the local clock runs slow by the drift
+		double drift_ppm = scenario.drift_ppm + scenario.wander_ppm * sin(2.0 * M_PI * (unix_ms % 86400000LL) / 86400000.0);
+		unix_ms += SIM_INTERVAL_MS;
+		local_ms += SIM_INTERVAL_MS * (1.0 - drift_ppm * 1e-6);
+	}
+	result.drift_ppm = ts.drift_ppb / 1000.0;
+	return result;
+}
+
+int main(void)
+{
+	const sim_scenario_s scenarios[] = {
+		{"DeviceTimeReq", SRC_DEVICE_TIME, true, 35.0, 5.0, 0.2},
+		{"DeviceTimeReq fast clock", SRC_DEVICE_TIME, true, -120.0, 10.0, 0.2},
+		{"Time downlink", SRC_DOWNLINK, true, 35.0, 5.0, 0.2},
+		{"Time downlink, high loss", SRC_DOWNLINK, true, 35.0, 5.0, 0.6},
+		{"No drift compensation", SRC_DEVICE_TIME, false, 35.0, 5.0, 0.2},
+	};
+	bool ok = true;
+
+	printf("%-26s %8s %8s %8s %8s %10s %12s\n", "Scenario", "frames", "no time", "exact", "max err", "syncs", "drift [ppm]");
+	for (const sim_scenario_s &scenario : scenarios)
+	{
+		sim_result_s result = run(scenario);
+		printf("%-26s %8u %8u %7.2f%% %6u s %10u %7.2f/%5.1f\n", scenario.name, result.frames, result.unstamped,
+			   100.0 * result.exact / result.frames, result.max_err_s, result.syncs, result.drift_ppm, scenario.drift_ppm);
+		if (scenario.drift_comp)
+		{
+			// Second resolution, the error is at most 1 s around a second boundary
+			ok &= result.max_err_s <= 1;
+			ok &= fabs(result.drift_ppm - scenario.drift_ppm) < 5.0;
+			ok &= result.unstamped < 10;
+			// Less than one sync per 12 hours after the drift is known
+			ok &= result.syncs < SIM_DAYS * 2 + 10;
+		}
+	}
+	printf("%s\n", ok ? "All checks passed" : "Checks FAILED");
+	return ok ? 0 : 1;
+}